@@ -177,6 +177,16 @@ function build(runtime, version, abi) {
       process.env.gyp_iohook_platform = process.platform;
       process.env.gyp_iohook_arch = arch;
     }
+    if (process.platform === 'linux') {
+      // Optional X11 backends, left out unless asked for since they link
+      // libraries the default XRecord backend does not need.
+      if ('xinput2' in argv && argv['xinput2'] !== 'false') {
+        args.push('--iohook_xinput2=1');
+      }
+      if ('xcb-record' in argv && argv['xcb-record'] !== 'false') {
+        args.push('--iohook_xcb_record=1');
+      }
+    }
 
     let proc = spawn(gypJsPath, args, {
       env: process.env,
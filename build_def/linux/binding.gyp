@@ -5,7 +5,14 @@
 		"type": "loadable_module",
 		"sources": [
 			"src/iohook.cc",
-			"src/iohook.h"
+			"src/event_object.cc",
+			"src/iohook.h",
+			"src/event_object.h",
+			"src/event_coalescer.h",
+			"src/event_lanes.h",
+			"src/event_ring.h",
+			"src/latency_stats.h",
+			"src/shared_ring.h"
 		],
 		"dependencies": [
 			"./uiohook.gyp:uiohook"
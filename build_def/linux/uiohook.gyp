@@ -1,4 +1,10 @@
 {
+	"variables": {
+		# Optional X11 backends, see docs/manual-build.md.  They link
+		# libraries the default XRecord backend does not need.
+		"iohook_xinput2%": 0,
+		"iohook_xcb_record%": 0
+	},
 	"targets": [{
 		"target_name": "uiohook",
 		"type": "shared_library",
@@ -10,7 +16,8 @@
 			"libuiohook/src/x11/input_helper.c",
 			"libuiohook/src/x11/input_hook.c",
 			"libuiohook/src/x11/post_event.c",
-			"libuiohook/src/x11/system_properties.c"
+			"libuiohook/src/x11/system_properties.c",
+			"libuiohook/src/synthetic/synthetic_hook.c"
 		],
 		"cflags": [
 			"-std=c++14",
@@ -22,14 +29,38 @@
 						"-Wl,-rpath,<!(pwd)/build/Release/",
 						"-lX11",
 						"-lX11-xcb",
+						"-lxcb",
 						"-lxkbcommon-x11",
 						"-lxkbcommon",
 						"-lXtst"
 				]
 		},
 		"defines": [
+			"USE_XKB",
 			"USE_XKBCOMMON"
 		],
+		"conditions": [
+			["iohook_xinput2==1", {
+				"defines": [
+					"USE_XINPUT2"
+				],
+				"link_settings": {
+					"libraries": [
+						"-lXi"
+					]
+				}
+			}],
+			["iohook_xcb_record==1", {
+				"defines": [
+					"USE_XCB_RECORD"
+				],
+				"link_settings": {
+					"libraries": [
+						"-lxcb-record"
+					]
+				}
+			}]
+		],
 		"include_dirs": [
 			"<!(node -e \"require('nan')\")",
 			'libuiohook/include',
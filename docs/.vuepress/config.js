@@ -17,6 +17,7 @@ module.exports = {
       '/os-support',
       '/installation',
       '/usage',
+      '/architecture',
       '/manual-build',
       '/faq',
     ],
@@ -4,11 +4,16 @@ import { EventEmitter } from 'events';
  * Native module for hooking keyboard and mouse events
  */
 declare class IOHook extends EventEmitter {
+  /**
+   * Reader for the binary event ring, when started with `{ shared: true }`
+   */
+  sharedRing: SharedEventRing | null;
+
   /**
    * Start hooking engine. Call it when you ready to receive events
-   * @param {boolean} [enableLogger] If true, module will publish debug information to stdout
+   * @param {boolean|IOHookStartOptions} [options] If true, module will publish debug information to stdout
    */
-  start(enableLogger?: boolean): void;
+  start(options?: boolean | IOHookStartOptions): void;
 
   /**
    * Stop rising keyboard/mouse events
@@ -16,12 +21,14 @@ declare class IOHook extends EventEmitter {
   stop(): void;
 
   /**
-   * Manual native code load. Call this function only if unload called before
+   * Manual native code load. Call this function only if unload called before.
+   * Throws if the native hook fails to start, with the status as `code`
    */
   load(): void;
 
   /**
-   * Unload native code and free memory and system hooks
+   * Unload native code and free memory and system hooks. Throws if the
+   * native hook cannot be stopped, with the status as `code`
    */
   unload(): void;
 
@@ -82,6 +89,298 @@ declare class IOHook extends EventEmitter {
    * Unregister all shortcuts
    */
   unregisterAllShortcuts(): void;
+
+  /**
+   * Keyboard and mouse settings of the system, read from a native cache that
+   * is refreshed when the system reports a change, where supported.
+   * `systempropertieschange` is emitted on a change, but with the `xrecord`
+   * and `xcb-record` backends only right before the next input event
+   */
+  getSystemProperties(): IOHookSystemProperties;
+
+  /**
+   * Latency histograms of the stages events pass through, accumulated until
+   * resetLatencyStats()
+   */
+  getLatencyStats(): IOHookLatencyStats;
+
+  /**
+   * Clear the histograms returned by getLatencyStats()
+   */
+  resetLatencyStats(): void;
+
+  /**
+   * Counters kept by the native hook since the module was loaded, Linux only
+   */
+  getStats(): IOHookStats;
+}
+
+declare interface IOHookStats {
+  /** Input received from the X server, by kind */
+  received: {
+    keyPress: number;
+    keyRelease: number;
+    buttonPress: number;
+    buttonRelease: number;
+    motion: number;
+  };
+  /** Events passed to iohook, by event name, plus hookenabled and hookdisabled */
+  dispatched: { [event: string]: number };
+  /** Dispatched events that were consumed */
+  consumed: number;
+  /** XRecord data processed, one per callback or xcb reply */
+  replies: number;
+  /** Bytes of XRecord data processed */
+  bytes: number;
+  /** Nanoseconds spent handing events to iohook on the hook thread */
+  dispatchTime: number;
+  /** The queue to JavaScript, since the native hook was loaded */
+  queue: {
+    capacity: number;
+    dropped: number;
+    coalesced: number;
+  };
+}
+
+declare interface IOHookOverflow {
+  /** Events dropped since the last report */
+  dropped: number;
+  /** Mouse motion dropped in favour of later motion since the last report */
+  coalesced: number;
+  /** Lost events by event name */
+  types: { [event: string]: number };
+}
+
+declare interface IOHookLatencyHistogram {
+  count: number;
+  /** Nanoseconds, as are the other values */
+  min: number;
+  max: number;
+  mean: number;
+  /** Percentiles, accurate to within 12.5% */
+  p50: number;
+  p90: number;
+  p99: number;
+  p999: number;
+}
+
+declare interface IOHookLatencyStats {
+  /** From libuiohook receiving the input to the event being queued, Linux only */
+  hook: IOHookLatencyHistogram;
+  /** From being queued to being taken off the queue on the JavaScript thread */
+  queue: IOHookLatencyHistogram;
+  /** From being taken off the queue to the listeners returning */
+  handler: IOHookLatencyHistogram;
+  /** All of the above */
+  total: IOHookLatencyHistogram;
+}
+
+declare interface IOHookSystemProperties {
+  /** -1 when unknown, as are the other properties */
+  autoRepeatRate: number;
+  autoRepeatDelay: number;
+  pointerAccelerationMultiplier: number;
+  pointerAccelerationThreshold: number;
+  pointerSensitivity: number;
+  multiClickTime: number;
+}
+
+declare interface IOHookStartOptions {
+  /**
+   * Publish debug information to stdout
+   */
+  debug?: boolean;
+
+  /**
+   * Number of events buffered between the native hook thread and JavaScript.
+   * Rounded up to a power of two. Events are dropped when the buffer is full.
+   */
+  queueCapacity?: number;
+
+  /**
+   * What happens to an event that finds the queue full. `drop-newest` drops
+   * it, `drop-oldest` drops the oldest queued event, `coalesce-motion` drops
+   * queued mouse motion first so that key and button events survive, and
+   * `block` waits up to `overflowTimeout` for room before dropping the event.
+   * Lost events are reported by an `overflow` event.
+   */
+  overflow?: 'drop-newest' | 'drop-oldest' | 'coalesce-motion' | 'block';
+
+  /**
+   * Longest wait of the `block` policy, in milliseconds. Defaults to 10.
+   */
+  overflowTimeout?: number;
+
+  /**
+   * Queue key and button events in a lane of their own that is served first,
+   * so they do not wait behind a backlog of motion. `true` lets them overtake
+   * any number of other events.
+   */
+  priority?: boolean | IOHookPriorityOptions;
+
+  /**
+   * Merge runs of motion and of wheel events natively, see
+   * IOHookCoalesceOptions. `true` merges both.
+   */
+  coalesce?: boolean | IOHookCoalesceOptions;
+
+  /**
+   * Deliver everything queued natively in one call per wakeup instead of one
+   * call per event. Events are still emitted individually.
+   */
+  batch?: boolean;
+
+  /**
+   * Write events as binary records into a SharedArrayBuffer ring, available
+   * as `sharedRing`, instead of emitting event objects. A `ring` event is
+   * emitted whenever new records can be read.
+   */
+  shared?: boolean;
+
+  /**
+   * Emit the same object for every event of a kind, overwritten in place, so
+   * that no garbage is created per event. Listeners must copy what they need
+   * before returning. Ignored together with `batch`.
+   */
+  reuseEventObject?: boolean;
+
+  /**
+   * How the native hook receives input on X11: `xrecord` (the default),
+   * `xcb-record` for the same recording read through xcb, `xinput2` for
+   * XInput2 raw events, or `synthetic` for generated events that need no X
+   * server. `xcb-record` and `xinput2` are only available in builds that
+   * include them. Other platforms only have a default.
+   *
+   * `xinput2` gets no events for auto-repeated keys, so holding a key gives a
+   * single `keydown`, and smooth scrolling devices give one `mousewheel` per
+   * scroll increment instead of per wheel click.
+   */
+  backend?: 'xrecord' | 'xcb-record' | 'xinput2' | 'synthetic';
+
+  /**
+   * Events generated by the `synthetic` backend.
+   */
+  synthetic?: IOHookSyntheticOptions;
+}
+
+declare interface IOHookPriorityOptions {
+  /**
+   * Only let a key or button event overtake events queued at most this many
+   * milliseconds before it
+   */
+  maxSkew?: number;
+}
+
+declare interface IOHookCoalesceOptions {
+  /**
+   * Merge consecutive `mousemove` or `mousedrag` events into their last one,
+   * which then carries `dx`, `dy` and `samples`
+   */
+  motion?: boolean;
+
+  /**
+   * Merge consecutive `mousewheel` events scrolling the same way into one
+   * with the summed rotation, which then carries `samples`
+   */
+  wheel?: boolean;
+
+  /**
+   * Deliver merged events at most this many times per second, for example 60
+   * or 120. Without it they are only merged while JavaScript is behind.
+   */
+  rate?: number;
+}
+
+declare interface IOHookSyntheticOptions {
+  /**
+   * Mouse moves per second. 0 (the default) disables them.
+   */
+  motionRate?: number;
+
+  /**
+   * Key bursts per second. Every key of a burst is pressed, typed and
+   * released, and every fourth burst is typed with shift held.
+   */
+  keyRate?: number;
+
+  /**
+   * Keys typed by each burst, 1 by default.
+   */
+  keyBurst?: number;
+
+  /**
+   * Wheel clicks per second.
+   */
+  wheelRate?: number;
+
+  /**
+   * Milliseconds to generate events for. 0 (the default) keeps generating
+   * until the hook is unloaded.
+   */
+  duration?: number;
+
+  /**
+   * File of events to replay as fast as they are consumed instead of
+   * generating them, once or for `duration`. See docs/usage.md for the format.
+   */
+  replayFile?: string;
+}
+
+declare interface SharedEventRingLayout {
+  headerBytes: number;
+  recordBytes: number;
+  head: number;
+  tail: number;
+  dropped: number;
+  capacity: number;
+  recordInts: number;
+  fields: { [name: string]: number };
+}
+
+/**
+ * Reader for the binary event ring written by the native hook thread
+ */
+declare class SharedEventRing {
+  buffer: SharedArrayBuffer;
+  layout: SharedEventRingLayout;
+
+  /**
+   * Int32Array over the whole buffer
+   */
+  view: Int32Array;
+
+  /**
+   * Int32Array offset of each record field, relative to the record
+   */
+  fields: { [name: string]: number };
+
+  capacity: number;
+
+  /**
+   * Number of records waiting to be read
+   */
+  readonly pending: number;
+
+  /**
+   * Number of events dropped because the ring was full
+   */
+  readonly dropped: number;
+
+  /**
+   * Call visitor for every pending record, oldest first
+   * @return {number} Number of records read
+   */
+  read(visitor: (view: Int32Array, offset: number) => void): number;
+
+  /**
+   * Skip every pending record
+   */
+  discard(): void;
+
+  /**
+   * Event time of a record in milliseconds
+   */
+  time(offset: number): number;
 }
 
 declare interface IOHookEvent {
@@ -93,6 +392,20 @@ declare interface IOHookEvent {
   clicks?: number;
   x?: number;
   y?: number;
+  /** Modifier keys held down, on every kind of event */
+  shiftKey: boolean;
+  altKey: boolean;
+  ctrlKey: boolean;
+  metaKey: boolean;
+  /** Lock keys switched on, on every kind of event */
+  capsLock: boolean;
+  numLock: boolean;
+  scrollLock: boolean;
+  /** Distance covered by coalesced motion */
+  dx?: number;
+  dy?: number;
+  /** Number of events merged into a coalesced event */
+  samples?: number;
 }
 
 declare const iohook: IOHook;
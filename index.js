@@ -1,5 +1,6 @@
 const EventEmitter = require('events');
 const path = require('path');
+const SharedEventRing = require('./shared-ring');
 
 const runtime = process.versions['electron'] ? 'electron' : 'node';
 const essential =
@@ -35,6 +36,35 @@ const events = {
   11: 'mousewheel',
 };
 
+// Not an input event, the native cache of system properties was refreshed.
+const EVENT_SYSTEM_PROPERTIES_CHANGED = 12;
+
+// Not an input event, events were lost between the native hook and JavaScript.
+const EVENT_OVERFLOW = 0x100;
+
+// libuiohook event mask bit of every event type above.
+const EVENT_MASK_ALL = 0xffffffff;
+const eventMasks = {};
+Object.keys(events).forEach((type) => {
+  eventMasks[events[type]] = 1 << type;
+});
+eventMasks.systempropertieschange = 1 << EVENT_SYSTEM_PROPERTIES_CHANGED;
+
+/**
+ * Error for a failed native hook operation
+ * @param {string} operation What failed, 'start' or 'stop'
+ * @param {number} status libuiohook status code
+ * @return {Error} Error carrying the status as `code`
+ * @private
+ */
+function hookError(operation, status) {
+  const error = new Error(
+    `iohook failed to ${operation} the native hook (0x${status.toString(16)})`
+  );
+  error.code = status;
+  return error;
+}
+
 class IOHook extends EventEmitter {
   constructor() {
     super();
@@ -42,33 +72,98 @@ class IOHook extends EventEmitter {
     this.shortcuts = [];
     this.eventProperty = 'keycode';
     this.activatedShortcuts = [];
+    this.options = {};
+    this.loaded = false;
+    this.sharedRing = null;
 
-    this.lastKeydownShift = false;
-    this.lastKeydownAlt = false;
-    this.lastKeydownCtrl = false;
-    this.lastKeydownMeta = false;
-
-    this.load();
     this.setDebug(false);
+
+    // Only ask the native hook for events somebody listens to.
+    this._nativeEventMask = null;
+    this._eventMaskPending = false;
+    this.on('newListener', this._scheduleEventMask);
+    this.on('removeListener', this._scheduleEventMask);
+    this._updateEventMask();
   }
 
   /**
    * Start hook process
-   * @param {boolean} [enableLogger] Turn on debug logging
+   * @param {boolean|Object} [options] Turn on debug logging, or an options object
+   * @param {boolean} [options.debug] Turn on debug logging
+   * @param {number} [options.queueCapacity] Number of events buffered between
+   * the native hook thread and JavaScript, rounded up to a power of two. Only
+   * applied when the native hook is loaded.
+   * @param {string} [options.overflow] What happens to an event that finds the
+   * queue full: `'drop-newest'` (the default) drops it, `'drop-oldest'` drops
+   * the oldest queued event instead, `'coalesce-motion'` drops queued mouse
+   * motion first so key and button events survive, and `'block'` holds up the
+   * hook thread for up to `overflowTimeout` milliseconds (10 by default)
+   * before dropping the event. Lost events are reported by an `overflow`
+   * event. Only applied when the native hook is loaded.
+   * @param {number} [options.overflowTimeout] Longest wait of the `'block'`
+   * policy for room in the queue, in milliseconds.
+   * @param {boolean|Object} [options.priority] Queue key and button events in
+   * a lane of their own that is served first, so they never wait behind a
+   * backlog of mouse motion. `true` lets them overtake any number of other
+   * events; `{ maxSkew }` only those queued at most `maxSkew` milliseconds
+   * earlier. Only applied when the native hook is loaded.
+   * @param {boolean|Object} [options.coalesce] Merge runs of `mousemove` or
+   * `mousedrag` events into their last event, and runs of `mousewheel` events
+   * scrolling the same way into one with the summed rotation, while
+   * JavaScript is behind. Merged events carry `samples`, the number of events
+   * merged, and motion also `dx` and `dy`, the distance covered. `true` merges
+   * both; `{ motion, wheel, rate }` picks them and with a `rate` in Hz also
+   * holds runs back to deliver at most that many per second. Other events are
+   * never merged or reordered. Only applied when the native hook is loaded.
+   * @param {boolean} [options.batch] Receive everything queued natively in one
+   * call per wakeup instead of one call per event. Only applied when the
+   * native hook is loaded.
+   * @param {boolean} [options.shared] Write events as binary records into a
+   * SharedArrayBuffer ring (`ioHook.sharedRing`) instead of emitting event
+   * objects. A `ring` event is emitted whenever new records are available.
+   * Only applied when the native hook is loaded.
+   * @param {boolean} [options.reuseEventObject] Emit the same object for every
+   * event of a kind, overwritten in place, so no garbage is created per event.
+   * Listeners must copy what they need before returning. Ignored together with
+   * `batch`. Only applied when the native hook is loaded.
+   * @param {string} [options.backend] How the native hook receives input on
+   * X11: `'xrecord'` (the default), `'xcb-record'` for the same recording read
+   * through xcb, `'xinput2'` for XInput2 raw events, or `'synthetic'` for
+   * generated events that need no X server. `'xcb-record'` and `'xinput2'`
+   * are only available in builds that include them. Only applied when the
+   * native hook is loaded.
+   * @param {Object} [options.synthetic] Events generated by the `'synthetic'`
+   * backend: `motionRate`, `keyRate` and `wheelRate` in events (key bursts)
+   * per second, `keyBurst` keys per burst, `duration` in milliseconds, or a
+   * `replayFile` to play back as fast as possible instead.
    */
-  start(enableLogger) {
+  start(options) {
+    if (typeof options !== 'object' || options === null) {
+      options = { debug: options };
+    }
+
     if (!this.active) {
+      this.options = Object.assign({}, this.options, options);
+      if (!this.loaded) {
+        this.load();
+      } else {
+        NodeHookAddon.resumeHook();
+      }
       this.active = true;
-      this.setDebug(enableLogger);
+      this.setDebug(this.options.debug);
     }
   }
 
   /**
-   * Shutdown event hook
+   * Shutdown event hook. The native hook stays loaded but stops receiving
+   * input until the next start().
    */
   stop() {
     if (this.active) {
       this.active = false;
+      if (this.loaded) {
+        NodeHookAddon.pauseHook();
+      }
     }
   }
 
@@ -89,6 +184,7 @@ class IOHook extends EventEmitter {
     shortcut.callback = callback;
     shortcut.releaseCallback = releaseCallback;
     this.shortcuts.push(shortcut);
+    this._updateEventMask();
     return shortcutId;
   }
 
@@ -102,6 +198,7 @@ class IOHook extends EventEmitter {
         this.shortcuts.splice(i, 1);
       }
     });
+    this._updateEventMask();
   }
 
   /**
@@ -140,6 +237,7 @@ class IOHook extends EventEmitter {
       if (keyCodes.length === 0) {
         // Unregister this shortcut
         this.shortcuts.splice(i, 1);
+        this._updateEventMask();
         return;
       }
     }
@@ -150,21 +248,56 @@ class IOHook extends EventEmitter {
    */
   unregisterAllShortcuts() {
     this.shortcuts.splice(0, this.shortcuts.length);
+    this._updateEventMask();
   }
 
   /**
    * Load native module
+   * @throws {Error} If the native hook failed to start, with the libuiohook
+   * status as `code`. The module then stays unloaded.
    */
   load() {
-    NodeHookAddon.startHook(this._handler.bind(this), this.debug || false);
+    let handler = this._handler;
+    if (this.options.shared) {
+      handler = this._sharedHandler;
+    } else if (this.options.batch) {
+      handler = this._batchHandler;
+    }
+
+    this._updateEventMask();
+    const buffer = NodeHookAddon.startHook(
+      handler.bind(this),
+      this.debug || false,
+      this.options
+    );
+
+    // A number is the libuiohook status of a hook that failed to start.
+    if (typeof buffer === 'number') {
+      throw hookError('start', buffer);
+    }
+
+    this.sharedRing = buffer
+      ? new SharedEventRing(buffer, NodeHookAddon.sharedRingLayout)
+      : null;
+    this.loaded = true;
   }
 
   /**
    * Unload native module and stop hook
+   * @throws {Error} If the native hook could not be stopped, with the
+   * libuiohook status as `code`. The module then stays loaded.
    */
   unload() {
     this.stop();
-    NodeHookAddon.stopHook();
+
+    // The hook stays loaded if it could not be stopped.
+    const status = NodeHookAddon.stopHook();
+    if (status) {
+      throw hookError('stop', status);
+    }
+
+    this.loaded = false;
+    this.sharedRing = null;
   }
 
   /**
@@ -204,6 +337,51 @@ class IOHook extends EventEmitter {
     NodeHookAddon.grabMouseClick(false);
   }
 
+  /**
+   * Keyboard and mouse settings of the system. Read from a native cache that
+   * is refreshed when the system reports a change, where supported.
+   * @return {Object} autoRepeatRate, autoRepeatDelay,
+   * pointerAccelerationMultiplier, pointerAccelerationThreshold,
+   * pointerSensitivity and multiClickTime. -1 when unknown.
+   */
+  getSystemProperties() {
+    return NodeHookAddon.getSystemProperties();
+  }
+
+  /**
+   * Latency histograms of the stages events pass through, in nanoseconds,
+   * accumulated until resetLatencyStats(). `hook` runs from libuiohook
+   * receiving the input to the event being queued (Linux only), `queue` until
+   * the JavaScript thread takes it off the queue, `handler` until the
+   * listeners have returned, and `total` covers all of them.
+   * @return {Object} For each stage: count, min, max, mean, p50, p90, p99 and
+   * p999. Percentiles are accurate to within 12.5%.
+   */
+  getLatencyStats() {
+    return NodeHookAddon.getLatencyStats();
+  }
+
+  /**
+   * Clear the histograms returned by getLatencyStats().
+   */
+  resetLatencyStats() {
+    NodeHookAddon.resetLatencyStats();
+  }
+
+  /**
+   * Counters kept by the native hook since the module was loaded. They only
+   * grow, so sample them periodically and compare. Linux only, zero elsewhere.
+   * @return {Object} `received` input by kind (keyPress, keyRelease,
+   * buttonPress, buttonRelease, motion), `dispatched` events by type, events
+   * `consumed` by the dispatcher, XRecord `replies` and `bytes` processed, and
+   * `dispatchTime` spent handing events to iohook, in nanoseconds. `queue`
+   * has the `capacity` of the queue to JavaScript and the events `dropped` or
+   * `coalesced` by it since the native hook was loaded.
+   */
+  getStats() {
+    return NodeHookAddon.getStats();
+  }
+
   /**
    * Local event handler. Don't use it in your code!
    * @param msg Raw event message
@@ -212,15 +390,19 @@ class IOHook extends EventEmitter {
   _handler(msg) {
     if (this.active === false || !msg) return;
 
-    if (events[msg.type]) {
-      const event = msg.mouse || msg.keyboard || msg.wheel;
+    if (msg.type === EVENT_OVERFLOW) {
+      this.emit('overflow', msg.overflow);
+      return;
+    }
 
-      event.type = events[msg.type];
+    if (msg.type === EVENT_SYSTEM_PROPERTIES_CHANGED) {
+      this.emit('systempropertieschange', this.getSystemProperties());
+      return;
+    }
 
-      this._handleShift(event);
-      this._handleAlt(event);
-      this._handleCtrl(event);
-      this._handleMeta(event);
+    if (events[msg.type]) {
+      // The native data object already carries the event name as its type.
+      const event = msg.mouse || msg.keyboard || msg.wheel;
 
       this.emit(events[msg.type], event);
 
@@ -235,82 +417,85 @@ class IOHook extends EventEmitter {
   }
 
   /**
-   * Handles the shift key. Whenever shift is pressed, all future events would
-   * contain { shiftKey: true } in its object, until the shift key is released.
-   * @param event Event object
+   * Local handler for batched delivery. Don't use it in your code!
+   * @param {Array} batch Raw event messages, oldest first
    * @private
    */
-  _handleShift(event) {
-    if (event.type === 'keyup' && event.shiftKey) {
-      this.lastKeydownShift = false;
-    }
-
-    if (event.type === 'keydown' && event.shiftKey) {
-      this.lastKeydownShift = true;
-    }
-
-    if (this.lastKeydownShift) {
-      event.shiftKey = true;
+  _batchHandler(batch) {
+    for (let i = 0; i < batch.length; i++) {
+      this._handler(batch[i]);
     }
   }
 
   /**
-   * Handles the alt key. Whenever alt is pressed, all future events would
-   * contain { altKey: true } in its object, until the alt key is released.
-   * @param event Event object
+   * Local handler for the shared ring doorbell. Don't use it in your code!
    * @private
    */
-  _handleAlt(event) {
-    if (event.type === 'keyup' && event.altKey) {
-      this.lastKeydownAlt = false;
-    }
-
-    if (event.type === 'keydown' && event.altKey) {
-      this.lastKeydownAlt = true;
+  _sharedHandler() {
+    if (this.active === false) {
+      // Nobody is reading while stopped, keep the ring from filling up.
+      this.sharedRing.discard();
+      return;
     }
 
-    if (this.lastKeydownAlt) {
-      event.altKey = true;
-    }
+    this.emit('ring', this.sharedRing);
   }
 
   /**
-   * Handles the ctrl key. Whenever ctrl is pressed, all future events would
-   * contain { ctrlKey: true } in its object, until the ctrl key is released.
-   * @param event Event object
+   * Event types the native hook has to deliver for the current listeners.
+   * @return {number} libuiohook event mask
    * @private
    */
-  _handleCtrl(event) {
-    if (event.type === 'keyup' && event.ctrlKey) {
-      this.lastKeydownCtrl = false;
+  _eventMask() {
+    // Ring readers see raw records, there is no listener to go by.
+    if (this.options.shared) {
+      return EVENT_MASK_ALL;
     }
 
-    if (event.type === 'keydown' && event.ctrlKey) {
-      this.lastKeydownCtrl = true;
+    let mask = 0;
+    Object.keys(events).forEach((type) => {
+      if (this.listenerCount(events[type]) > 0) {
+        mask |= eventMasks[events[type]];
+      }
+    });
+
+    // Shortcuts are matched on key events. Modifier flags come from the
+    // native modifier mask, which is kept whatever the event mask.
+    if (this.shortcuts.length > 0) {
+      mask |= eventMasks.keydown | eventMasks.keyup;
     }
 
-    if (this.lastKeydownCtrl) {
-      event.ctrlKey = true;
+    if (this.listenerCount('systempropertieschange') > 0) {
+      mask |= eventMasks.systempropertieschange;
     }
+
+    return mask >>> 0;
   }
 
   /**
-   * Handles the meta key. Whenever meta is pressed, all future events would
-   * contain { metaKey: true } in its object, until the meta key is released.
-   * @param event Event object
+   * Send the event mask to the native hook if it changed.
    * @private
    */
-  _handleMeta(event) {
-    if (event.type === 'keyup' && event.metaKey) {
-      this.lastKeydownMeta = false;
-    }
+  _updateEventMask() {
+    this._eventMaskPending = false;
 
-    if (event.type === 'keydown' && event.metaKey) {
-      this.lastKeydownMeta = true;
+    const mask = this._eventMask();
+    if (mask !== this._nativeEventMask) {
+      this._nativeEventMask = mask;
+      NodeHookAddon.setEventMask(mask);
     }
+  }
 
-    if (this.lastKeydownMeta) {
-      event.metaKey = true;
+  /**
+   * Update the event mask once the listener change is complete. `newListener`
+   * is emitted before the listener is added, and a burst of `on()` calls only
+   * needs one update.
+   * @private
+   */
+  _scheduleEventMask() {
+    if (!this._eventMaskPending) {
+      this._eventMaskPending = true;
+      process.nextTick(() => this._updateEventMask());
     }
   }
 
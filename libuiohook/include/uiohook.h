@@ -29,6 +29,7 @@
 
 // System level errors.
 #define UIOHOOK_ERROR_OUT_OF_MEMORY				0x02
+#define UIOHOOK_ERROR_BACKEND_UNSUPPORTED		0x03
 
 // Unix specific errors.
 #define UIOHOOK_ERROR_X_OPEN_DISPLAY			0x20
@@ -37,6 +38,8 @@
 #define UIOHOOK_ERROR_X_RECORD_CREATE_CONTEXT	0x23
 #define UIOHOOK_ERROR_X_RECORD_ENABLE_CONTEXT	0x24
 #define UIOHOOK_ERROR_X_RECORD_GET_CONTEXT		0x25
+#define UIOHOOK_ERROR_X_RECORD_REGISTER_CLIENTS	0x26
+#define UIOHOOK_ERROR_X_INPUT2_NOT_FOUND		0x27
 
 // Windows specific errors.
 #define UIOHOOK_ERROR_SET_WINDOWS_HOOK_EX		0x30
@@ -50,6 +53,29 @@
 #define UIOHOOK_ERROR_CREATE_OBSERVER			0x44
 /* End Error Codes */
 
+/* Begin Hook Backends */
+typedef enum _hook_backend {
+	HOOK_BACKEND_DEFAULT = 0,	// The platform default, XRecord on X11.
+	HOOK_BACKEND_XRECORD,		// X11 RECORD extension.
+	HOOK_BACKEND_XINPUT2,		// X11 XInput2 raw events, if built with XInput2.
+	HOOK_BACKEND_XCB_RECORD,	// X11 RECORD extension through xcb, if built with xcb-record.
+	HOOK_BACKEND_SYNTHETIC		// Generated events, see hook_set_synthetic_options().  X11 only.
+} hook_backend;
+/* End Hook Backends */
+
+/* Begin Synthetic Backend */
+// Event streams generated by HOOK_BACKEND_SYNTHETIC.  Rates are in events per
+// second, 0 disables a stream.
+typedef struct _synthetic_options {
+	uint32_t motion_rate;		// Mouse moves.
+	uint32_t key_rate;			// Key bursts.
+	uint16_t key_burst;			// Keys typed by each burst.
+	uint32_t wheel_rate;		// Wheel clicks.
+	uint32_t duration;			// Milliseconds to generate for, 0 until hook_stop().
+	const char *replay_file;	// Replayed as fast as possible instead, or NULL.
+} synthetic_options;
+/* End Synthetic Backend */
+
 /* Begin Log Levels and Function Prototype */
 typedef enum _log_level {
 	LOG_LEVEL_DEBUG = 1,
@@ -74,7 +100,8 @@ typedef enum _event_type {
 	EVENT_MOUSE_RELEASED,
 	EVENT_MOUSE_MOVED,
 	EVENT_MOUSE_DRAGGED,
-	EVENT_MOUSE_WHEEL
+	EVENT_MOUSE_WHEEL,
+	EVENT_SYSTEM_PROPERTIES_CHANGED
 } event_type;
 
 typedef struct _screen_data {
@@ -85,6 +112,15 @@ typedef struct _screen_data {
 	uint16_t height;
 } screen_data;
 
+typedef struct _system_properties {
+	long int auto_repeat_rate;
+	long int auto_repeat_delay;
+	long int pointer_acceleration_multiplier;
+	long int pointer_acceleration_threshold;
+	long int pointer_sensitivity;
+	long int multi_click_time;
+} system_properties;
+
 typedef struct _keyboard_event_data {
 	uint16_t keycode;
 	uint16_t rawcode;
@@ -130,6 +166,48 @@ typedef void (*dispatcher_t)(uiohook_event *const);
 /* End Virtual Event Types and Data Structures */
 
 
+/* Begin Hook Statistics */
+// Number of X core event types counted, KeyPress (2) to MotionNotify (6).
+#define HOOK_STATS_INPUT_TYPES		7
+
+// Number of event types counted, by event_type.
+#define HOOK_STATS_EVENT_TYPES		(EVENT_SYSTEM_PROPERTIES_CHANGED + 1)
+
+// Counters kept by the hook since the library was loaded.  They only grow.
+typedef struct _hook_stats {
+	uint64_t received[HOOK_STATS_INPUT_TYPES];		// Input received, by X core event type.  XInput2 raw events count as their core type.
+	uint64_t dispatched[HOOK_STATS_EVENT_TYPES];	// Events passed to the dispatcher, by event_type.
+	uint64_t consumed;								// Dispatched events the dispatcher set reserved on.
+	uint64_t replies;								// XRecord data processed, one per callback or xcb reply.
+	uint64_t bytes;									// Bytes of intercepted XRecord data.
+	uint64_t dispatch_time;							// Nanoseconds spent inside the dispatcher.
+} hook_stats;
+/* End Hook Statistics */
+
+
+/* Begin Event Masks */
+#define EVENT_MASK(type)						(1u << (type))
+
+#define EVENT_MASK_NONE							0x00000000u
+#define EVENT_MASK_ALL							0xFFFFFFFFu
+
+#define EVENT_MASK_KEYBOARD						(EVENT_MASK(EVENT_KEY_TYPED) | \
+												 EVENT_MASK(EVENT_KEY_PRESSED) | \
+												 EVENT_MASK(EVENT_KEY_RELEASED))
+
+#define EVENT_MASK_MOUSE_BUTTON					(EVENT_MASK(EVENT_MOUSE_CLICKED) | \
+												 EVENT_MASK(EVENT_MOUSE_PRESSED) | \
+												 EVENT_MASK(EVENT_MOUSE_RELEASED))
+
+#define EVENT_MASK_MOUSE_MOTION					(EVENT_MASK(EVENT_MOUSE_MOVED) | \
+												 EVENT_MASK(EVENT_MOUSE_DRAGGED))
+
+#define EVENT_MASK_MOUSE_WHEEL					EVENT_MASK(EVENT_MOUSE_WHEEL)
+
+#define EVENT_MASK_SYSTEM_PROPERTIES			EVENT_MASK(EVENT_SYSTEM_PROPERTIES_CHANGED)
+/* End Event Masks */
+
+
 /* Begin Virtual Key Codes */
 #define VC_ESCAPE								0x0001
 
@@ -428,11 +506,46 @@ extern "C" {
 	// Withdraw the event hook.
 	UIOHOOK_API int hook_stop();
 
+	// Stop delivering events without withdrawing the event hook.
+	UIOHOOK_API int hook_pause();
+
+	// Resume delivering events after hook_pause().
+	UIOHOOK_API int hook_resume();
+
+	// Only dispatch events whose EVENT_MASK() bit is set.  Hook enabled and
+	// disabled events are always dispatched.  May be called from any thread,
+	// before or while the hook is running.  Where the platform allows it, the
+	// event classes left out are not delivered to the process at all.
+	UIOHOOK_API int hook_set_event_mask(uint32_t mask);
+
+	// Select how the next hook_run() receives input.  Returns
+	// UIOHOOK_ERROR_BACKEND_UNSUPPORTED for a backend this build cannot use.
+	UIOHOOK_API int hook_set_backend(hook_backend backend);
+
+	// Configure the events HOOK_BACKEND_SYNTHETIC generates on the next
+	// hook_run().  Events passed to hook_post_event() while it runs are
+	// dispatched as if they came from a device.
+	UIOHOOK_API int hook_set_synthetic_options(const synthetic_options *options);
+
+	// Monotonic time in nanoseconds at which the hook received the native
+	// input behind the event being dispatched, or 0 where the platform does
+	// not record it.  Only meaningful inside the dispatch callback.
+	UIOHOOK_API uint64_t hook_get_input_time();
+
+	// Copy the hook's counters.  Never blocks, so it may be called from any
+	// thread while the hook runs.  X11 only.
+	UIOHOOK_API int hook_get_stats(hook_stats *stats);
+
 	UIOHOOK_API void grab_mouse_click(bool enable);
 
 	// Retrieves an array of screen data for each available monitor.
 	UIOHOOK_API screen_data* hook_create_screen_info(unsigned char *count);
 
+	// Retrieves all of the system properties below at once.  Platforms that
+	// can watch them for changes answer from a cache and dispatch
+	// EVENT_SYSTEM_PROPERTIES_CHANGED from the hook thread when it is updated.
+	UIOHOOK_API void hook_get_system_properties(system_properties *properties);
+
 	// Retrieves the keyboard auto repeat rate.
 	UIOHOOK_API long int hook_get_auto_repeat_rate();
 
@@ -0,0 +1,555 @@
+/* libUIOHook: Cross-platfrom userland keyboard and mouse hooking.
+ * Copyright (C) 2006-2017 Alexander Barker.  All Rights Received.
+ * https://github.com/kwhat/libuiohook/
+ *
+ * libUIOHook is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libUIOHook is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* End to end input latency on X11.
+ *
+ * Events are injected with hook_post_event(), which goes through XTest, at a
+ * fixed rate, and the time from injection to arrival in the dispatcher is
+ * taken with CLOCK_MONOTONIC.  The key, button, motion and wheel paths are
+ * measured one after the other, and a latency histogram and the number of
+ * events lost are reported for each.  Needs a build with XTest; events sent
+ * with XSendEvent() are never seen by the hook.
+ *
+ * Usage: benchlatency [-x] [-r rate] [-n count] [-b backend]
+ *   -x          Start a private Xvfb and measure against it instead of $DISPLAY.
+ *   -r rate     Events injected per second, 1000 by default.
+ *   -n count    Events injected per path, 2000 by default.
+ *   -b backend  xrecord (default), xcb-record or xinput2.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <uiohook.h>
+#include <unistd.h>
+
+// Display number of the private Xvfb.
+#define XVFB_DISPLAY 99
+
+// Motion is injected on a grid, so the position of a move tells its index.
+#define MOTION_ORIGIN 16
+#define MOTION_WIDTH 512
+#define MOTION_HEIGHT 512
+
+// Where buttons and the wheel are injected.
+#define BUTTON_X 8
+#define BUTTON_Y 8
+
+// Power of two histogram buckets, in microseconds.
+#define LATENCY_BUCKETS 24
+
+// Time allowed for the last events of a path to arrive.
+#define DRAIN_NS 250000000
+
+// Keys injected by the key path, in turn.
+static const uint16_t bench_keys[] = {
+	VC_A, VC_B, VC_C, VC_D, VC_E, VC_F, VC_G, VC_H, VC_I, VC_J, VC_K, VC_L, VC_M,
+	VC_N, VC_O, VC_P, VC_Q, VC_R, VC_S, VC_T, VC_U, VC_V, VC_W, VC_X, VC_Y, VC_Z
+};
+
+#define BENCH_KEY_COUNT (sizeof(bench_keys) / sizeof(bench_keys[0]))
+
+typedef enum _bench_path_id {
+	PATH_KEY,
+	PATH_BUTTON,
+	PATH_MOTION,
+	PATH_WHEEL,
+	PATH_COUNT
+} bench_path_id;
+
+typedef struct _bench_path {
+	const char *name;
+	// Event type that is timed.
+	event_type type;
+	// Events repeat their identifying tag after this many.
+	size_t cycle;
+	// Injection time of every event.  Written before the event is posted and
+	// published through posted.
+	uint64_t *post_time;
+	size_t posted;
+	// Written by the hook thread only.
+	size_t next;
+	size_t received;
+	uint64_t *latency;
+	uint64_t histogram[LATENCY_BUCKETS];
+} bench_path;
+
+static bench_path paths[PATH_COUNT] = {
+	[PATH_KEY] = { .name = "key", .type = EVENT_KEY_PRESSED, .cycle = BENCH_KEY_COUNT },
+	[PATH_BUTTON] = { .name = "button", .type = EVENT_MOUSE_PRESSED, .cycle = 1 },
+	[PATH_MOTION] = { .name = "motion", .type = EVENT_MOUSE_MOVED, .cycle = MOTION_WIDTH * MOTION_HEIGHT },
+	[PATH_WHEEL] = { .name = "wheel", .type = EVENT_MOUSE_WHEEL, .cycle = 1 }
+};
+
+// Path being measured, or PATH_COUNT between paths.
+static bench_path_id current_path = PATH_COUNT;
+
+static pthread_t hook_thread;
+static pthread_mutex_t hook_control_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t hook_control_cond = PTHREAD_COND_INITIALIZER;
+static bool hook_enabled = false;
+static bool hook_exited = false;
+static int hook_status = UIOHOOK_SUCCESS;
+
+
+bool logger_proc(unsigned int level, const char *format, ...) {
+	bool status = false;
+
+	va_list args;
+	switch (level) {
+		case LOG_LEVEL_WARN:
+		case LOG_LEVEL_ERROR:
+			va_start(args, format);
+			status = vfprintf(stderr, format, args) >= 0;
+			va_end(args);
+			break;
+	}
+
+	return status;
+}
+
+static inline uint64_t now_ns() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static void sleep_until(uint64_t deadline) {
+	struct timespec ts;
+	ts.tv_sec = deadline / 1000000000;
+	ts.tv_nsec = deadline % 1000000000;
+	while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR) {
+		// Keep sleeping.
+	}
+}
+
+// Identifying tag of an arriving event, between 0 and the path's cycle.
+static size_t event_tag(bench_path_id id, uiohook_event * const event) {
+	size_t i;
+	switch (id) {
+		case PATH_KEY:
+			for (i = 0; i < BENCH_KEY_COUNT; i++) {
+				if (bench_keys[i] == event->data.keyboard.keycode) {
+					return i;
+				}
+			}
+			return SIZE_MAX;
+
+		case PATH_MOTION:
+			if (event->data.mouse.x < MOTION_ORIGIN || event->data.mouse.x >= MOTION_ORIGIN + MOTION_WIDTH
+					|| event->data.mouse.y < MOTION_ORIGIN || event->data.mouse.y >= MOTION_ORIGIN + MOTION_HEIGHT) {
+				return SIZE_MAX;
+			}
+			return (event->data.mouse.y - MOTION_ORIGIN) * MOTION_WIDTH + (event->data.mouse.x - MOTION_ORIGIN);
+
+		default:
+			// Buttons and the wheel arrive in order.
+			return 0;
+	}
+}
+
+static void record_arrival(bench_path_id id, uiohook_event * const event, uint64_t arrival) {
+	bench_path *path = &paths[id];
+
+	size_t tag = event_tag(id, event);
+	if (tag == SIZE_MAX) {
+		return;
+	}
+
+	// Skip ahead to the next injected event with this tag.  Events skipped
+	// over were lost.
+	size_t index = path->next + (tag + path->cycle - path->next % path->cycle) % path->cycle;
+	if (index >= __atomic_load_n(&path->posted, __ATOMIC_ACQUIRE)) {
+		// Not injected by us.
+		return;
+	}
+
+	uint64_t latency = arrival - path->post_time[index];
+	path->latency[path->received++] = latency;
+	path->next = index + 1;
+
+	unsigned int bucket = 0;
+	uint64_t us = latency / 1000;
+	while (us > 0 && bucket < LATENCY_BUCKETS - 1) {
+		us >>= 1;
+		bucket++;
+	}
+	path->histogram[bucket]++;
+}
+
+void dispatch_proc(uiohook_event * const event) {
+	uint64_t arrival = now_ns();
+
+	switch (event->type) {
+		case EVENT_HOOK_ENABLED:
+			pthread_mutex_lock(&hook_control_mutex);
+			hook_enabled = true;
+			pthread_cond_signal(&hook_control_cond);
+			pthread_mutex_unlock(&hook_control_mutex);
+			break;
+
+		case EVENT_HOOK_DISABLED:
+			break;
+
+		default: {
+			bench_path_id id = __atomic_load_n(&current_path, __ATOMIC_ACQUIRE);
+			if (id != PATH_COUNT && event->type == paths[id].type) {
+				record_arrival(id, event, arrival);
+			}
+			break;
+		}
+	}
+}
+
+void *hook_thread_proc(void *arg) {
+	int status = hook_run();
+
+	// Wake up main() if the hook failed to start.
+	pthread_mutex_lock(&hook_control_mutex);
+	hook_status = status;
+	hook_exited = true;
+	pthread_cond_signal(&hook_control_cond);
+	pthread_mutex_unlock(&hook_control_mutex);
+
+	return arg;
+}
+
+static int hook_enable() {
+	pthread_mutex_lock(&hook_control_mutex);
+	if (pthread_create(&hook_thread, NULL, hook_thread_proc, NULL) != 0) {
+		pthread_mutex_unlock(&hook_control_mutex);
+		return UIOHOOK_FAILURE;
+	}
+
+	while (!hook_enabled && !hook_exited) {
+		pthread_cond_wait(&hook_control_cond, &hook_control_mutex);
+	}
+	int status = hook_enabled ? UIOHOOK_SUCCESS : hook_status;
+	if (status == UIOHOOK_SUCCESS && !hook_enabled) {
+		status = UIOHOOK_FAILURE;
+	}
+	pthread_mutex_unlock(&hook_control_mutex);
+
+	if (status != UIOHOOK_SUCCESS) {
+		pthread_join(hook_thread, NULL);
+	}
+
+	return status;
+}
+
+// Post the event with the given index on a path.  Events that are not timed,
+// like key releases, are posted right after.
+static void post_event(bench_path_id id, size_t index) {
+	uiohook_event event;
+	memset(&event, 0, sizeof(event));
+
+	switch (id) {
+		case PATH_KEY:
+			event.type = EVENT_KEY_PRESSED;
+			event.data.keyboard.keycode = bench_keys[index % BENCH_KEY_COUNT];
+			event.data.keyboard.keychar = CHAR_UNDEFINED;
+			break;
+
+		case PATH_BUTTON:
+			event.type = EVENT_MOUSE_PRESSED;
+			event.data.mouse.button = MOUSE_BUTTON1;
+			event.data.mouse.x = BUTTON_X;
+			event.data.mouse.y = BUTTON_Y;
+			break;
+
+		case PATH_MOTION:
+			event.type = EVENT_MOUSE_MOVED;
+			event.data.mouse.x = MOTION_ORIGIN + index % MOTION_WIDTH;
+			event.data.mouse.y = MOTION_ORIGIN + (index / MOTION_WIDTH) % MOTION_HEIGHT;
+			break;
+
+		default:
+			event.type = EVENT_MOUSE_WHEEL;
+			event.data.wheel.x = BUTTON_X;
+			event.data.wheel.y = BUTTON_Y;
+			event.data.wheel.type = WHEEL_UNIT_SCROLL;
+			event.data.wheel.amount = 3;
+			event.data.wheel.rotation = index % 2 == 0 ? 1 : -1;
+			event.data.wheel.direction = WHEEL_VERTICAL_DIRECTION;
+			break;
+	}
+
+	bench_path *path = &paths[id];
+	path->post_time[index] = now_ns();
+	__atomic_store_n(&path->posted, index + 1, __ATOMIC_RELEASE);
+
+	hook_post_event(&event);
+
+	if (event.type == EVENT_KEY_PRESSED) {
+		event.type = EVENT_KEY_RELEASED;
+		hook_post_event(&event);
+	}
+	else if (event.type == EVENT_MOUSE_PRESSED) {
+		event.type = EVENT_MOUSE_RELEASED;
+		hook_post_event(&event);
+	}
+}
+
+static void run_path(bench_path_id id, unsigned int rate, size_t count) {
+	// Park the pointer where buttons and the wheel are injected.
+	uiohook_event park;
+	memset(&park, 0, sizeof(park));
+	park.type = EVENT_MOUSE_MOVED;
+	park.data.mouse.x = BUTTON_X;
+	park.data.mouse.y = BUTTON_Y;
+	hook_post_event(&park);
+	sleep_until(now_ns() + DRAIN_NS);
+
+	__atomic_store_n(&current_path, id, __ATOMIC_RELEASE);
+
+	uint64_t period = 1000000000 / rate;
+	uint64_t deadline = now_ns();
+	size_t i;
+	for (i = 0; i < count; i++) {
+		sleep_until(deadline);
+		post_event(id, i);
+		deadline += period;
+	}
+
+	sleep_until(now_ns() + DRAIN_NS);
+	__atomic_store_n(&current_path, PATH_COUNT, __ATOMIC_RELEASE);
+}
+
+static int compare_latency(const void *a, const void *b) {
+	uint64_t x = *(const uint64_t *) a, y = *(const uint64_t *) b;
+
+	return (x > y) - (x < y);
+}
+
+static double percentile_us(bench_path *path, double p) {
+	if (path->received == 0) {
+		return 0.0;
+	}
+
+	size_t i = (size_t) (path->received * p);
+	if (i >= path->received) {
+		i = path->received - 1;
+	}
+
+	return path->latency[i] / 1000.0;
+}
+
+static void report(unsigned int rate) {
+	fprintf(stdout, "Latency from hook_post_event() to the dispatcher at %u events per second, in us.\n\n", rate);
+	fprintf(stdout, "%-8s %8s %8s %6s %9s %9s %9s %9s %9s\n",
+			"path", "posted", "received", "lost", "min", "p50", "p90", "p99", "max");
+
+	unsigned int id;
+	for (id = 0; id < PATH_COUNT; id++) {
+		bench_path *path = &paths[id];
+		qsort(path->latency, path->received, sizeof(uint64_t), compare_latency);
+
+		fprintf(stdout, "%-8s %8zu %8zu %6zu %9.1f %9.1f %9.1f %9.1f %9.1f\n",
+				path->name, path->posted, path->received, path->posted - path->received,
+				percentile_us(path, 0.0), percentile_us(path, 0.5), percentile_us(path, 0.9),
+				percentile_us(path, 0.99), percentile_us(path, 1.0));
+	}
+
+	for (id = 0; id < PATH_COUNT; id++) {
+		bench_path *path = &paths[id];
+		fprintf(stdout, "\n%s\n", path->name);
+
+		uint64_t most = 1;
+		unsigned int bucket;
+		for (bucket = 0; bucket < LATENCY_BUCKETS; bucket++) {
+			if (path->histogram[bucket] > most) {
+				most = path->histogram[bucket];
+			}
+		}
+
+		for (bucket = 0; bucket < LATENCY_BUCKETS; bucket++) {
+			if (path->histogram[bucket] == 0) {
+				continue;
+			}
+
+			char bar[41] = { 0 };
+			memset(bar, '#', (size_t) (path->histogram[bucket] * 40 / most));
+			fprintf(stdout, "  < %8" PRIu64 " us %8" PRIu64 " %s\n",
+					(uint64_t) 1 << bucket, path->histogram[bucket], bar);
+		}
+	}
+}
+
+// Run this program again against a private Xvfb, without the -x option.
+static int run_in_xvfb(int argc, char *argv[]) {
+	char display[16];
+	snprintf(display, sizeof(display), ":%d", XVFB_DISPLAY);
+
+	pid_t server = fork();
+	if (server == 0) {
+		int null = open("/dev/null", O_WRONLY);
+		if (null >= 0) {
+			dup2(null, STDOUT_FILENO);
+			dup2(null, STDERR_FILENO);
+		}
+		execlp("Xvfb", "Xvfb", display, "-screen", "0", "1024x768x24", "-nolisten", "tcp", (char *) NULL);
+		_exit(127);
+	}
+	else if (server < 0) {
+		logger_proc(LOG_LEVEL_ERROR, "Failed to start Xvfb. (%d)\n", errno);
+		return EXIT_FAILURE;
+	}
+
+	// Wait for the server socket to show up.
+	char socket_path[64];
+	snprintf(socket_path, sizeof(socket_path), "/tmp/.X11-unix/X%d", XVFB_DISPLAY);
+	int tries;
+	for (tries = 0; tries < 100 && access(socket_path, F_OK) != 0; tries++) {
+		sleep_until(now_ns() + 50000000);
+	}
+
+	int status = EXIT_FAILURE;
+	if (access(socket_path, F_OK) == 0) {
+		setenv("DISPLAY", display, 1);
+
+		char **args = calloc(argc + 1, sizeof(char *));
+		int i, count = 0;
+		for (i = 0; i < argc; i++) {
+			if (strcmp(argv[i], "-x") != 0) {
+				args[count++] = argv[i];
+			}
+		}
+
+		pid_t bench = fork();
+		if (bench == 0) {
+			execv("/proc/self/exe", args);
+			_exit(127);
+		}
+		else if (bench > 0) {
+			int bench_status;
+			waitpid(bench, &bench_status, 0);
+			if (WIFEXITED(bench_status)) {
+				status = WEXITSTATUS(bench_status);
+			}
+		}
+
+		free(args);
+	}
+	else {
+		logger_proc(LOG_LEVEL_ERROR, "Xvfb did not come up on %s.\n", display);
+	}
+
+	kill(server, SIGTERM);
+	waitpid(server, NULL, 0);
+
+	return status;
+}
+
+int main(int argc, char *argv[]) {
+	unsigned int rate = 1000;
+	size_t count = 2000;
+	hook_backend backend = HOOK_BACKEND_DEFAULT;
+
+	int i;
+	for (i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "-x") == 0) {
+			return run_in_xvfb(argc, argv);
+		}
+		else if (strcmp(argv[i], "-r") == 0 && i + 1 < argc) {
+			rate = (unsigned int) strtoul(argv[++i], NULL, 10);
+		}
+		else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+			count = strtoul(argv[++i], NULL, 10);
+		}
+		else if (strcmp(argv[i], "-b") == 0 && i + 1 < argc) {
+			i++;
+			if (strcmp(argv[i], "xrecord") == 0) {
+				backend = HOOK_BACKEND_XRECORD;
+			}
+			else if (strcmp(argv[i], "xcb-record") == 0) {
+				backend = HOOK_BACKEND_XCB_RECORD;
+			}
+			else if (strcmp(argv[i], "xinput2") == 0) {
+				backend = HOOK_BACKEND_XINPUT2;
+			}
+			else {
+				logger_proc(LOG_LEVEL_ERROR, "Unknown backend %s.\n", argv[i]);
+				return EXIT_FAILURE;
+			}
+		}
+		else {
+			logger_proc(LOG_LEVEL_ERROR, "Usage: %s [-x] [-r rate] [-n count] [-b backend]\n", argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (rate == 0 || count == 0 || count > MOTION_WIDTH * MOTION_HEIGHT) {
+		logger_proc(LOG_LEVEL_ERROR, "Rate and count must be positive, and count at most %u.\n",
+				MOTION_WIDTH * MOTION_HEIGHT);
+		return EXIT_FAILURE;
+	}
+
+	unsigned int id;
+	for (id = 0; id < PATH_COUNT; id++) {
+		paths[id].post_time = calloc(count, sizeof(uint64_t));
+		paths[id].latency = calloc(count, sizeof(uint64_t));
+		if (paths[id].post_time == NULL || paths[id].latency == NULL) {
+			logger_proc(LOG_LEVEL_ERROR, "Failed to allocate memory.\n");
+			return EXIT_FAILURE;
+		}
+	}
+
+	hook_set_logger_proc(&logger_proc);
+	hook_set_dispatch_proc(&dispatch_proc);
+
+	int status = hook_set_backend(backend);
+	if (status == UIOHOOK_SUCCESS) {
+		status = hook_enable();
+	}
+
+	if (status != UIOHOOK_SUCCESS) {
+		logger_proc(LOG_LEVEL_ERROR, "Failed to start the hook. (%#X)\n", status);
+		return EXIT_FAILURE;
+	}
+
+	for (id = 0; id < PATH_COUNT; id++) {
+		run_path(id, rate, count);
+	}
+
+	hook_stop();
+	pthread_join(hook_thread, NULL);
+
+	report(rate);
+
+	for (id = 0; id < PATH_COUNT; id++) {
+		free(paths[id].post_time);
+		free(paths[id].latency);
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -28,6 +28,7 @@
 #endif
 #include <pthread.h>
 #include <stdbool.h>
+#include <string.h>
 #include <sys/time.h>
 #include <uiohook.h>
 
@@ -50,6 +51,12 @@ CFRunLoopRef event_loop;
 // Flag to restart the event tap incase of timeout.
 static Boolean restart_tap = false;
 
+// Event tap of the running hook and whether hook_pause() disabled it, both
+// guarded by tap_mutex so other threads can toggle the tap.
+static CFMachPortRef tap_port = NULL;
+static bool tap_paused = false;
+static pthread_mutex_t tap_mutex = PTHREAD_MUTEX_INITIALIZER;
+
 // Modifiers for tracking key masks.
 static uint16_t current_modifiers = 0x0000;
 
@@ -92,6 +99,10 @@ static uiohook_event event;
 // Event dispatch callback.
 static dispatcher_t dispatcher = NULL;
 
+// Event types requested with hook_set_event_mask().  Written by any thread and
+// read by the hook thread for every event.
+static uint32_t dispatch_event_mask = EVENT_MASK_ALL;
+
 static unsigned short int grab_mouse_click_event = 0x00;
 
 UIOHOOK_API void hook_set_dispatch_proc(dispatcher_t dispatch_proc) {
@@ -103,6 +114,11 @@ UIOHOOK_API void hook_set_dispatch_proc(dispatcher_t dispatch_proc) {
 
 // Send out an event if a dispatcher was set.
 static inline void dispatch_event(uiohook_event *const event) {
+	if (event->type > EVENT_HOOK_DISABLED && !(__atomic_load_n(&dispatch_event_mask, __ATOMIC_RELAXED) & EVENT_MASK(event->type))) {
+		// Nobody asked for this event type.
+		return;
+	}
+
 	if (dispatcher != NULL) {
 		logger(LOG_LEVEL_DEBUG,	"%s [%u]: Dispatching event type %u.\n",
 				__FUNCTION__, __LINE__, event->type);
@@ -1170,6 +1186,15 @@ UIOHOOK_API int hook_run() {
 				if (hook->port != NULL) {
 					logger(LOG_LEVEL_DEBUG,	"%s [%u]: CGEventTapCreate Successful.\n",
 							__FUNCTION__, __LINE__);
+
+					// Publish the tap, keeping it disabled if it was restarted
+					// while paused.
+					pthread_mutex_lock(&tap_mutex);
+					tap_port = hook->port;
+					if (tap_paused) {
+						CGEventTapEnable(hook->port, false);
+					}
+					pthread_mutex_unlock(&tap_mutex);
 					
 					// Create the runloop event source from the event tap.
 					hook->source = CFMachPortCreateRunLoopSource(kCFAllocatorDefault, hook->port, 0);
@@ -1312,6 +1337,10 @@ UIOHOOK_API int hook_run() {
 						status = UIOHOOK_ERROR_CREATE_RUN_LOOP_SOURCE;
 					}
 					
+					pthread_mutex_lock(&tap_mutex);
+					tap_port = NULL;
+					pthread_mutex_unlock(&tap_mutex);
+
 					// Stop the CFMachPort from receiving any more messages.
 					CFMachPortInvalidate(hook->port);
 					CFRelease(hook->port);
@@ -1331,6 +1360,10 @@ UIOHOOK_API int hook_run() {
 				status = UIOHOOK_ERROR_OUT_OF_MEMORY;
 			}
 		} while (restart_tap);
+
+		pthread_mutex_lock(&tap_mutex);
+		tap_paused = false;
+		pthread_mutex_unlock(&tap_mutex);
 	}
 	else {
 		logger(LOG_LEVEL_ERROR,	"%s [%u]: Accessibility API is disabled!\n",
@@ -1367,3 +1400,93 @@ UIOHOOK_API int hook_stop() {
 
 	return status;
 }
+
+UIOHOOK_API int hook_pause() {
+	int status = UIOHOOK_FAILURE;
+
+	pthread_mutex_lock(&tap_mutex);
+	if (tap_port != NULL) {
+		// A disabled tap is skipped by the window server, so nothing reaches
+		// hook_event_proc until it is enabled again.
+		if (!tap_paused) {
+			CGEventTapEnable(tap_port, false);
+			tap_paused = true;
+		}
+
+		status = UIOHOOK_SUCCESS;
+	}
+	pthread_mutex_unlock(&tap_mutex);
+
+	logger(LOG_LEVEL_DEBUG,	"%s [%u]: Status: %#X.\n",
+			__FUNCTION__, __LINE__, status);
+
+	return status;
+}
+
+UIOHOOK_API int hook_resume() {
+	int status = UIOHOOK_FAILURE;
+
+	pthread_mutex_lock(&tap_mutex);
+	if (tap_port != NULL) {
+		if (tap_paused) {
+			// Modifiers may have changed while the tap was disabled.  The hook
+			// thread is idle until the tap is enabled.
+			initialize_modifiers();
+
+			CGEventTapEnable(tap_port, true);
+			tap_paused = false;
+		}
+
+		status = UIOHOOK_SUCCESS;
+	}
+	pthread_mutex_unlock(&tap_mutex);
+
+	logger(LOG_LEVEL_DEBUG,	"%s [%u]: Status: %#X.\n",
+			__FUNCTION__, __LINE__, status);
+
+	return status;
+}
+
+UIOHOOK_API int hook_set_event_mask(uint32_t mask) {
+	// The hook still sees every event, unwanted ones are dropped before they
+	// are dispatched.
+	__atomic_store_n(&dispatch_event_mask, mask, __ATOMIC_RELAXED);
+
+	logger(LOG_LEVEL_DEBUG, "%s [%u]: Event mask: %#X.\n",
+			__FUNCTION__, __LINE__, mask);
+
+	return UIOHOOK_SUCCESS;
+}
+
+UIOHOOK_API int hook_set_backend(hook_backend backend) {
+	// There is only one way to hook input on this platform.
+	int status = UIOHOOK_SUCCESS;
+	if (backend != HOOK_BACKEND_DEFAULT) {
+		status = UIOHOOK_ERROR_BACKEND_UNSUPPORTED;
+	}
+
+	logger(LOG_LEVEL_DEBUG, "%s [%u]: Backend: %u, status: %#X.\n",
+			__FUNCTION__, __LINE__, backend, status);
+
+	return status;
+}
+
+UIOHOOK_API int hook_set_synthetic_options(const synthetic_options *options) {
+	// The synthetic backend is only built for X11.
+	logger(LOG_LEVEL_DEBUG, "%s [%u]: Synthetic backend unsupported.\n",
+			__FUNCTION__, __LINE__);
+
+	return UIOHOOK_ERROR_BACKEND_UNSUPPORTED;
+}
+
+UIOHOOK_API uint64_t hook_get_input_time() {
+	// Input is not timestamped on receipt on this platform.
+	return 0;
+}
+
+UIOHOOK_API int hook_get_stats(hook_stats *stats) {
+	// The hook does not keep counters on this platform.
+	memset(stats, 0, sizeof(hook_stats));
+
+	return UIOHOOK_ERROR_BACKEND_UNSUPPORTED;
+}
@@ -119,6 +119,16 @@ UIOHOOK_API screen_data* hook_create_screen_info(unsigned char *count) {
 	return screens;
 }
 
+UIOHOOK_API void hook_get_system_properties(system_properties *properties) {
+	// Every property is a cheap local call here, so nothing is cached.
+	properties->auto_repeat_rate = hook_get_auto_repeat_rate();
+	properties->auto_repeat_delay = hook_get_auto_repeat_delay();
+	properties->pointer_acceleration_multiplier = hook_get_pointer_acceleration_multiplier();
+	properties->pointer_acceleration_threshold = hook_get_pointer_acceleration_threshold();
+	properties->pointer_sensitivity = hook_get_pointer_sensitivity();
+	properties->multi_click_time = hook_get_multi_click_time();
+}
+
 /*
  * Apple's documentation is not very good.  I was finally able to find this
  * information after many hours of googling.  Value is the slider value in the
@@ -0,0 +1,658 @@
+/* libUIOHook: Cross-platfrom userland keyboard and mouse hooking.
+ * Copyright (C) 2006-2017 Alexander Barker.  All Rights Received.
+ * https://github.com/kwhat/libuiohook/
+ *
+ * libUIOHook is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libUIOHook is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Synthetic event source behind HOOK_BACKEND_SYNTHETIC.
+ *
+ * Events are generated on the hook thread at fixed rates, or replayed from a
+ * file as fast as the dispatcher takes them, and go through the same dispatch
+ * path as input from the platform.  Nothing here talks to a display server, so
+ * everything above the hook can be benchmarked and profiled on a headless box.
+ *
+ * A replay file has one event per line, '#' starts a comment:
+ *   key_pressed <keycode>
+ *   key_released <keycode>
+ *   key_typed <keycode> <keychar>
+ *   mouse_moved <x> <y>
+ *   mouse_dragged <x> <y>
+ *   mouse_pressed <button> <x> <y> [clicks]
+ *   mouse_released <button> <x> <y> [clicks]
+ *   mouse_clicked <button> <x> <y> [clicks]
+ *   mouse_wheel <rotation> <x> <y> [amount]
+ * Numbers may be given in decimal or with a 0x prefix.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <errno.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <uiohook.h>
+
+#include "logger.h"
+
+// Events posted with hook_post_event() that were not dispatched yet.
+#define SYNTHETIC_POST_CAPACITY 256
+
+// Size of the area the generated pointer moves in.
+#define SYNTHETIC_SCREEN_WIDTH 1024
+#define SYNTHETIC_SCREEN_HEIGHT 768
+
+// Keys typed by the key bursts, in turn.
+static const struct {
+	uint16_t keycode;
+	uint16_t keychar;
+} synthetic_keys[] = {
+	{ VC_A, 'a' }, { VC_B, 'b' }, { VC_C, 'c' }, { VC_D, 'd' },
+	{ VC_E, 'e' }, { VC_F, 'f' }, { VC_G, 'g' }, { VC_H, 'h' },
+	{ VC_I, 'i' }, { VC_J, 'j' }, { VC_K, 'k' }, { VC_L, 'l' },
+	{ VC_M, 'm' }, { VC_N, 'n' }, { VC_O, 'o' }, { VC_P, 'p' },
+	{ VC_Q, 'q' }, { VC_R, 'r' }, { VC_S, 's' }, { VC_T, 't' },
+	{ VC_U, 'u' }, { VC_V, 'v' }, { VC_W, 'w' }, { VC_X, 'x' },
+	{ VC_Y, 'y' }, { VC_Z, 'z' }
+};
+
+#define SYNTHETIC_KEY_COUNT (sizeof(synthetic_keys) / sizeof(synthetic_keys[0]))
+
+// Event names used by replay files.
+static const struct {
+	const char *name;
+	event_type type;
+} synthetic_names[] = {
+	{ "key_pressed", EVENT_KEY_PRESSED },
+	{ "key_released", EVENT_KEY_RELEASED },
+	{ "key_typed", EVENT_KEY_TYPED },
+	{ "mouse_moved", EVENT_MOUSE_MOVED },
+	{ "mouse_dragged", EVENT_MOUSE_DRAGGED },
+	{ "mouse_pressed", EVENT_MOUSE_PRESSED },
+	{ "mouse_released", EVENT_MOUSE_RELEASED },
+	{ "mouse_clicked", EVENT_MOUSE_CLICKED },
+	{ "mouse_wheel", EVENT_MOUSE_WHEEL }
+};
+
+// One generated event stream.
+typedef struct _synthetic_stream {
+	// Nanoseconds between events, 0 if the stream is disabled.
+	uint64_t period;
+	// Monotonic time the next event is due.
+	uint64_t next;
+	// Events generated so far.
+	uint64_t count;
+} synthetic_stream;
+
+// NOTE Everything below is guarded by synthetic_mutex.
+static pthread_mutex_t synthetic_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t synthetic_cond;
+static pthread_once_t synthetic_once = PTHREAD_ONCE_INIT;
+
+static bool running = false;
+static bool paused = false;
+
+// Set with hook_set_synthetic_options(), used by the next hook_run().
+static synthetic_options options = {
+	.motion_rate = 0,
+	.key_rate = 0,
+	.key_burst = 1,
+	.wheel_rate = 0,
+	.duration = 0,
+	.replay_file = NULL
+};
+
+static uiohook_event posted[SYNTHETIC_POST_CAPACITY];
+static size_t posted_head = 0;
+static size_t posted_count = 0;
+
+// Modifier and button state of the synthetic devices.  Hook thread only.
+static uint16_t current_mask = 0x0000;
+
+static void synthetic_init() {
+	// Deadlines are taken from the monotonic clock, so wait on it as well.
+	pthread_condattr_t attr;
+	pthread_condattr_init(&attr);
+	pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+	pthread_cond_init(&synthetic_cond, &attr);
+	pthread_condattr_destroy(&attr);
+}
+
+static inline uint64_t synthetic_now() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+// Wait for a signal or until the monotonic time deadline.
+// NOTE Must be called with synthetic_mutex held.
+static void synthetic_wait(uint64_t deadline) {
+	if (deadline == UINT64_MAX) {
+		pthread_cond_wait(&synthetic_cond, &synthetic_mutex);
+	}
+	else {
+		struct timespec ts;
+		ts.tv_sec = deadline / 1000000000;
+		ts.tv_nsec = deadline % 1000000000;
+		pthread_cond_timedwait(&synthetic_cond, &synthetic_mutex, &ts);
+	}
+}
+
+static uint16_t modifier_mask(uint16_t keycode) {
+	switch (keycode) {
+		case VC_SHIFT_L:	return MASK_SHIFT_L;
+		case VC_SHIFT_R:	return MASK_SHIFT_R;
+		case VC_CONTROL_L:	return MASK_CTRL_L;
+		case VC_CONTROL_R:	return MASK_CTRL_R;
+		case VC_META_L:		return MASK_META_L;
+		case VC_META_R:		return MASK_META_R;
+		case VC_ALT_L:		return MASK_ALT_L;
+		case VC_ALT_R:		return MASK_ALT_R;
+	}
+
+	return 0x0000;
+}
+
+static uint16_t button_mask(uint16_t button) {
+	switch (button) {
+		case MOUSE_BUTTON1:	return MASK_BUTTON1;
+		case MOUSE_BUTTON2:	return MASK_BUTTON2;
+		case MOUSE_BUTTON3:	return MASK_BUTTON3;
+		case MOUSE_BUTTON4:	return MASK_BUTTON4;
+		case MOUSE_BUTTON5:	return MASK_BUTTON5;
+	}
+
+	return 0x0000;
+}
+
+// Track the modifier and button state like the platform hooks do, stamp the
+// event and dispatch it.
+static void synthetic_dispatch(dispatcher_t dispatch, uiohook_event *const event, uint64_t now) {
+	switch (event->type) {
+		case EVENT_KEY_PRESSED:
+			current_mask |= modifier_mask(event->data.keyboard.keycode);
+			break;
+
+		case EVENT_KEY_RELEASED:
+			current_mask &= ~modifier_mask(event->data.keyboard.keycode);
+			break;
+
+		case EVENT_MOUSE_PRESSED:
+			current_mask |= button_mask(event->data.mouse.button);
+			break;
+
+		case EVENT_MOUSE_RELEASED:
+			current_mask &= ~button_mask(event->data.mouse.button);
+			break;
+
+		default:
+			break;
+	}
+
+	event->time = now / 1000000;
+	event->mask = current_mask;
+	event->reserved = 0x00;
+
+	dispatch(event);
+}
+
+static void synthetic_key(dispatcher_t dispatch, event_type type, uint16_t keycode, uint16_t keychar, uint64_t now) {
+	uiohook_event event;
+	event.type = type;
+	event.data.keyboard.keycode = keycode;
+	event.data.keyboard.rawcode = 0x00;
+	event.data.keyboard.keychar = keychar;
+
+	synthetic_dispatch(dispatch, &event, now);
+}
+
+// Type one burst of keys, holding shift for every fourth burst.
+static void synthetic_key_burst(dispatcher_t dispatch, synthetic_stream *stream, uint16_t burst, uint64_t now) {
+	bool shifted = stream->count % 4 == 3;
+	if (shifted) {
+		synthetic_key(dispatch, EVENT_KEY_PRESSED, VC_SHIFT_L, CHAR_UNDEFINED, now);
+	}
+
+	uint16_t i;
+	for (i = 0; i < burst; i++) {
+		size_t key = (stream->count * burst + i) % SYNTHETIC_KEY_COUNT;
+		uint16_t keycode = synthetic_keys[key].keycode;
+		uint16_t keychar = synthetic_keys[key].keychar;
+		if (shifted) {
+			keychar -= 'a' - 'A';
+		}
+
+		synthetic_key(dispatch, EVENT_KEY_PRESSED, keycode, CHAR_UNDEFINED, now);
+		synthetic_key(dispatch, EVENT_KEY_TYPED, keycode, keychar, now);
+		synthetic_key(dispatch, EVENT_KEY_RELEASED, keycode, CHAR_UNDEFINED, now);
+	}
+
+	if (shifted) {
+		synthetic_key(dispatch, EVENT_KEY_RELEASED, VC_SHIFT_L, CHAR_UNDEFINED, now);
+	}
+}
+
+// Sweep the pointer across the synthetic screen one pixel per move, row by
+// row, so the position of a move tells its number.
+static void synthetic_motion(dispatcher_t dispatch, synthetic_stream *stream, uint64_t now) {
+	uiohook_event event;
+	event.type = EVENT_MOUSE_MOVED;
+	event.data.mouse.button = MOUSE_NOBUTTON;
+	event.data.mouse.clicks = 0;
+	event.data.mouse.x = stream->count % SYNTHETIC_SCREEN_WIDTH;
+	event.data.mouse.y = (stream->count / SYNTHETIC_SCREEN_WIDTH) % SYNTHETIC_SCREEN_HEIGHT;
+
+	synthetic_dispatch(dispatch, &event, now);
+}
+
+// Scroll down and up again, eight clicks at a time.
+static void synthetic_wheel(dispatcher_t dispatch, synthetic_stream *stream, uint64_t now) {
+	uiohook_event event;
+	event.type = EVENT_MOUSE_WHEEL;
+	event.data.wheel.clicks = 1;
+	event.data.wheel.x = SYNTHETIC_SCREEN_WIDTH / 2;
+	event.data.wheel.y = SYNTHETIC_SCREEN_HEIGHT / 2;
+	event.data.wheel.type = WHEEL_UNIT_SCROLL;
+	event.data.wheel.amount = 3;
+	event.data.wheel.rotation = (stream->count / 8) % 2 == 0 ? 1 : -1;
+	event.data.wheel.direction = WHEEL_VERTICAL_DIRECTION;
+
+	synthetic_dispatch(dispatch, &event, now);
+}
+
+// Parse one replay file line into an event.  Returns false for blank lines,
+// comments and lines that could not be parsed.
+static bool synthetic_parse_line(const char *line, unsigned int number, uiohook_event *event) {
+	char name[32];
+	long int args[4] = { 0, 0, 0, 0 };
+	int fields = sscanf(line, " %31s %li %li %li %li", name, &args[0], &args[1], &args[2], &args[3]);
+	if (fields < 1 || name[0] == '#') {
+		return false;
+	}
+
+	size_t i;
+	for (i = 0; i < sizeof(synthetic_names) / sizeof(synthetic_names[0]); i++) {
+		if (strcmp(name, synthetic_names[i].name) == 0) {
+			break;
+		}
+	}
+
+	if (i == sizeof(synthetic_names) / sizeof(synthetic_names[0])) {
+		logger(LOG_LEVEL_WARN,	"%s [%u]: Unknown event '%s' on line %u of the replay file.\n",
+				__FUNCTION__, __LINE__, name, number);
+
+		return false;
+	}
+
+	event->type = synthetic_names[i].type;
+	switch (event->type) {
+		case EVENT_KEY_PRESSED:
+		case EVENT_KEY_RELEASED:
+		case EVENT_KEY_TYPED:
+			event->data.keyboard.keycode = (uint16_t) args[0];
+			event->data.keyboard.rawcode = 0x00;
+			event->data.keyboard.keychar = event->type == EVENT_KEY_TYPED ? (uint16_t) args[1] : CHAR_UNDEFINED;
+			break;
+
+		case EVENT_MOUSE_MOVED:
+		case EVENT_MOUSE_DRAGGED:
+			event->data.mouse.button = MOUSE_NOBUTTON;
+			event->data.mouse.clicks = 0;
+			event->data.mouse.x = (int16_t) args[0];
+			event->data.mouse.y = (int16_t) args[1];
+			break;
+
+		case EVENT_MOUSE_PRESSED:
+		case EVENT_MOUSE_RELEASED:
+		case EVENT_MOUSE_CLICKED:
+			event->data.mouse.button = (uint16_t) args[0];
+			event->data.mouse.x = (int16_t) args[1];
+			event->data.mouse.y = (int16_t) args[2];
+			event->data.mouse.clicks = fields > 4 ? (uint16_t) args[3] : 1;
+			break;
+
+		default:
+			event->data.wheel.rotation = (int16_t) args[0];
+			event->data.wheel.x = (int16_t) args[1];
+			event->data.wheel.y = (int16_t) args[2];
+			event->data.wheel.amount = fields > 4 ? (uint16_t) args[3] : 3;
+			event->data.wheel.clicks = 1;
+			event->data.wheel.type = WHEEL_UNIT_SCROLL;
+			event->data.wheel.direction = WHEEL_VERTICAL_DIRECTION;
+			break;
+	}
+
+	return true;
+}
+
+// Read every event of a replay file up front, so that replaying is not slowed
+// down by parsing.
+static int synthetic_load(const char *path, uiohook_event **events, size_t *count) {
+	FILE *file = fopen(path, "r");
+	if (file == NULL) {
+		logger(LOG_LEVEL_ERROR,	"%s [%u]: Failed to open replay file %s! (%d)\n",
+				__FUNCTION__, __LINE__, path, errno);
+
+		return UIOHOOK_FAILURE;
+	}
+
+	int status = UIOHOOK_SUCCESS;
+	size_t capacity = 0;
+	*events = NULL;
+	*count = 0;
+
+	char line[256];
+	unsigned int number = 0;
+	while (fgets(line, sizeof(line), file) != NULL) {
+		number++;
+
+		uiohook_event event;
+		if (!synthetic_parse_line(line, number, &event)) {
+			continue;
+		}
+
+		if (*count == capacity) {
+			capacity = capacity > 0 ? capacity * 2 : 1024;
+			uiohook_event *grown = realloc(*events, capacity * sizeof(uiohook_event));
+			if (grown == NULL) {
+				logger(LOG_LEVEL_ERROR,	"%s [%u]: Failed to allocate memory for replay events!\n",
+						__FUNCTION__, __LINE__);
+
+				status = UIOHOOK_ERROR_OUT_OF_MEMORY;
+				break;
+			}
+			*events = grown;
+		}
+
+		(*events)[(*count)++] = event;
+	}
+
+	fclose(file);
+
+	if (status != UIOHOOK_SUCCESS) {
+		free(*events);
+		*events = NULL;
+		*count = 0;
+	}
+	else {
+		logger(LOG_LEVEL_DEBUG,	"%s [%u]: Loaded %zu events from %s.\n",
+				__FUNCTION__, __LINE__, *count, path);
+	}
+
+	return status;
+}
+
+static void synthetic_hook_event(dispatcher_t dispatch, event_type type, uint64_t now) {
+	uiohook_event event;
+	event.type = type;
+	event.time = now / 1000000;
+	event.mask = 0x00;
+	event.reserved = 0x00;
+
+	dispatch(&event);
+}
+
+static inline void synthetic_stream_start(synthetic_stream *stream, uint32_t rate, uint64_t start) {
+	stream->period = rate > 0 ? 1000000000 / rate : 0;
+	stream->next = start;
+	stream->count = 0;
+}
+
+// Run the synthetic event source on the calling thread until
+// synthetic_hook_stop() is called.
+int synthetic_hook_run(dispatcher_t dispatch) {
+	pthread_once(&synthetic_once, synthetic_init);
+
+	int status = UIOHOOK_SUCCESS;
+	uiohook_event *replay = NULL;
+	size_t replay_count = 0, replay_index = 0;
+
+	pthread_mutex_lock(&synthetic_mutex);
+	synthetic_options run_options = options;
+	if (options.replay_file != NULL) {
+		status = synthetic_load(options.replay_file, &replay, &replay_count);
+	}
+
+	if (status != UIOHOOK_SUCCESS) {
+		pthread_mutex_unlock(&synthetic_mutex);
+		return status;
+	}
+
+	running = true;
+	paused = false;
+	posted_head = 0;
+	posted_count = 0;
+	pthread_mutex_unlock(&synthetic_mutex);
+
+	uint64_t now = synthetic_now();
+	uint64_t end = run_options.duration > 0 ? now + run_options.duration * (uint64_t) 1000000 : UINT64_MAX;
+	bool replaying = replay_count > 0;
+
+	synthetic_stream motion, keys, wheel;
+	synthetic_stream_start(&motion, replaying ? 0 : run_options.motion_rate, now);
+	synthetic_stream_start(&keys, replaying ? 0 : run_options.key_rate, now);
+	synthetic_stream_start(&wheel, replaying ? 0 : run_options.wheel_rate, now);
+	synthetic_stream *streams[] = { &motion, &keys, &wheel };
+
+	current_mask = 0x0000;
+	synthetic_hook_event(dispatch, EVENT_HOOK_ENABLED, now);
+
+	pthread_mutex_lock(&synthetic_mutex);
+	while (running) {
+		if (paused) {
+			uint64_t paused_at = synthetic_now();
+			while (running && paused) {
+				pthread_cond_wait(&synthetic_cond, &synthetic_mutex);
+			}
+
+			// Pausing stops the clock of the generated streams.
+			uint64_t idle = synthetic_now() - paused_at;
+			size_t i;
+			for (i = 0; i < 3; i++) {
+				streams[i]->next += idle;
+			}
+			if (end != UINT64_MAX) {
+				end += idle;
+			}
+			continue;
+		}
+
+		if (posted_count > 0) {
+			uiohook_event event = posted[posted_head];
+			posted_head = (posted_head + 1) % SYNTHETIC_POST_CAPACITY;
+			posted_count--;
+
+			pthread_mutex_unlock(&synthetic_mutex);
+			synthetic_dispatch(dispatch, &event, synthetic_now());
+			pthread_mutex_lock(&synthetic_mutex);
+			continue;
+		}
+
+		now = synthetic_now();
+		if (now >= end) {
+			// Done generating, only posted events are dispatched from now on.
+			replaying = false;
+			motion.period = 0;
+			keys.period = 0;
+			wheel.period = 0;
+			end = UINT64_MAX;
+		}
+
+		if (replaying) {
+			uiohook_event event = replay[replay_index];
+			replay_index = (replay_index + 1) % replay_count;
+			if (replay_index == 0 && run_options.duration == 0) {
+				// Without a duration, the file is replayed once.
+				replaying = false;
+			}
+
+			pthread_mutex_unlock(&synthetic_mutex);
+			synthetic_dispatch(dispatch, &event, now);
+			pthread_mutex_lock(&synthetic_mutex);
+			continue;
+		}
+
+		// Emit the stream that is due first.  Streams that fall behind catch up
+		// as fast as the dispatcher allows, so the average rate holds.
+		synthetic_stream *due = NULL;
+		size_t i;
+		for (i = 0; i < 3; i++) {
+			if (streams[i]->period > 0 && (due == NULL || streams[i]->next < due->next)) {
+				due = streams[i];
+			}
+		}
+
+		if (due != NULL && due->next <= now) {
+			pthread_mutex_unlock(&synthetic_mutex);
+			if (due == &motion) {
+				synthetic_motion(dispatch, due, now);
+			}
+			else if (due == &keys) {
+				synthetic_key_burst(dispatch, due, run_options.key_burst > 0 ? run_options.key_burst : 1, now);
+			}
+			else {
+				synthetic_wheel(dispatch, due, now);
+			}
+			pthread_mutex_lock(&synthetic_mutex);
+
+			due->next += due->period;
+			due->count++;
+			continue;
+		}
+
+		synthetic_wait(due != NULL && due->next < end ? due->next : end);
+	}
+
+	running = false;
+	paused = false;
+	posted_count = 0;
+	pthread_mutex_unlock(&synthetic_mutex);
+
+	synthetic_hook_event(dispatch, EVENT_HOOK_DISABLED, synthetic_now());
+
+	logger(LOG_LEVEL_DEBUG,	"%s [%u]: Generated %" PRIu64 " moves, %" PRIu64 " key bursts and %" PRIu64 " wheel events.\n",
+			__FUNCTION__, __LINE__, motion.count, keys.count, wheel.count);
+
+	free(replay);
+
+	return status;
+}
+
+bool synthetic_hook_is_running() {
+	pthread_mutex_lock(&synthetic_mutex);
+	bool is_running = running;
+	pthread_mutex_unlock(&synthetic_mutex);
+
+	return is_running;
+}
+
+int synthetic_hook_stop() {
+	int status = UIOHOOK_FAILURE;
+
+	pthread_mutex_lock(&synthetic_mutex);
+	if (running) {
+		running = false;
+		pthread_cond_signal(&synthetic_cond);
+
+		status = UIOHOOK_SUCCESS;
+	}
+	pthread_mutex_unlock(&synthetic_mutex);
+
+	return status;
+}
+
+int synthetic_hook_pause() {
+	int status = UIOHOOK_FAILURE;
+
+	pthread_mutex_lock(&synthetic_mutex);
+	if (running && !paused) {
+		paused = true;
+
+		status = UIOHOOK_SUCCESS;
+	}
+	pthread_mutex_unlock(&synthetic_mutex);
+
+	return status;
+}
+
+int synthetic_hook_resume() {
+	int status = UIOHOOK_FAILURE;
+
+	pthread_mutex_lock(&synthetic_mutex);
+	if (running && paused) {
+		paused = false;
+		pthread_cond_signal(&synthetic_cond);
+
+		status = UIOHOOK_SUCCESS;
+	}
+	pthread_mutex_unlock(&synthetic_mutex);
+
+	return status;
+}
+
+// Queue an event for the hook thread to dispatch, as if it came from a
+// device.  Returns false if the synthetic hook is not running.
+bool synthetic_post_event(uiohook_event *const event) {
+	pthread_mutex_lock(&synthetic_mutex);
+	bool is_running = running;
+	if (is_running) {
+		if (posted_count < SYNTHETIC_POST_CAPACITY) {
+			posted[(posted_head + posted_count) % SYNTHETIC_POST_CAPACITY] = *event;
+			posted_count++;
+			pthread_cond_signal(&synthetic_cond);
+		}
+		else {
+			logger(LOG_LEVEL_WARN,	"%s [%u]: Posted event queue is full, dropping event type %u.\n",
+					__FUNCTION__, __LINE__, event->type);
+		}
+	}
+	pthread_mutex_unlock(&synthetic_mutex);
+
+	return is_running;
+}
+
+UIOHOOK_API int hook_set_synthetic_options(const synthetic_options *new_options) {
+	int status = UIOHOOK_SUCCESS;
+
+	char *replay_file = NULL;
+	if (new_options->replay_file != NULL) {
+		replay_file = strdup(new_options->replay_file);
+		if (replay_file == NULL) {
+			logger(LOG_LEVEL_ERROR,	"%s [%u]: Failed to allocate memory for the replay file name!\n",
+					__FUNCTION__, __LINE__);
+
+			return UIOHOOK_ERROR_OUT_OF_MEMORY;
+		}
+	}
+
+	pthread_mutex_lock(&synthetic_mutex);
+	free((char *) options.replay_file);
+	options = *new_options;
+	options.replay_file = replay_file;
+	pthread_mutex_unlock(&synthetic_mutex);
+
+	logger(LOG_LEVEL_DEBUG,	"%s [%u]: Motion: %u Hz, keys: %u x %u Hz, wheel: %u Hz, duration: %u ms, replay: %s.\n",
+			__FUNCTION__, __LINE__, new_options->motion_rate, new_options->key_burst, new_options->key_rate,
+			new_options->wheel_rate, new_options->duration, replay_file != NULL ? replay_file : "none");
+
+	return status;
+}
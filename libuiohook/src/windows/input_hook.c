@@ -21,6 +21,7 @@
 #endif
 
 #include <inttypes.h>
+#include <string.h>
 #include <uiohook.h>
 #include <windows.h>
 
@@ -50,8 +51,20 @@ static uiohook_event event;
 // Event dispatch callback.
 static dispatcher_t dispatcher = NULL;
 
+// Event types requested with hook_set_event_mask().  Written by any thread and
+// read by the hook thread for every event.
+static volatile LONG dispatch_event_mask = (LONG) EVENT_MASK_ALL;
+
 static unsigned short int grab_mouse_click_event = 0x00;
 
+// Thread messages used to pause and resume the hook from other threads.
+#define WM_UIOHOOK_PAUSE	(WM_APP + 1)
+#define WM_UIOHOOK_RESUME	(WM_APP + 2)
+
+// Set while the keyboard and mouse hooks are removed by hook_pause().
+// Only used by the hook thread.
+static bool hook_paused = false;
+
 UIOHOOK_API void hook_set_dispatch_proc(dispatcher_t dispatch_proc) {
 	logger(LOG_LEVEL_DEBUG,	"%s [%u]: Setting new dispatch callback to %#p.\n",
 			__FUNCTION__, __LINE__, dispatch_proc);
@@ -61,6 +74,11 @@ UIOHOOK_API void hook_set_dispatch_proc(dispatcher_t dispatch_proc) {
 
 // Send out an event if a dispatcher was set.
 static inline void dispatch_event(uiohook_event *const event) {
+	if (event->type > EVENT_HOOK_DISABLED && !((uint32_t) dispatch_event_mask & EVENT_MASK(event->type))) {
+		// Nobody asked for this event type.
+		return;
+	}
+
 	if (dispatcher != NULL) {
 		logger(LOG_LEVEL_DEBUG,	"%s [%u]: Dispatching event type %u.\n",
 				__FUNCTION__, __LINE__, event->type);
@@ -630,10 +648,46 @@ LRESULT CALLBACK mouse_hook_event_proc(int nCode, WPARAM wParam, LPARAM lParam)
 }
 
 
+// Remove the keyboard and mouse hooks so paused input costs nothing.
+static void pause_running_hooks() {
+	if (keyboard_event_hhook != NULL) {
+		UnhookWindowsHookEx(keyboard_event_hhook);
+		keyboard_event_hhook = NULL;
+	}
+
+	if (mouse_event_hhook != NULL) {
+		UnhookWindowsHookEx(mouse_event_hhook);
+		mouse_event_hhook = NULL;
+	}
+
+	hook_paused = true;
+}
+
+// Reinstall the hooks removed by pause_running_hooks().
+static void resume_running_hooks() {
+	keyboard_event_hhook = SetWindowsHookEx(WH_KEYBOARD_LL, keyboard_hook_event_proc, hInst, 0);
+	mouse_event_hhook = SetWindowsHookEx(WH_MOUSE_LL, mouse_hook_event_proc, hInst, 0);
+
+	// Input that happened while paused was not seen.
+	initialize_modifiers();
+
+	if (keyboard_event_hhook == NULL || mouse_event_hhook == NULL) {
+		logger(LOG_LEVEL_ERROR,	"%s [%u]: SetWindowsHookEx() failed! (%#lX)\n",
+				__FUNCTION__, __LINE__, (unsigned long) GetLastError());
+	}
+
+	hook_paused = false;
+}
+
 // Callback function that handles events.
 void CALLBACK win_hook_event_proc(HWINEVENTHOOK hook, DWORD event, HWND hWnd, LONG idObject, LONG idChild, DWORD dwEventThread, DWORD dwmsEventTime) {
 	switch (event) {
 		case EVENT_OBJECT_NAMECHANGE:
+			if (hook_paused) {
+				// The hooks are reinstalled by hook_resume().
+				break;
+			}
+
 			logger(LOG_LEVEL_INFO, "%s [%u]: Restarting Windows input hook on window event: %#X.\n",
 					__FUNCTION__, __LINE__, event);
 
@@ -737,9 +791,24 @@ UIOHOOK_API int hook_run() {
 		// Block until the thread receives an WM_QUIT request.
 		MSG message;
 		while (GetMessage(&message, (HWND) NULL, 0, 0) > 0) {
+			if (message.hwnd == NULL && message.message == WM_UIOHOOK_PAUSE) {
+				if (!hook_paused) {
+					pause_running_hooks();
+				}
+				continue;
+			}
+			else if (message.hwnd == NULL && message.message == WM_UIOHOOK_RESUME) {
+				if (hook_paused) {
+					resume_running_hooks();
+				}
+				continue;
+			}
+
 			TranslateMessage(&message);
 			DispatchMessage(&message);
 		}
+
+		hook_paused = false;
 	}
 	else {
 		logger(LOG_LEVEL_ERROR,	"%s [%u]: SetWindowsHookEx() failed! (%#lX)\n",
@@ -772,3 +841,74 @@ UIOHOOK_API int hook_stop() {
 
 	return status;
 }
+
+UIOHOOK_API int hook_pause() {
+	int status = UIOHOOK_FAILURE;
+
+	// The hooks belong to the hook thread, so let it remove them.
+	if (PostThreadMessage(hook_thread_id, WM_UIOHOOK_PAUSE, (WPARAM) NULL, (LPARAM) NULL)) {
+		status = UIOHOOK_SUCCESS;
+	}
+
+	logger(LOG_LEVEL_DEBUG,	"%s [%u]: Status: %#X.\n",
+			__FUNCTION__, __LINE__, status);
+
+	return status;
+}
+
+UIOHOOK_API int hook_resume() {
+	int status = UIOHOOK_FAILURE;
+
+	if (PostThreadMessage(hook_thread_id, WM_UIOHOOK_RESUME, (WPARAM) NULL, (LPARAM) NULL)) {
+		status = UIOHOOK_SUCCESS;
+	}
+
+	logger(LOG_LEVEL_DEBUG,	"%s [%u]: Status: %#X.\n",
+			__FUNCTION__, __LINE__, status);
+
+	return status;
+}
+
+UIOHOOK_API int hook_set_event_mask(uint32_t mask) {
+	// The hook still sees every event, unwanted ones are dropped before they
+	// are dispatched.
+	InterlockedExchange(&dispatch_event_mask, (LONG) mask);
+
+	logger(LOG_LEVEL_DEBUG, "%s [%u]: Event mask: %#X.\n",
+			__FUNCTION__, __LINE__, mask);
+
+	return UIOHOOK_SUCCESS;
+}
+
+UIOHOOK_API int hook_set_backend(hook_backend backend) {
+	// There is only one way to hook input on this platform.
+	int status = UIOHOOK_SUCCESS;
+	if (backend != HOOK_BACKEND_DEFAULT) {
+		status = UIOHOOK_ERROR_BACKEND_UNSUPPORTED;
+	}
+
+	logger(LOG_LEVEL_DEBUG, "%s [%u]: Backend: %u, status: %#X.\n",
+			__FUNCTION__, __LINE__, backend, status);
+
+	return status;
+}
+
+UIOHOOK_API int hook_set_synthetic_options(const synthetic_options *options) {
+	// The synthetic backend is only built for X11.
+	logger(LOG_LEVEL_DEBUG, "%s [%u]: Synthetic backend unsupported.\n",
+			__FUNCTION__, __LINE__);
+
+	return UIOHOOK_ERROR_BACKEND_UNSUPPORTED;
+}
+
+UIOHOOK_API uint64_t hook_get_input_time() {
+	// Input is not timestamped on receipt on this platform.
+	return 0;
+}
+
+UIOHOOK_API int hook_get_stats(hook_stats *stats) {
+	// The hook does not keep counters on this platform.
+	memset(stats, 0, sizeof(hook_stats));
+
+	return UIOHOOK_ERROR_BACKEND_UNSUPPORTED;
+}
@@ -61,6 +61,7 @@ static struct xkb_rule_names xkb_names = {
 
 #endif
 
+#include "input_helper.h"
 #include "logger.h"
 
 /* The follwoing two tables are based on QEMU's x_keymap.c, under the following
@@ -636,9 +637,9 @@ static const uint16_t xfree86_scancode_table[][2] = {
 /***********************************************************************
  * The following table contains pairs of X11 keysym values for graphical
  * characters and the corresponding Unicode value. The function
- * keysym_to_unicode() maps a keysym onto a Unicode value using a binary
- * search, therefore keysym_unicode_table[] must remain SORTED by KeySym
- * value.
+ * keysym_to_unicode() and unicode_to_keysym() look values up in maps that
+ * load_unicode_maps() builds from this table.  Where several keysyms map to
+ * the same character, unicode_to_keysym() returns the first one.
  *
  * We allow to represent any UCS character in the range U+00000000 to
  * U+00FFFFFF by a keysym value in the range 0x01000000 to 0x01FFFFFF.
@@ -1439,6 +1440,39 @@ static struct codepair {
   { 0x20AC, 0x20AC }, /*                    EuroSign € EURO SIGN */
 };
 
+/* Direct-mapped views of keysym_unicode_table in both directions, filled by
+ * load_unicode_maps().  Every keysym in the table is below 0x2100 and every
+ * character is below 0x3200, so a lookup is a single array load instead of a
+ * binary search.  Zero marks a value without a mapping.
+ */
+#define KEYSYM_UNICODE_MAP_SIZE		0x2100
+#define UNICODE_KEYSYM_MAP_SIZE		0x3200
+static uint16_t keysym_unicode_map[KEYSYM_UNICODE_MAP_SIZE];
+static uint16_t unicode_keysym_map[UNICODE_KEYSYM_MAP_SIZE];
+
+static void load_unicode_maps() {
+	memset(keysym_unicode_map, 0, sizeof(keysym_unicode_map));
+	memset(unicode_keysym_map, 0, sizeof(unicode_keysym_map));
+
+	size_t i;
+	for (i = 0; i < sizeof(keysym_unicode_table) / sizeof(struct codepair); i++) {
+		const struct codepair *pair = &keysym_unicode_table[i];
+
+		if (pair->keysym < KEYSYM_UNICODE_MAP_SIZE && pair->unicode < UNICODE_KEYSYM_MAP_SIZE) {
+			keysym_unicode_map[pair->keysym] = pair->unicode;
+
+			// Some characters have several keysyms, use the first one.
+			if (unicode_keysym_map[pair->unicode] == 0) {
+				unicode_keysym_map[pair->unicode] = pair->keysym;
+			}
+		}
+		else {
+			logger(LOG_LEVEL_ERROR, "%s [%u]: Keysym %#X for U+%04X does not fit the unicode maps!\n",
+					__FUNCTION__, __LINE__, pair->keysym, pair->unicode);
+		}
+	}
+}
+
 /***********************************************************************
  * The following function converts ISO 10646-1 (UCS, Unicode) values to
  * their corresponding KeySym values.
@@ -1456,10 +1490,6 @@ static struct codepair {
  * This software is in the public domain. Share and enjoy!
  ***********************************************************************/
 KeySym unicode_to_keysym(uint16_t unicode) {
-	int min = 0;
-	int max = sizeof(keysym_unicode_table) / sizeof(struct codepair) - 1;
-	int mid;
-
 	#ifdef XK_LATIN1
 	// First check for Latin-1 characters. (1:1 mapping)
 	if ((unicode >= 0x0020 && unicode <= 0x007E) ||
@@ -1468,19 +1498,9 @@ KeySym unicode_to_keysym(uint16_t unicode) {
 	}
 	#endif
 
-	// Binary search the lookup table.
-	while (max >= min) {
-		mid = (min + max) / 2;
-		if (keysym_unicode_table[mid].unicode < unicode) {
-			min = mid + 1;
-		}
-		else if (keysym_unicode_table[mid].unicode > unicode) {
-			max = mid - 1;
-		}
-		else {
-			// Found it.
-			return keysym_unicode_table[mid].keysym;
-		}
+	// Look the character up in the direct map.
+	if (unicode < UNICODE_KEYSYM_MAP_SIZE && unicode_keysym_map[unicode] != 0) {
+		return unicode_keysym_map[unicode];
 	}
 
 	// No matching KeySym value found, return UCS2 with bit set.
@@ -1507,10 +1527,6 @@ KeySym unicode_to_keysym(uint16_t unicode) {
 size_t keysym_to_unicode(KeySym keysym, uint16_t *buffer, size_t size) {
 	size_t count = 0;
 
-	int min = 0;
-	int max = sizeof(keysym_unicode_table) / sizeof(struct codepair) - 1;
-	int mid;
-
 	#ifdef XK_LATIN1
 	// First check for Latin-1 characters. (1:1 mapping)
 	if ((keysym >= 0x0020 && keysym <= 0x007E)
@@ -1538,23 +1554,13 @@ size_t keysym_to_unicode(KeySym keysym, uint16_t *buffer, size_t size) {
 	}
 	#endif
 
-	// Binary search in table.
-	while (max >= min) {
-		mid = (min + max) / 2;
-		if (keysym_unicode_table[mid].keysym < keysym) {
-			min = mid + 1;
-		}
-		else if (keysym_unicode_table[mid].keysym > keysym) {
-			max = mid - 1;
+	// Look the keysym up in the direct map.
+	if (keysym < KEYSYM_UNICODE_MAP_SIZE && keysym_unicode_map[keysym] != 0) {
+		if (count < size) {
+			buffer[count++] = keysym_unicode_map[keysym];
 		}
-		else {
-			// Found it.
-			if (count < size) {
-				buffer[count++] = keysym_unicode_table[mid].unicode;
-			}
 
-			return count;
-		}
+		return count;
 	}
 
     // No matching Unicode value found!
@@ -1685,87 +1691,252 @@ void destroy_xkb_state(struct xkb_state* state) {
 	xkb_state_unref(state);
 }
 
+// Encode a character as UTF-16.  Zero means the key has no character.
+static size_t utf32_to_utf16(uint32_t unicode, uint16_t *buffer, size_t length) {
+	size_t count = 0;
+
+	if (unicode != 0 && unicode <= 0x10FFFF) {
+		if ((unicode <= 0xD7FF || (unicode >= 0xE000 && unicode <= 0xFFFF)) && length >= 1) {
+			buffer[0] = unicode;
+			count = 1;
+		}
+		else if (unicode >= 0x10000 && length >= 2) {
+			unsigned int code = (unicode - 0x10000);
+			buffer[0] = 0xD800 | (code >> 10);
+			buffer[1] = 0xDC00 | (code & 0x3FF);
+			count = 2;
+		}
+	}
+
+	return count;
+}
+
 size_t keycode_to_unicode(struct xkb_state* state, KeyCode keycode, uint16_t *buffer, size_t length) {
 	size_t count = 0;
 
 	if (state != NULL) {
-		uint32_t unicode = xkb_state_key_get_utf32(state, keycode);
+		count = utf32_to_utf16(xkb_state_key_get_utf32(state, keycode), buffer, length);
+	}
+
+    return count;
+}
+
+/* Dense key translation table, indexed by keycode, keyboard group and shift
+ * level.  It is built once per keymap on the hook thread, so translating a key
+ * is a couple of array loads instead of a keysym lookup followed by a search
+ * for its characters.
+ */
+static key_translation *key_table = NULL;
+static unsigned int key_table_groups = 0;
+static unsigned int key_table_levels = 0;
+
+static inline key_translation * key_table_entry(KeyCode keycode, unsigned int group, unsigned int level) {
+	return &key_table[(keycode * key_table_groups + group) * key_table_levels + level];
+}
+
+// Keymap the table was built for, and the modifiers for which xkbcommon
+// transforms the translation of a key.
+static struct xkb_keymap *key_table_keymap = NULL;
+static xkb_mod_mask_t key_table_transform_mods = 0;
+
+static void free_key_table() {
+	if (key_table != NULL) {
+		free(key_table);
+		key_table = NULL;
+	}
 
-		if (unicode <= 0x10FFFF) {
-			if ((unicode <= 0xD7FF || (unicode >= 0xE000 && unicode <= 0xFFFF)) && length >= 1) {
-				buffer[0] = unicode;
-				count = 1;
+	if (key_table_keymap != NULL) {
+		xkb_keymap_unref(key_table_keymap);
+		key_table_keymap = NULL;
+	}
+
+	key_table_groups = 0;
+	key_table_levels = 0;
+}
+
+void load_key_table(struct xkb_keymap *keymap) {
+	free_key_table();
+
+	if (keymap == NULL) {
+		return;
+	}
+
+	xkb_keycode_t min_keycode = xkb_keymap_min_keycode(keymap);
+	xkb_keycode_t max_keycode = xkb_keymap_max_keycode(keymap);
+	if (max_keycode > 0xFF) {
+		// X11 key codes are a single byte.
+		max_keycode = 0xFF;
+	}
+
+	// Size the table for the widest key.
+	xkb_keycode_t keycode;
+	xkb_layout_index_t layout;
+	for (keycode = min_keycode; keycode <= max_keycode; keycode++) {
+		xkb_layout_index_t num_layouts = xkb_keymap_num_layouts_for_key(keymap, keycode);
+		if (num_layouts > key_table_groups) {
+			key_table_groups = num_layouts;
+		}
+
+		for (layout = 0; layout < num_layouts; layout++) {
+			xkb_level_index_t num_levels = xkb_keymap_num_levels_for_key(keymap, keycode, layout);
+			if (num_levels > key_table_levels) {
+				key_table_levels = num_levels;
 			}
-			else if (unicode >= 0x10000) {
-				unsigned int code = (unicode - 0x10000);
-				buffer[0] = 0xD800 | (code >> 10);
-				buffer[1] = 0xDC00 | (code & 0x3FF);
-				count = 2;
+		}
+	}
+
+	if (key_table_groups == 0 || key_table_levels == 0) {
+		logger(LOG_LEVEL_WARN, "%s [%u]: The keymap does not bind any keys!\n",
+				__FUNCTION__, __LINE__);
+		return;
+	}
+
+	key_table = calloc(0x100 * key_table_groups * key_table_levels, sizeof(key_translation));
+	if (key_table == NULL) {
+		logger(LOG_LEVEL_ERROR, "%s [%u]: Failed to allocate memory for the key table!\n",
+				__FUNCTION__, __LINE__);
+		key_table_groups = 0;
+		key_table_levels = 0;
+		return;
+	}
+
+	for (keycode = min_keycode; keycode <= max_keycode; keycode++) {
+		xkb_layout_index_t num_layouts = xkb_keymap_num_layouts_for_key(keymap, keycode);
+		for (layout = 0; layout < num_layouts; layout++) {
+			xkb_level_index_t level, num_levels = xkb_keymap_num_levels_for_key(keymap, keycode, layout);
+			for (level = 0; level < num_levels; level++) {
+				const xkb_keysym_t *syms;
+
+				// Like xkb_state_key_get_one_sym(), keys with several keysyms
+				// have none.
+				if (xkb_keymap_key_get_syms_by_level(keymap, keycode, layout, level, &syms) == 1) {
+					key_translation *key = key_table_entry(keycode, layout, level);
+					key->keysym = syms[0];
+					key->count = utf32_to_utf16(xkb_keysym_to_utf32(syms[0]), key->unicode,
+							sizeof(key->unicode) / sizeof(uint16_t));
+				}
 			}
 		}
 	}
 
-    return count;
+	key_table_transform_mods = 0;
+	xkb_mod_index_t caps_mod = xkb_keymap_mod_get_index(keymap, XKB_MOD_NAME_CAPS);
+	if (caps_mod != XKB_MOD_INVALID) {
+		key_table_transform_mods |= 1 << caps_mod;
+	}
+
+	xkb_mod_index_t ctrl_mod = xkb_keymap_mod_get_index(keymap, XKB_MOD_NAME_CTRL);
+	if (ctrl_mod != XKB_MOD_INVALID) {
+		key_table_transform_mods |= 1 << ctrl_mod;
+	}
+
+	key_table_keymap = xkb_keymap_ref(keymap);
+
+	logger(LOG_LEVEL_DEBUG, "%s [%u]: Loaded key table for %u groups and %u levels.\n",
+			__FUNCTION__, __LINE__, key_table_groups, key_table_levels);
+}
+
+const key_translation * lookup_key(struct xkb_state *state, KeyCode keycode) {
+	if (key_table == NULL || xkb_state_get_keymap(state) != key_table_keymap) {
+		return NULL;
+	}
+
+	// xkbcommon capitalizes keysyms for Caps Lock and maps characters to
+	// control characters for Control, which the table does not model.
+	if (xkb_state_serialize_mods(state, XKB_STATE_MODS_EFFECTIVE) & key_table_transform_mods) {
+		return NULL;
+	}
+
+	xkb_layout_index_t layout = xkb_state_key_get_layout(state, keycode);
+	if (layout >= key_table_groups) {
+		return NULL;
+	}
+
+	xkb_level_index_t level = xkb_state_key_get_level(state, keycode, layout);
+	if (level >= key_table_levels) {
+		return NULL;
+	}
+
+	return key_table_entry(keycode, layout, level);
 }
 #else
+#ifdef USE_XKB
+// Map the keyboard group of an event onto a group bound to the key.
+static unsigned int key_group(XkbDescPtr map, KeyCode keycode, unsigned int group) {
+	// Get the range and number of symbols groups bound to the key.
+	unsigned char info = XkbKeyGroupInfo(map, keycode);
+	unsigned int num_groups = XkbKeyNumGroups(map, keycode);
+
+	if (num_groups == 0) {
+		return 0;
+	}
+	else if (group < num_groups) {
+		return group;
+	}
+
+	switch (XkbOutOfRangeGroupAction(info)) {
+		case XkbRedirectIntoRange:
+			/* If the RedirectIntoRange flag is set, the four least significant
+			 * bits of the groups wrap control specify the index of a group to
+			 * which all illegal groups correspond. If the specified group is
+			 * also out of range, all illegal groups map to Group1.
+			 */
+			group = XkbOutOfRangeGroupInfo(info);
+			if (group >= num_groups) {
+				group = 0;
+			}
+			break;
+
+		case XkbClampIntoRange:
+			/* If the ClampIntoRange flag is set, out-of-range groups correspond
+			 * to the nearest legal group. Effective groups larger than the
+			 * highest supported group are mapped to the highest supported group;
+			 * effective groups less than Group1 are mapped to Group1 . For
+			 * example, a key with two groups of symbols uses Group2 type and
+			 * symbols if the global effective group is either Group3 or Group4.
+			 */
+			group = num_groups - 1;
+			break;
+
+		case XkbWrapIntoRange:
+			/* If neither flag is set, group is wrapped into range using integer
+			 * modulus. For example, a key with two groups of symbols for which
+			 * groups wrap uses Group1 symbols if the global effective group is
+			 * Group3 or Group2 symbols if the global effective group is Group4.
+			 */
+		default:
+			if (num_groups != 0) {
+				group %= num_groups;
+			}
+			break;
+	}
+
+	return group;
+}
+
+// Shift level of a key type for a modifier state.
+static unsigned int key_level(XkbKeyTypePtr key_type, unsigned int modifier_mask) {
+	unsigned int active_mods = modifier_mask & key_type->mods.mask;
+
+	int i, level = 0;
+	for (i = 0; i < key_type->map_count; i++) {
+		if (key_type->map[i].active && key_type->map[i].mods.mask == active_mods) {
+			level = key_type->map[i].level;
+		}
+	}
+
+	return level;
+}
+#endif
+
 // Faster more flexible alternative to XKeycodeToKeysym...
 KeySym keycode_to_keysym(KeyCode keycode, unsigned int modifier_mask) {
 	KeySym keysym = NoSymbol;
 
 	#ifdef USE_XKB
 	if (keyboard_map != NULL) {
-		// Get the range and number of symbols groups bound to the key.
-		unsigned char info = XkbKeyGroupInfo(keyboard_map, keycode);
-		unsigned int num_groups = XkbKeyNumGroups(keyboard_map, keycode);
-
-		// Get the group.
-		unsigned int group = 0x0000;
-		switch (XkbOutOfRangeGroupAction(info)) {
-			case XkbRedirectIntoRange:
-				/* If the RedirectIntoRange flag is set, the four least significant
-				 * bits of the groups wrap control specify the index of a group to
-				 * which all illegal groups correspond. If the specified group is
-				 * also out of range, all illegal groups map to Group1.
-				 */
-				group = XkbOutOfRangeGroupInfo(info);
-				if (group >= num_groups) {
-					group = 0;
-				}
-				break;
-
-			case XkbClampIntoRange:
-				/* If the ClampIntoRange flag is set, out-of-range groups correspond
-				 * to the nearest legal group. Effective groups larger than the
-				 * highest supported group are mapped to the highest supported group;
-				 * effective groups less than Group1 are mapped to Group1 . For
-				 * example, a key with two groups of symbols uses Group2 type and
-				 * symbols if the global effective group is either Group3 or Group4.
-				 */
-				group = num_groups - 1;
-				break;
-
-			case XkbWrapIntoRange:
-				/* If neither flag is set, group is wrapped into range using integer
-				 * modulus. For example, a key with two groups of symbols for which
-				 * groups wrap uses Group1 symbols if the global effective group is
-				 * Group3 or Group2 symbols if the global effective group is Group4.
-				 */
-			default:
-				if (num_groups != 0) {
-					group %= num_groups;
-				}
-				break;
-		}
-
-		XkbKeyTypePtr key_type = XkbKeyKeyType(keyboard_map, keycode, group);
-		unsigned int active_mods = modifier_mask & key_type->mods.mask;
-
-		int i, level = 0;
-		for (i = 0; i < key_type->map_count; i++) {
-			if (key_type->map[i].active && key_type->map[i].mods.mask == active_mods) {
-				level = key_type->map[i].level;
-			}
-		}
+		unsigned int group = key_group(keyboard_map, keycode, XkbGroupForCoreState(modifier_mask));
+		unsigned int level = key_level(XkbKeyKeyType(keyboard_map, keycode, group), modifier_mask);
 
 		keysym = XkbKeySymEntry(keyboard_map, keycode, level, group);
 	}
@@ -1861,9 +2032,154 @@ KeySym keycode_to_keysym(KeyCode keycode, unsigned int modifier_mask) {
 
 	return keysym;
 }
+
+#ifdef USE_XKB
+/* Dense key translation table, indexed by keycode, keyboard group and shift
+ * level.  It is built once per keymap on the hook thread, so translating a key
+ * is a couple of array loads instead of a keysym lookup followed by a search
+ * for its characters.
+ */
+static key_translation *key_table = NULL;
+static unsigned int key_table_groups = 0;
+static unsigned int key_table_levels = 0;
+
+static inline key_translation * key_table_entry(KeyCode keycode, unsigned int group, unsigned int level) {
+	return &key_table[(keycode * key_table_groups + group) * key_table_levels + level];
+}
+
+// Key type of every keycode in every group, and the shift level of every key
+// type for every core modifier state.
+static uint8_t (*key_table_types)[XkbNumKbdGroups] = NULL;
+static uint8_t (*key_type_levels)[0x100] = NULL;
+
+static void free_key_table() {
+	if (key_table != NULL) {
+		free(key_table);
+		key_table = NULL;
+	}
+
+	if (key_table_types != NULL) {
+		free(key_table_types);
+		key_table_types = NULL;
+	}
+
+	if (key_type_levels != NULL) {
+		free(key_type_levels);
+		key_type_levels = NULL;
+	}
+
+	key_table_groups = 0;
+	key_table_levels = 0;
+}
+
+static void load_key_table() {
+	free_key_table();
+
+	if (keyboard_map == NULL || keyboard_map->map == NULL || keyboard_map->map->num_types == 0) {
+		return;
+	}
+
+	unsigned int num_types = keyboard_map->map->num_types;
+	unsigned int type, state;
+	for (type = 0; type < num_types; type++) {
+		if (keyboard_map->map->types[type].num_levels > key_table_levels) {
+			key_table_levels = keyboard_map->map->types[type].num_levels;
+		}
+	}
+
+	// The group of an event is looked up directly, so every group has a slot.
+	key_table_groups = XkbNumKbdGroups;
+
+	key_table = calloc(0x100 * key_table_groups * key_table_levels, sizeof(key_translation));
+	key_table_types = calloc(0x100, sizeof(*key_table_types));
+	key_type_levels = calloc(num_types, sizeof(*key_type_levels));
+	if (key_table == NULL || key_table_types == NULL || key_type_levels == NULL) {
+		logger(LOG_LEVEL_ERROR, "%s [%u]: Failed to allocate memory for the key table!\n",
+				__FUNCTION__, __LINE__);
+		free_key_table();
+		return;
+	}
+
+	for (type = 0; type < num_types; type++) {
+		for (state = 0; state < 0x100; state++) {
+			key_type_levels[type][state] = key_level(&keyboard_map->map->types[type], state);
+		}
+	}
+
+	unsigned int keycode;
+	for (keycode = keyboard_map->min_key_code; keycode <= keyboard_map->max_key_code; keycode++) {
+		unsigned int group;
+		for (group = 0; group < key_table_groups; group++) {
+			unsigned int key_group_index = key_group(keyboard_map, keycode, group);
+			unsigned int level, width = XkbKeyGroupWidth(keyboard_map, keycode, key_group_index);
+
+			key_table_types[keycode][group] = XkbKeyKeyTypeIndex(keyboard_map, keycode, key_group_index);
+			for (level = 0; level < width && level < key_table_levels; level++) {
+				key_translation *key = key_table_entry(keycode, group, level);
+				key->keysym = XkbKeySymEntry(keyboard_map, keycode, level, key_group_index);
+				key->count = keysym_to_unicode(key->keysym, key->unicode, sizeof(key->unicode) / sizeof(uint16_t));
+			}
+		}
+	}
+
+	logger(LOG_LEVEL_DEBUG, "%s [%u]: Loaded key table for %u key types and %u levels.\n",
+			__FUNCTION__, __LINE__, num_types, key_table_levels);
+}
+
+void reload_key_table(Display *disp) {
+	if (keyboard_map != NULL) {
+		XkbFreeClientMap(keyboard_map, XkbAllClientInfoMask, true);
+	}
+
+	keyboard_map = XkbGetMap(disp, XkbAllClientInfoMask, XkbUseCoreKbd);
+	load_key_table();
+}
+
+const key_translation * lookup_key(KeyCode keycode, unsigned int modifier_mask) {
+	if (key_table == NULL) {
+		return NULL;
+	}
+
+	unsigned int group = XkbGroupForCoreState(modifier_mask);
+	unsigned int level = key_type_levels[key_table_types[keycode][group]][modifier_mask & 0xFF];
+
+	return key_table_entry(keycode, group, level);
+}
 #endif
+#endif
+
+// Changes reported by invalidate_key_table() that the hook has not seen yet.
+static unsigned int key_table_changes = 0;
+
+void invalidate_key_table(unsigned int changes) {
+	__atomic_fetch_or(&key_table_changes, changes, __ATOMIC_RELEASE);
+}
+
+unsigned int take_key_table_changes() {
+	// Read first so the common case does not write to the shared cache line.
+	if (__atomic_load_n(&key_table_changes, __ATOMIC_RELAXED) == 0) {
+		return 0;
+	}
+
+	return __atomic_exchange_n(&key_table_changes, 0, __ATOMIC_ACQUIRE);
+}
+
+uint16_t key_lock_mask(uint16_t scancode, bool pressed, unsigned int led_mask, unsigned int (*query_led_mask)()) {
+	if (pressed && (scancode == VC_CAPS_LOCK || scancode == VC_NUM_LOCK || scancode == VC_SCROLL_LOCK)) {
+		led_mask = query_led_mask();
+	}
+
+	uint16_t mask = 0x0000;
+	if (led_mask & 0x01) { mask |= MASK_CAPS_LOCK;   }
+	if (led_mask & 0x02) { mask |= MASK_NUM_LOCK;    }
+	if (led_mask & 0x04) { mask |= MASK_SCROLL_LOCK; }
+
+	return mask;
+}
 
 void load_input_helper(Display *disp) {
+	load_unicode_maps();
+
 	#ifdef USE_XKB
 	/* The following code block is based on vncdisplaykeymap.c under the terms:
 	 *
@@ -1909,6 +2225,11 @@ void load_input_helper(Display *disp) {
 
 	// Get the map.
 	keyboard_map = XkbGetMap(disp, XkbAllClientInfoMask, XkbUseCoreKbd);
+
+	#ifndef USE_XKBCOMMON
+	// With xkbcommon the table follows the keymap of the hook's xkb state.
+	load_key_table();
+	#endif
 	#else
 	// No known alternative to determine scancode mapping, assume XFree86!
 	#pragma message("*** Warning: XKB support is required to accurately determine keyboard scancodes!")
@@ -1971,6 +2292,10 @@ void load_input_helper(Display *disp) {
 }
 
 void unload_input_helper() {
+	#if defined(USE_XKBCOMMON) || defined(USE_XKB)
+	free_key_table();
+	#endif
+
 	if (keyboard_map) {
 		#ifdef USE_XKB
 		XkbFreeClientMap(keyboard_map, XkbAllClientInfoMask, true);
@@ -19,6 +19,7 @@
 #ifndef _included_input_helper
 #define _included_input_helper
 
+#include <stdbool.h>
 #include <stdint.h>
 #include <X11/Xlib.h>
 
@@ -40,6 +41,17 @@
 #define XButton1		8
 #define XButton2		9
 
+// Translation of a key at one keyboard group and shift level.
+typedef struct _key_translation {
+	KeySym keysym;
+	uint16_t unicode[2];
+	uint8_t count;
+} key_translation;
+
+// Changes that make the key translation table stale.
+#define KEY_TABLE_KEYMAP	0x01
+#define KEY_TABLE_GROUP		0x02
+
 /* Converts an X11 key symbol to a single Unicode character.  No direct X11
  * functionality exists to provide this information.
  */
@@ -74,6 +86,17 @@ extern struct xkb_state * create_xkb_state(struct xkb_context *context, xcb_conn
  */
 extern void destroy_xkb_state(struct xkb_state* state);
 
+/* Build the key translation table for an xkbcommon keymap.  Must be called by
+ * the thread that calls lookup_key().
+ */
+extern void load_key_table(struct xkb_keymap *keymap);
+
+/* Look up the keysym and characters of a key in the current xkb state.
+ * Returns NULL if the key is not in the table or if Caps Lock or Control
+ * transform its translation, in which case xkbcommon has to be asked.
+ */
+extern const key_translation * lookup_key(struct xkb_state *state, KeyCode keycode);
+
 #else
 
 /* Converts an X11 key code and event mask to the appropriate X11 key symbol.
@@ -82,8 +105,37 @@ extern void destroy_xkb_state(struct xkb_state* state);
  */
 extern KeySym keycode_to_keysym(KeyCode keycode, unsigned int modifier_mask);
 
+#ifdef USE_XKB
+/* Fetch the keyboard map again and rebuild the key translation table.  Must be
+ * called by the thread that calls lookup_key().
+ */
+extern void reload_key_table(Display *disp);
+
+/* Look up the keysym and characters of a key for a core event state, which
+ * also carries the keyboard group.  Returns NULL if there is no table.
+ */
+extern const key_translation * lookup_key(KeyCode keycode, unsigned int modifier_mask);
 #endif
 
+#endif
+
+/* Report keymap or group changes that make the key translation table stale.
+ * May be called from any thread.
+ */
+extern void invalidate_key_table(unsigned int changes);
+
+/* Return and clear the changes reported since the last call.
+ */
+extern unsigned int take_key_table_changes();
+
+/* Return the lock masks (MASK_CAPS_LOCK, MASK_NUM_LOCK and MASK_SCROLL_LOCK)
+ * after a key event, from a core keyboard indicator mask.  A lock key press
+ * changes its LED before the event is recorded, but the indicator notify only
+ * reaches the settings thread later, so query_led_mask is called for those to
+ * ask the server.  Every other key event uses led_mask, the tracked state.
+ */
+extern uint16_t key_lock_mask(uint16_t scancode, bool pressed, unsigned int led_mask, unsigned int (*query_led_mask)());
+
 /* Initialize items required for KeyCodeToKeySym() and KeySymToUnicode()
  * functionality.  This method is called by OnLibraryLoad() and may need to be
  * called in combination with UnloadInputHelper() if the native keyboard layout
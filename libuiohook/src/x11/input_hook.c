@@ -20,13 +20,29 @@
 #include <config.h>
 #endif
 
+#if defined(USE_XINPUT2) || defined(USE_XRECORD_ASYNC)
+// The hook thread waits on the data display and a pipe other threads can wake
+// it up through.
+#define HOOK_WAKE_PIPE
+#endif
+
+#ifdef HOOK_WAKE_PIPE
+#include <errno.h>
+#include <fcntl.h>
+#endif
 #include <inttypes.h>
 #include <limits.h>
-#ifdef USE_XRECORD_ASYNC
-#include <pthread.h>
+#ifdef HOOK_WAKE_PIPE
+#include <poll.h>
 #endif
+#include <pthread.h>
 #include <stdint.h>
+#include <string.h>
+#include <time.h>
 #include <uiohook.h>
+#ifdef HOOK_WAKE_PIPE
+#include <unistd.h>
+#endif
 #ifdef USE_XKB
 #include <xcb/xkb.h>
 #include <X11/XKBlib.h>
@@ -35,6 +51,13 @@
 #include <X11/Xlibint.h>
 #include <X11/Xlib.h>
 #include <X11/extensions/record.h>
+#ifdef USE_XCB_RECORD
+#include <xcb/record.h>
+#endif
+#ifdef USE_XINPUT2
+#include <X11/Xatom.h>
+#include <X11/extensions/XInput2.h>
+#endif
 #if defined(USE_XINERAMA) && !defined(USE_XRANDR)
 #include <X11/extensions/Xinerama.h>
 #elif defined(USE_XRANDR)
@@ -48,29 +71,103 @@
 #include "logger.h"
 #include "input_helper.h"
 
+#if defined(USE_XINERAMA) || defined(USE_XRANDR)
+// Cached origin of the first screen, defined in system_properties.c.
+extern void get_screen_origin(int16_t *x, int16_t *y);
+#endif
+
+// System properties cache, defined in system_properties.c.
+extern void reload_system_properties();
+extern unsigned int get_properties_generation();
+extern uint64_t get_properties_time();
+
+// Synthetic event source, defined in synthetic_hook.c.
+extern int synthetic_hook_run(dispatcher_t dispatch);
+extern bool synthetic_hook_is_running();
+extern int synthetic_hook_stop();
+extern int synthetic_hook_pause();
+extern int synthetic_hook_resume();
+
 // Thread and hook handles.
-#ifdef USE_XRECORD_ASYNC
-static bool running;
+// NOTE running and paused are guarded by hook_xrecord_mutex.
+static bool running = false;
+static bool paused = false;
 
 static pthread_cond_t hook_xrecord_cond = PTHREAD_COND_INITIALIZER;
 static pthread_mutex_t hook_xrecord_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+// Set while EVENT_HOOK_ENABLED has been dispatched without a matching
+// EVENT_HOOK_DISABLED.  Only used by the hook thread.
+static bool hook_is_enabled = false;
+
+// Backend requested with hook_set_backend(), used by the next hook_run().
+static hook_backend backend = HOOK_BACKEND_DEFAULT;
+
+#ifdef USE_XINPUT2
+// Scroll valuator of a physical device.
+typedef struct _xinput_scroll {
+	int deviceid;
+	int number;
+	uint8_t direction;
+	double increment;
+	// Scrolled since the last wheel event, in increments.
+	double distance;
+} xinput_scroll;
 #endif
 
 typedef struct _hook_info {
+	hook_backend backend;
+	#ifdef HOOK_WAKE_PIPE
+	// Pipe that wakes the hook thread up from poll().
+	int wake[2];
+	#endif
 	struct _data {
 		Display *display;
+		#ifdef USE_XCB_RECORD
+		// Used instead of the display by the xcb-record backend.
+		xcb_connection_t *connection;
+		#endif
 		XRecordRange *range;
 	} data;
 	struct _ctrl {
 		Display *display;
 		XRecordContext context;
 	} ctrl;
+	#ifdef USE_XINPUT2
+	struct _xinput {
+		int opcode;
+		// Raw events selected on the root window, and the event mask they
+		// were selected for.
+		bool selected;
+		uint32_t selected_mask;
+		// Last pointer position reported.
+		int root_x;
+		int root_y;
+		// Pointer position as last queried, which stays current until raw
+		// motion moves the pointer, as long as that motion is selected.
+		bool pointer_known;
+		int pointer_x;
+		int pointer_y;
+		// Time of raw motion whose position was not queried yet.
+		bool motion_pending;
+		uint64_t motion_time;
+		unsigned char button_map[256];
+		int button_count;
+		xinput_scroll *scroll;
+		unsigned int scroll_count;
+		#if !defined(USE_XKBCOMMON) && defined(USE_XKB)
+		int xkb_event_base;
+		unsigned int core_state;
+		#endif
+	} xinput;
+	#endif
 	struct _input {
 		#ifdef USE_XKBCOMMON
 		xcb_connection_t *connection;
 		struct xkb_context *context;
     	#endif
 		uint16_t mask;
+		unsigned int properties_generation;
 		struct _mouse {
 			bool is_dragged;
 			struct _click {
@@ -95,16 +192,38 @@ typedef union {
 
 #if defined(USE_XKBCOMMON)
 static struct xkb_state *state = NULL;
+
+// Indices of the lock key LEDs in the keymap of state.
+static xkb_led_index_t caps_lock_led = XKB_LED_INVALID;
+static xkb_led_index_t num_lock_led = XKB_LED_INVALID;
+static xkb_led_index_t scroll_lock_led = XKB_LED_INVALID;
+#elif defined(USE_XKB)
+// Indicator state tracked by the settings thread, defined in system_properties.c.
+extern unsigned int get_indicator_state();
+extern void set_indicator_state(unsigned int led_mask);
 #endif
 
 // Virtual event pointer.
 static uiohook_event event;
 
 static bool grab_enabled = false;
+static bool grab_requested = false;
 
 // Event dispatch callback.
 static dispatcher_t dispatcher = NULL;
 
+// Monotonic time at which the input being processed was received, in
+// nanoseconds.  Only used by the hook thread.
+static uint64_t input_time = 0;
+
+// Counters returned by hook_get_stats().  Only the hook thread writes to them,
+// so they are updated with plain atomic stores that never lock.
+static hook_stats stats;
+
+// Event types requested with hook_set_event_mask().  Written by any thread and
+// read by the hook thread for every event.
+static uint32_t dispatch_event_mask = EVENT_MASK_ALL;
+
 UIOHOOK_API void hook_set_dispatch_proc(dispatcher_t dispatch_proc) {
 	logger(LOG_LEVEL_DEBUG,	"%s [%u]: Setting new dispatch callback to %#p.\n",
 			__FUNCTION__, __LINE__, dispatch_proc);
@@ -112,13 +231,59 @@ UIOHOOK_API void hook_set_dispatch_proc(dispatcher_t dispatch_proc) {
 	dispatcher = dispatch_proc;
 }
 
+// Add to one of the counters.  Hook thread only.
+static inline void stats_add(uint64_t *counter, uint64_t value) {
+	__atomic_store_n(counter, __atomic_load_n(counter, __ATOMIC_RELAXED) + value, __ATOMIC_RELAXED);
+}
+
+static inline uint64_t monotonic_time() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+UIOHOOK_API int hook_get_stats(hook_stats *copy) {
+	size_t i;
+	for (i = 0; i < HOOK_STATS_INPUT_TYPES; i++) {
+		copy->received[i] = __atomic_load_n(&stats.received[i], __ATOMIC_RELAXED);
+	}
+
+	for (i = 0; i < HOOK_STATS_EVENT_TYPES; i++) {
+		copy->dispatched[i] = __atomic_load_n(&stats.dispatched[i], __ATOMIC_RELAXED);
+	}
+
+	copy->consumed = __atomic_load_n(&stats.consumed, __ATOMIC_RELAXED);
+	copy->replies = __atomic_load_n(&stats.replies, __ATOMIC_RELAXED);
+	copy->bytes = __atomic_load_n(&stats.bytes, __ATOMIC_RELAXED);
+	copy->dispatch_time = __atomic_load_n(&stats.dispatch_time, __ATOMIC_RELAXED);
+
+	return UIOHOOK_SUCCESS;
+}
+
 // Send out an event if a dispatcher was set.
 static inline void dispatch_event(uiohook_event *const event) {
+	if (event->type > EVENT_HOOK_DISABLED
+			&& !(__atomic_load_n(&dispatch_event_mask, __ATOMIC_RELAXED) & EVENT_MASK(event->type))) {
+		// Nobody asked for this event type.
+		return;
+	}
+
 	if (dispatcher != NULL) {
 		logger(LOG_LEVEL_DEBUG,	"%s [%u]: Dispatching event type %u.\n",
 				__FUNCTION__, __LINE__, event->type);
 
+		uint64_t start = monotonic_time();
 		dispatcher(event);
+		stats_add(&stats.dispatch_time, monotonic_time() - start);
+
+		if (event->type < HOOK_STATS_EVENT_TYPES) {
+			stats_add(&stats.dispatched[event->type], 1);
+		}
+
+		if (event->reserved & 0x01) {
+			stats_add(&stats.consumed, 1);
+		}
 	}
 	else {
 		logger(LOG_LEVEL_WARN,	"%s [%u]: No dispatch callback set!\n",
@@ -126,6 +291,21 @@ static inline void dispatch_event(uiohook_event *const event) {
 	}
 }
 
+// Note the time at which the hook received input from the server.
+static inline void stamp_input_time() {
+	input_time = monotonic_time();
+}
+
+// Generated events are received the moment they are dispatched.
+static void dispatch_synthetic_event(uiohook_event *const event) {
+	stamp_input_time();
+	dispatch_event(event);
+}
+
+UIOHOOK_API uint64_t hook_get_input_time() {
+	return input_time;
+}
+
 // Set the native modifier mask for future events.
 static inline void set_modifier_mask(uint16_t mask) {
 	hook->input.mask |= mask;
@@ -141,61 +321,92 @@ static inline uint16_t get_modifiers() {
 	return hook->input.mask;
 }
 
-// Initialize the modifier lock masks.
-static void initialize_locks() {
-	#ifdef USE_XKBCOMMON
-
-	if (xkb_state_led_name_is_active(state, XKB_LED_NAME_CAPS)) {
+// Set the lock masks to the given lock states.
+static void set_lock_masks(bool caps_lock, bool num_lock, bool scroll_lock) {
+	if (caps_lock) {
 		set_modifier_mask(MASK_CAPS_LOCK);
 	}
 	else {
 		unset_modifier_mask(MASK_CAPS_LOCK);
 	}
 
-	if (xkb_state_led_name_is_active(state, XKB_LED_NAME_NUM)) {
+	if (num_lock) {
 		set_modifier_mask(MASK_NUM_LOCK);
 	}
 	else {
 		unset_modifier_mask(MASK_NUM_LOCK);
 	}
 
-	if (xkb_state_led_name_is_active(state, XKB_LED_NAME_SCROLL)) {
+	if (scroll_lock) {
 		set_modifier_mask(MASK_SCROLL_LOCK);
 	}
 	else {
 		unset_modifier_mask(MASK_SCROLL_LOCK);
 	}
-	#else
-	unsigned int led_mask = 0x00;
-	if (XkbGetIndicatorState(hook->ctrl.display, XkbUseCoreKbd, &led_mask) == Success) {
-		if (led_mask & 0x01) {
-			set_modifier_mask(MASK_CAPS_LOCK);
-		}
-		else {
-			unset_modifier_mask(MASK_CAPS_LOCK);
-		}
+}
 
-		if (led_mask & 0x02) {
-			set_modifier_mask(MASK_NUM_LOCK);
-		}
-		else {
-			unset_modifier_mask(MASK_NUM_LOCK);
-		}
+#ifdef USE_XKBCOMMON
+// Set the lock masks from the LEDs of the xkb state.
+static void update_locks() {
+	set_lock_masks(
+			caps_lock_led != XKB_LED_INVALID && xkb_state_led_index_is_active(state, caps_lock_led) > 0,
+			num_lock_led != XKB_LED_INVALID && xkb_state_led_index_is_active(state, num_lock_led) > 0,
+			scroll_lock_led != XKB_LED_INVALID && xkb_state_led_index_is_active(state, scroll_lock_led) > 0);
+}
+#elif defined(USE_XKB)
+// Set the lock masks from a core keyboard indicator mask.
+static void update_locks(unsigned int led_mask) {
+	set_lock_masks(led_mask & 0x01, led_mask & 0x02, led_mask & 0x04);
+}
 
-		if (led_mask & 0x04) {
-			set_modifier_mask(MASK_SCROLL_LOCK);
-		}
-		else {
-			unset_modifier_mask(MASK_SCROLL_LOCK);
-		}
+// Ask the server for the core keyboard indicator mask, and share it with the
+// settings thread.  Falls back to the tracked state if the request fails.
+static unsigned int query_indicator_state() {
+	unsigned int led_mask = 0x00;
+	if (XkbGetIndicatorState(hook->ctrl.display, XkbUseCoreKbd, &led_mask) == Success) {
+		set_indicator_state(led_mask);
 	}
 	else {
 		logger(LOG_LEVEL_WARN, "%s [%u]: XkbGetIndicatorState failed to get current led mask!\n",
 				__FUNCTION__, __LINE__);
+
+		led_mask = get_indicator_state();
+	}
+
+	return led_mask;
+}
+#endif
+
+// Initialize the modifier lock masks.
+static void initialize_locks() {
+	#ifdef USE_XKBCOMMON
+	if (state != NULL) {
+		// Look the LEDs up once instead of by name for every key.
+		struct xkb_keymap *keymap = xkb_state_get_keymap(state);
+		caps_lock_led = xkb_keymap_led_get_index(keymap, XKB_LED_NAME_CAPS);
+		num_lock_led = xkb_keymap_led_get_index(keymap, XKB_LED_NAME_NUM);
+		scroll_lock_led = xkb_keymap_led_get_index(keymap, XKB_LED_NAME_SCROLL);
+
+		update_locks();
 	}
+	#elif defined(USE_XKB)
+	update_locks(query_indicator_state());
 	#endif
 }
 
+#if !defined(USE_XKBCOMMON) && defined(USE_XKB)
+// Update the lock masks for a key event.  Only lock key presses ask the
+// server, see key_lock_mask(); every other key uses the indicator state
+// tracked by the settings thread, which also picks up locks changed by other
+// clients, without a round trip.
+static inline void update_key_locks(uint16_t scancode, bool pressed) {
+	uint16_t lock_mask = key_lock_mask(scancode, pressed, get_indicator_state(), query_indicator_state);
+
+	unset_modifier_mask(MASK_CAPS_LOCK | MASK_NUM_LOCK | MASK_SCROLL_LOCK);
+	set_modifier_mask(lock_mask);
+}
+#endif
+
 // Initialize the modifier mask to the current modifiers.
 static void initialize_modifiers() {
 	hook->input.mask = 0x0000;
@@ -264,11 +475,166 @@ static void initialize_modifiers() {
 	initialize_locks();
 }
 
-void hook_event_proc(XPointer closeure, XRecordInterceptData *recorded_data) {
-	uint64_t timestamp = (uint64_t) recorded_data->server_time;
+#ifdef USE_XKBCOMMON
+// Replace the xkb state with the server's current one, keeping the keymap.
+static void resync_xkb_state() {
+	if (state != NULL && hook->input.connection != NULL) {
+		int32_t device_id = xkb_x11_get_core_keyboard_device_id(hook->input.connection);
+		if (device_id >= 0) {
+			struct xkb_state *current = xkb_x11_state_new_from_device(xkb_state_get_keymap(state), hook->input.connection, device_id);
+			if (current != NULL) {
+				destroy_xkb_state(state);
+				state = current;
+			}
+		}
+	}
+}
+#endif
 
-	if (recorded_data->category == XRecordStartOfData) {
+// Pick up keymap and group changes reported by the settings thread.  Costs a
+// single atomic load unless something changed.
+static inline void refresh_keymap() {
+	unsigned int changes = take_key_table_changes();
+	if (changes & KEY_TABLE_KEYMAP) {
+		logger(LOG_LEVEL_DEBUG,	"%s [%u]: Reloading the keymap.\n",
+				__FUNCTION__, __LINE__);
+
+		#if defined(USE_XKBCOMMON)
+		if (hook->input.context != NULL && hook->input.connection != NULL) {
+			struct xkb_state *current = create_xkb_state(hook->input.context, hook->input.connection);
+			if (current != NULL) {
+				if (state != NULL) {
+					destroy_xkb_state(state);
+				}
+
+				state = current;
+				load_key_table(xkb_state_get_keymap(state));
+			}
+		}
+		#elif defined(USE_XKB)
+		reload_key_table(hook->ctrl.display);
+		#endif
+
+		initialize_modifiers();
+	}
+	#ifdef USE_XKBCOMMON
+	else if (changes & KEY_TABLE_GROUP) {
+		// The group of the xkb state only follows key events, not group
+		// switches requested by other clients.
+		resync_xkb_state();
+	}
+	#endif
+}
+
+// Translate a key to its keysym and the characters it types.
+static KeySym translate_key(KeyCode keycode, unsigned int modifier_mask, uint16_t *buffer, size_t *count) {
+	KeySym keysym = NoSymbol;
+	*count = 0;
+
+	#if defined(USE_XKBCOMMON)
+	if (state != NULL) {
+		const key_translation *key = lookup_key(state, keycode);
+		if (key != NULL) {
+			keysym = key->keysym;
+			*count = key->count;
+			memcpy(buffer, key->unicode, sizeof(key->unicode));
+		}
+		else {
+			keysym = xkb_state_key_get_one_sym(state, keycode);
+			*count = keycode_to_unicode(state, keycode, buffer, 2);
+		}
+	}
+	#elif defined(USE_XKB)
+	const key_translation *key = lookup_key(keycode, modifier_mask);
+	if (key != NULL) {
+		keysym = key->keysym;
+		*count = key->count;
+		memcpy(buffer, key->unicode, sizeof(key->unicode));
+	}
+	else {
+		keysym = keycode_to_keysym(keycode, modifier_mask);
+		*count = keysym_to_unicode(keysym, buffer, 2);
+	}
+	#else
+	keysym = keycode_to_keysym(keycode, modifier_mask);
+	*count = keysym_to_unicode(keysym, buffer, 2);
+	#endif
+
+	return keysym;
+}
+
+#ifdef HOOK_WAKE_PIPE
+static bool open_wake_pipe() {
+	if (pipe(hook->wake) != 0) {
+		logger(LOG_LEVEL_ERROR,	"%s [%u]: Failed to create the wake up pipe! (%d)\n",
+				__FUNCTION__, __LINE__, errno);
+
+		hook->wake[0] = -1;
+		hook->wake[1] = -1;
+		return false;
+	}
+
+	int i;
+	for (i = 0; i < 2; i++) {
+		fcntl(hook->wake[i], F_SETFL, fcntl(hook->wake[i], F_GETFL) | O_NONBLOCK);
+		fcntl(hook->wake[i], F_SETFD, FD_CLOEXEC);
+	}
+
+	return true;
+}
+
+static void close_wake_pipe() {
+	close(hook->wake[0]);
+	close(hook->wake[1]);
+	hook->wake[0] = -1;
+	hook->wake[1] = -1;
+}
+
+// Wake the hook thread up so it notices a change of running, paused or the
+// event mask.  Safe to call from any thread.
+static int hook_wake() {
+	int status = UIOHOOK_SUCCESS;
+
+	char byte = 0x00;
+	if (write(hook->wake[1], &byte, 1) < 0 && errno != EAGAIN) {
+		logger(LOG_LEVEL_ERROR,	"%s [%u]: Failed to wake the hook thread! (%d)\n",
+				__FUNCTION__, __LINE__, errno);
+
+		status = UIOHOOK_FAILURE;
+	}
 
+	return status;
+}
+
+// Sleep until the data display can be read or hook_wake() is called.
+static int wait_for_data(Display *display) {
+	struct pollfd fds[2];
+	fds[0].fd = ConnectionNumber(display);
+	fds[0].events = POLLIN;
+	fds[1].fd = hook->wake[0];
+	fds[1].events = POLLIN;
+
+	if (poll(fds, 2, -1) < 0 && errno != EINTR) {
+		logger(LOG_LEVEL_ERROR,	"%s [%u]: poll failure! (%d)\n",
+				__FUNCTION__, __LINE__, errno);
+
+		return UIOHOOK_FAILURE;
+	}
+
+	if (fds[1].revents & POLLIN) {
+		char buffer[64];
+		while (read(hook->wake[0], buffer, sizeof(buffer)) > 0) {
+			// Wake ups carry no data.
+		}
+	}
+
+	return UIOHOOK_SUCCESS;
+}
+#endif
+
+// Fire the hook start event, unless the hook is only being resumed.
+static void dispatch_hook_enabled(uint64_t timestamp) {
+	if (!hook_is_enabled) {
 		// Populate the hook start event.
 		event.time = timestamp;
 		event.reserved = 0x00;
@@ -277,535 +643,554 @@ void hook_event_proc(XPointer closeure, XRecordInterceptData *recorded_data) {
 		event.mask = 0x00;
 
 		// Fire the hook start event.
+		hook_is_enabled = true;
 		dispatch_event(&event);
 	}
-	else if (recorded_data->category == XRecordEndOfData) {
+}
+
+// Fire the hook stop event if the hook start event was fired.
+static void dispatch_hook_disabled() {
+	if (hook_is_enabled) {
 		// Populate the hook stop event.
-		event.time = timestamp;
 		event.reserved = 0x00;
 
 		event.type = EVENT_HOOK_DISABLED;
 		event.mask = 0x00;
 
 		// Fire the hook stop event.
+		hook_is_enabled = false;
 		dispatch_event(&event);
 	}
-	else if (recorded_data->category == XRecordFromServer || recorded_data->category == XRecordFromClient) {
-		// Get XRecord data.
-		XRecordDatum *data = (XRecordDatum *) recorded_data->data;
-
-		if (data->type == KeyPress) {
-			// The X11 KeyCode associated with this event.
-			KeyCode keycode = (KeyCode) data->event.u.u.detail;
-            KeySym keysym = 0x00;
-			#if defined(USE_XKBCOMMON)
-		   	if (state != NULL) {
-				keysym = xkb_state_key_get_one_sym(state, keycode);
-			}
-			#else
-			keysym = keycode_to_keysym(keycode, data->event.u.keyButtonPointer.state);
-			#endif
-
-			// Check to make sure the key is printable.
-			uint16_t buffer[2];
-			size_t count =  0;
-			#ifdef USE_XKBCOMMON
-			if (state != NULL) {
-				count = keycode_to_unicode(state, keycode, buffer, sizeof(buffer) / sizeof(uint16_t));
-			}
-			#else
-			count = keysym_to_unicode(keysym, buffer, sizeof(buffer) / sizeof(uint16_t));
-			#endif
-
-
-			unsigned short int scancode = keycode_to_scancode(keycode);
-
-			// TODO If you have a better suggestion for this ugly, let me know.
-			if		(scancode == VC_SHIFT_L)		{ set_modifier_mask(MASK_SHIFT_L);		}
-			else if (scancode == VC_SHIFT_R)		{ set_modifier_mask(MASK_SHIFT_R);		}
-			else if (scancode == VC_CONTROL_L)		{ set_modifier_mask(MASK_CTRL_L);		}
-			else if (scancode == VC_CONTROL_R)		{ set_modifier_mask(MASK_CTRL_R);		}
-			else if (scancode == VC_ALT_L)			{ set_modifier_mask(MASK_ALT_L);		}
-			else if (scancode == VC_ALT_R)			{ set_modifier_mask(MASK_ALT_R);		}
-			else if (scancode == VC_META_L)			{ set_modifier_mask(MASK_META_L);		}
-			else if (scancode == VC_META_R)			{ set_modifier_mask(MASK_META_R);		}
-			xkb_state_update_key(state, keycode, XKB_KEY_DOWN);
-			initialize_locks();
-
-
-			if ((get_modifiers() & MASK_NUM_LOCK) == 0) {
-				switch (scancode) {
-					case VC_KP_SEPARATOR:
-					case VC_KP_1:
-					case VC_KP_2:
-					case VC_KP_3:
-					case VC_KP_4:
-					case VC_KP_5:
-					case VC_KP_6:
-					case VC_KP_7:
-					case VC_KP_8:
-					case VC_KP_0:
-					case VC_KP_9:
-						scancode |= 0xEE00;
-						break;
-				}
-			}
+}
 
-			// Populate key pressed event.
-			event.time = timestamp;
-			event.reserved = 0x00;
+// Report system property changes picked up by the settings thread, and pick up
+// keymap changes, before the event they may apply to.
+static inline void refresh_input_state(uint64_t timestamp) {
+	unsigned int properties_generation = get_properties_generation();
+	if (properties_generation != hook->input.properties_generation) {
+		hook->input.properties_generation = properties_generation;
 
-			event.type = EVENT_KEY_PRESSED;
-			event.mask = get_modifiers();
+		event.time = timestamp;
+		event.reserved = 0x00;
 
-			event.data.keyboard.keycode = scancode;
-			event.data.keyboard.rawcode = keysym;
-			event.data.keyboard.keychar = CHAR_UNDEFINED;
+		event.type = EVENT_SYSTEM_PROPERTIES_CHANGED;
+		event.mask = 0x00;
+
+		dispatch_event(&event);
+	}
 
-			logger(LOG_LEVEL_INFO,	"%s [%u]: Key %#X pressed. (%#X)\n",
-					__FUNCTION__, __LINE__, event.data.keyboard.keycode, event.data.keyboard.rawcode);
+	refresh_keymap();
+}
 
-			// Fire key pressed event.
-			dispatch_event(&event);
+#ifdef HOOK_WAKE_PIPE
+// Report a system property change the settings thread woke us up for, unless
+// an input event already did.
+static void dispatch_properties_changed() {
+	if (get_properties_generation() != hook->input.properties_generation) {
+		refresh_input_state(get_properties_time());
+	}
+}
+#endif
+
+// Convert a root window position to event coordinates.
+static inline void set_event_position(int16_t *x, int16_t *y, int root_x, int root_y) {
+	*x = root_x;
+	*y = root_y;
 
-			// If the pressed event was not consumed...
-			if (event.reserved ^ 0x01) {
-				unsigned int i = 0;
-				for (i = 0; i < count; i++) {
-					// Populate key typed event.
-					event.time = timestamp;
-					event.reserved = 0x00;
+	#if defined(USE_XINERAMA) || defined(USE_XRANDR)
+	int16_t origin_x, origin_y;
+	get_screen_origin(&origin_x, &origin_y);
+	*x -= origin_x;
+	*y -= origin_y;
+	#endif
+}
 
-					event.type = EVENT_KEY_TYPED;
-					event.mask = get_modifiers();
+/* The process_* functions turn one X11 input event into uiohook events.  They
+ * do not depend on how the event was received, so every backend produces the
+ * same event stream.  The modifier mask is the core state of the event, which
+ * is only used when keys are not translated through xkbcommon.
+ */
 
-					event.data.keyboard.keycode = VC_UNDEFINED;
-					event.data.keyboard.rawcode = keysym;
-					event.data.keyboard.keychar = buffer[i];
+static void process_key_press(uint64_t timestamp, KeyCode keycode, unsigned int modifier_mask) {
+	// Check to make sure the key is printable.
+	uint16_t buffer[2];
+	size_t count =  0;
+	KeySym keysym = translate_key(keycode, modifier_mask, buffer, &count);
+
+	unsigned short int scancode = keycode_to_scancode(keycode);
+
+	// TODO If you have a better suggestion for this ugly, let me know.
+	if		(scancode == VC_SHIFT_L)		{ set_modifier_mask(MASK_SHIFT_L);		}
+	else if (scancode == VC_SHIFT_R)		{ set_modifier_mask(MASK_SHIFT_R);		}
+	else if (scancode == VC_CONTROL_L)		{ set_modifier_mask(MASK_CTRL_L);		}
+	else if (scancode == VC_CONTROL_R)		{ set_modifier_mask(MASK_CTRL_R);		}
+	else if (scancode == VC_ALT_L)			{ set_modifier_mask(MASK_ALT_L);		}
+	else if (scancode == VC_ALT_R)			{ set_modifier_mask(MASK_ALT_R);		}
+	else if (scancode == VC_META_L)			{ set_modifier_mask(MASK_META_L);		}
+	else if (scancode == VC_META_R)			{ set_modifier_mask(MASK_META_R);		}
+	#ifdef USE_XKBCOMMON
+	// Only a change of the LEDs can change the lock masks.
+	if (state != NULL && (xkb_state_update_key(state, keycode, XKB_KEY_DOWN) & XKB_STATE_LEDS)) {
+		update_locks();
+	}
+	#elif defined(USE_XKB)
+	update_key_locks(scancode, true);
+	#endif
 
-					logger(LOG_LEVEL_INFO,	"%s [%u]: Key %#X typed. (%lc)\n",
-							__FUNCTION__, __LINE__, event.data.keyboard.keycode, (uint16_t) event.data.keyboard.keychar);
 
-					// Fire key typed event.
-					dispatch_event(&event);
-				}
-			}
+	if ((get_modifiers() & MASK_NUM_LOCK) == 0) {
+		switch (scancode) {
+			case VC_KP_SEPARATOR:
+			case VC_KP_1:
+			case VC_KP_2:
+			case VC_KP_3:
+			case VC_KP_4:
+			case VC_KP_5:
+			case VC_KP_6:
+			case VC_KP_7:
+			case VC_KP_8:
+			case VC_KP_0:
+			case VC_KP_9:
+				scancode |= 0xEE00;
+				break;
 		}
-		else if (data->type == KeyRelease) {
-			// The X11 KeyCode associated with this event.
-			KeyCode keycode = (KeyCode) data->event.u.u.detail;
-			KeySym keysym = 0x00;
-			#ifdef USE_XKBCOMMON
-			if (state != NULL) {
-				keysym = xkb_state_key_get_one_sym(state, keycode);
-			}
-			#else
-			keysym = keycode_to_keysym(keycode, data->event.u.keyButtonPointer.state);
-			#endif
-
-			// Check to make sure the key is printable.
-			uint16_t buffer[2];
-			#ifdef USE_XKBCOMMON
-			if (state != NULL) {
-				keycode_to_unicode(state, keycode, buffer, sizeof(buffer) / sizeof(uint16_t));
-			}
-			#else
-			keysym_to_unicode(keysym, buffer, sizeof(buffer) / sizeof(uint16_t));
-			#endif
-
-			unsigned short int scancode = keycode_to_scancode(keycode);
-
-			// TODO If you have a better suggestion for this ugly, let me know.
-			if		(scancode == VC_SHIFT_L)		{ unset_modifier_mask(MASK_SHIFT_L);		}
-			else if (scancode == VC_SHIFT_R)		{ unset_modifier_mask(MASK_SHIFT_R);		}
-			else if (scancode == VC_CONTROL_L)		{ unset_modifier_mask(MASK_CTRL_L);			}
-			else if (scancode == VC_CONTROL_R)		{ unset_modifier_mask(MASK_CTRL_R);			}
-			else if (scancode == VC_ALT_L)			{ unset_modifier_mask(MASK_ALT_L);			}
-			else if (scancode == VC_ALT_R)			{ unset_modifier_mask(MASK_ALT_R);			}
-			else if (scancode == VC_META_L)			{ unset_modifier_mask(MASK_META_L);			}
-			else if (scancode == VC_META_R)			{ unset_modifier_mask(MASK_META_R);			}
-			xkb_state_update_key(state, keycode, XKB_KEY_UP);
-			initialize_locks();
-
-			if ((get_modifiers() & MASK_NUM_LOCK) == 0) {
-                switch (scancode) {
-					case VC_KP_SEPARATOR:
-					case VC_KP_1:
-					case VC_KP_2:
-					case VC_KP_3:
-					case VC_KP_4:
-					case VC_KP_5:
-					case VC_KP_6:
-					case VC_KP_7:
-					case VC_KP_8:
-					case VC_KP_0:
-					case VC_KP_9:
-						scancode |= 0xEE00;
-						break;
-                }
-			}
+	}
+
+	// Populate key pressed event.
+	event.time = timestamp;
+	event.reserved = 0x00;
+
+	event.type = EVENT_KEY_PRESSED;
+	event.mask = get_modifiers();
+
+	event.data.keyboard.keycode = scancode;
+	event.data.keyboard.rawcode = keysym;
+	event.data.keyboard.keychar = CHAR_UNDEFINED;
+
+	logger(LOG_LEVEL_INFO,	"%s [%u]: Key %#X pressed. (%#X)\n",
+			__FUNCTION__, __LINE__, event.data.keyboard.keycode, event.data.keyboard.rawcode);
 
-			// Populate key released event.
+	// Fire key pressed event.
+	dispatch_event(&event);
+
+	// If the pressed event was not consumed...
+	if (event.reserved ^ 0x01) {
+		unsigned int i = 0;
+		for (i = 0; i < count; i++) {
+			// Populate key typed event.
 			event.time = timestamp;
 			event.reserved = 0x00;
 
-			event.type = EVENT_KEY_RELEASED;
+			event.type = EVENT_KEY_TYPED;
 			event.mask = get_modifiers();
 
-			event.data.keyboard.keycode = scancode;
+			event.data.keyboard.keycode = VC_UNDEFINED;
 			event.data.keyboard.rawcode = keysym;
-			event.data.keyboard.keychar = CHAR_UNDEFINED;
+			event.data.keyboard.keychar = buffer[i];
 
-			logger(LOG_LEVEL_INFO, "%s [%u]: Key %#X released. (%#X)\n",
-					__FUNCTION__, __LINE__, event.data.keyboard.keycode, event.data.keyboard.rawcode);
+			logger(LOG_LEVEL_INFO,	"%s [%u]: Key %#X typed. (%lc)\n",
+					__FUNCTION__, __LINE__, event.data.keyboard.keycode, (uint16_t) event.data.keyboard.keychar);
 
-			// Fire key released event.
+			// Fire key typed event.
 			dispatch_event(&event);
 		}
-		else if (data->type == ButtonPress) {
-			// X11 handles wheel events as button events.
-			if (data->event.u.u.detail == WheelUp || data->event.u.u.detail == WheelDown
-					|| data->event.u.u.detail == WheelLeft || data->event.u.u.detail == WheelRight) {
-
-				// Reset the click count and previous button.
-				hook->input.mouse.click.count = 1;
-				hook->input.mouse.click.button = MOUSE_NOBUTTON;
-
-				/* Scroll wheel release events.
-				 * Scroll type: WHEEL_UNIT_SCROLL
-				 * Scroll amount: 3 unit increments per notch
-				 * Units to scroll: 3 unit increments
-				 * Vertical unit increment: 15 pixels
-				 */
-
-				// Populate mouse wheel event.
-				event.time = timestamp;
-				event.reserved = 0x00;
-
-				event.type = EVENT_MOUSE_WHEEL;
-				event.mask = get_modifiers();
-
-				event.data.wheel.clicks = hook->input.mouse.click.count;
-				event.data.wheel.x = data->event.u.keyButtonPointer.rootX;
-				event.data.wheel.y = data->event.u.keyButtonPointer.rootY;
-
-				#if defined(USE_XINERAMA) || defined(USE_XRANDR)
-				uint8_t count;
-				screen_data *screens = hook_create_screen_info(&count);
-				if (count > 1) {
-					event.data.wheel.x -= screens[0].x;
-					event.data.wheel.y -= screens[0].y;
-				}
+	}
+}
 
-				if (screens != NULL) {
-					free(screens);
-				}
-				#endif
+static void process_key_release(uint64_t timestamp, KeyCode keycode, unsigned int modifier_mask) {
+	uint16_t buffer[2];
+	size_t count = 0;
+	KeySym keysym = translate_key(keycode, modifier_mask, buffer, &count);
+
+	unsigned short int scancode = keycode_to_scancode(keycode);
+
+	// TODO If you have a better suggestion for this ugly, let me know.
+	if		(scancode == VC_SHIFT_L)		{ unset_modifier_mask(MASK_SHIFT_L);		}
+	else if (scancode == VC_SHIFT_R)		{ unset_modifier_mask(MASK_SHIFT_R);		}
+	else if (scancode == VC_CONTROL_L)		{ unset_modifier_mask(MASK_CTRL_L);			}
+	else if (scancode == VC_CONTROL_R)		{ unset_modifier_mask(MASK_CTRL_R);			}
+	else if (scancode == VC_ALT_L)			{ unset_modifier_mask(MASK_ALT_L);			}
+	else if (scancode == VC_ALT_R)			{ unset_modifier_mask(MASK_ALT_R);			}
+	else if (scancode == VC_META_L)			{ unset_modifier_mask(MASK_META_L);			}
+	else if (scancode == VC_META_R)			{ unset_modifier_mask(MASK_META_R);			}
+	#ifdef USE_XKBCOMMON
+	// Only a change of the LEDs can change the lock masks.
+	if (state != NULL && (xkb_state_update_key(state, keycode, XKB_KEY_UP) & XKB_STATE_LEDS)) {
+		update_locks();
+	}
+	#elif defined(USE_XKB)
+	update_key_locks(scancode, false);
+	#endif
 
-				/* X11 does not have an API call for acquiring the mouse scroll type.  This
-				 * maybe part of the XInput2 (XI2) extention but I will wont know until it
-				 * is available on my platform.  For the time being we will just use the
-				 * unit scroll value.
-				 */
-				event.data.wheel.type = WHEEL_UNIT_SCROLL;
-
-				/* Some scroll wheel properties are available via the new XInput2 (XI2)
-				 * extension.  Unfortunately the extension is not available on my
-				 * development platform at this time.  For the time being we will just
-				 * use the Windows default value of 3.
-				 */
-				event.data.wheel.amount = 3;
-
-				if (data->event.u.u.detail == WheelUp || data->event.u.u.detail == WheelLeft) {
-					// Wheel Rotated Up and Away.
-					event.data.wheel.rotation = -1;
-				}
-				else { // data->event.u.u.detail == WheelDown
-					// Wheel Rotated Down and Towards.
-					event.data.wheel.rotation = 1;
-				}
+	if ((get_modifiers() & MASK_NUM_LOCK) == 0) {
+		switch (scancode) {
+			case VC_KP_SEPARATOR:
+			case VC_KP_1:
+			case VC_KP_2:
+			case VC_KP_3:
+			case VC_KP_4:
+			case VC_KP_5:
+			case VC_KP_6:
+			case VC_KP_7:
+			case VC_KP_8:
+			case VC_KP_0:
+			case VC_KP_9:
+				scancode |= 0xEE00;
+				break;
+		}
+	}
 
-				if (data->event.u.u.detail == WheelUp || data->event.u.u.detail == WheelDown) {
-					// Wheel Rotated Up or Down.
-					event.data.wheel.direction = WHEEL_VERTICAL_DIRECTION;
-				}
-				else { // data->event.u.u.detail == WheelLeft || data->event.u.u.detail == WheelRight
-					// Wheel Rotated Left or Right.
-					event.data.wheel.direction = WHEEL_HORIZONTAL_DIRECTION;
-				}
+	// Populate key released event.
+	event.time = timestamp;
+	event.reserved = 0x00;
 
-				logger(LOG_LEVEL_INFO,	"%s [%u]: Mouse wheel type %u, rotated %i units in the %u direction at %u, %u.\n",
-						__FUNCTION__, __LINE__, event.data.wheel.type,
-						event.data.wheel.amount * event.data.wheel.rotation,
-                        event.data.wheel.direction,
-						event.data.wheel.x, event.data.wheel.y);
+	event.type = EVENT_KEY_RELEASED;
+	event.mask = get_modifiers();
 
-				// Fire mouse wheel event.
-				dispatch_event(&event);
-			}
-			else {
-				/* This information is all static for X11, its up to the WM to
-				 * decide how to interpret the wheel events.
-				 */
-				uint16_t button = MOUSE_NOBUTTON;
-				switch (data->event.u.u.detail) {
-					// FIXME This should use a lookup table to handle button remapping.
-					case Button1:
-						button = MOUSE_BUTTON1;
-						set_modifier_mask(MASK_BUTTON1);
-						break;
-
-					case Button2:
-						button = MOUSE_BUTTON2;
-						set_modifier_mask(MASK_BUTTON2);
-						break;
-
-					case Button3:
-						button = MOUSE_BUTTON3;
-						set_modifier_mask(MASK_BUTTON3);
-						break;
-
-					case XButton1:
-						button = MOUSE_BUTTON4;
-						set_modifier_mask(MASK_BUTTON5);
-						break;
-
-					case XButton2:
-						button = MOUSE_BUTTON5;
-						set_modifier_mask(MASK_BUTTON5);
-						break;
-
-					default:
-						// Do not set modifier masks past button MASK_BUTTON5.
-						break;
-				}
+	event.data.keyboard.keycode = scancode;
+	event.data.keyboard.rawcode = keysym;
+	event.data.keyboard.keychar = CHAR_UNDEFINED;
 
+	logger(LOG_LEVEL_INFO, "%s [%u]: Key %#X released. (%#X)\n",
+			__FUNCTION__, __LINE__, event.data.keyboard.keycode, event.data.keyboard.rawcode);
 
-				// Track the number of clicks, the button must match the previous button.
-				if (button == hook->input.mouse.click.button && (long int) (timestamp - hook->input.mouse.click.time) <= hook_get_multi_click_time()) {
-					if (hook->input.mouse.click.count < USHRT_MAX) {
-						hook->input.mouse.click.count++;
-					}
-					else {
-						logger(LOG_LEVEL_WARN, "%s [%u]: Click count overflow detected!\n",
-								__FUNCTION__, __LINE__);
-					}
-				}
-				else {
-					// Reset the click count.
-					hook->input.mouse.click.count = 1;
+	// Fire key released event.
+	dispatch_event(&event);
+}
 
-					// Set the previous button.
-					hook->input.mouse.click.button = button;
-				}
+// Fire a wheel event for one notch, a positive rotation is down or right.
+static void process_wheel(uint64_t timestamp, int root_x, int root_y, uint8_t direction, int16_t rotation) {
+	// Reset the click count and previous button.
+	hook->input.mouse.click.count = 1;
+	hook->input.mouse.click.button = MOUSE_NOBUTTON;
+
+	/* Scroll wheel release events.
+	 * Scroll type: WHEEL_UNIT_SCROLL
+	 * Scroll amount: 3 unit increments per notch
+	 * Units to scroll: 3 unit increments
+	 * Vertical unit increment: 15 pixels
+	 */
+
+	// Populate mouse wheel event.
+	event.time = timestamp;
+	event.reserved = 0x00;
+
+	event.type = EVENT_MOUSE_WHEEL;
+	event.mask = get_modifiers();
+
+	event.data.wheel.clicks = hook->input.mouse.click.count;
+	set_event_position(&event.data.wheel.x, &event.data.wheel.y, root_x, root_y);
+
+	/* X11 does not have an API call for acquiring the mouse scroll type.  The
+	 * XInput2 backend reports scroll valuators in units of their increment, so
+	 * both backends just use the unit scroll value.
+	 */
+	event.data.wheel.type = WHEEL_UNIT_SCROLL;
+
+	/* The amount per notch is not available from the X server.  For the time
+	 * being we will just use the Windows default value of 3.
+	 */
+	event.data.wheel.amount = 3;
+
+	event.data.wheel.rotation = rotation;
+	event.data.wheel.direction = direction;
+
+	logger(LOG_LEVEL_INFO,	"%s [%u]: Mouse wheel type %u, rotated %i units in the %u direction at %u, %u.\n",
+			__FUNCTION__, __LINE__, event.data.wheel.type,
+			event.data.wheel.amount * event.data.wheel.rotation,
+			event.data.wheel.direction,
+			event.data.wheel.x, event.data.wheel.y);
+
+	// Fire mouse wheel event.
+	dispatch_event(&event);
+}
 
-				// Save this events time to calculate the hook->input.mouse.click.count.
-				hook->input.mouse.click.time = timestamp;
+static void process_button_press(uint64_t timestamp, unsigned int core_button, int root_x, int root_y) {
+	// X11 handles wheel events as button events.
+	if (core_button == WheelUp || core_button == WheelDown
+			|| core_button == WheelLeft || core_button == WheelRight) {
 
+		int16_t rotation;
+		if (core_button == WheelUp || core_button == WheelLeft) {
+			// Wheel Rotated Up and Away.
+			rotation = -1;
+		}
+		else { // core_button == WheelDown
+			// Wheel Rotated Down and Towards.
+			rotation = 1;
+		}
 
-				// Populate mouse pressed event.
-				event.time = timestamp;
-				event.reserved = 0x00;
+		uint8_t direction;
+		if (core_button == WheelUp || core_button == WheelDown) {
+			// Wheel Rotated Up or Down.
+			direction = WHEEL_VERTICAL_DIRECTION;
+		}
+		else { // core_button == WheelLeft || core_button == WheelRight
+			// Wheel Rotated Left or Right.
+			direction = WHEEL_HORIZONTAL_DIRECTION;
+		}
 
-				event.type = EVENT_MOUSE_PRESSED;
-				event.mask = get_modifiers();
+		process_wheel(timestamp, root_x, root_y, direction, rotation);
+	}
+	else {
+		/* This information is all static for X11, its up to the WM to
+		 * decide how to interpret the wheel events.
+		 */
+		uint16_t button = MOUSE_NOBUTTON;
+		switch (core_button) {
+			// FIXME This should use a lookup table to handle button remapping.
+			case Button1:
+				button = MOUSE_BUTTON1;
+				set_modifier_mask(MASK_BUTTON1);
+				break;
+
+			case Button2:
+				button = MOUSE_BUTTON2;
+				set_modifier_mask(MASK_BUTTON2);
+				break;
+
+			case Button3:
+				button = MOUSE_BUTTON3;
+				set_modifier_mask(MASK_BUTTON3);
+				break;
+
+			case XButton1:
+				button = MOUSE_BUTTON4;
+				set_modifier_mask(MASK_BUTTON5);
+				break;
+
+			case XButton2:
+				button = MOUSE_BUTTON5;
+				set_modifier_mask(MASK_BUTTON5);
+				break;
+
+			default:
+				// Do not set modifier masks past button MASK_BUTTON5.
+				break;
+		}
 
-				event.data.mouse.button = button;
-				event.data.mouse.clicks = hook->input.mouse.click.count;
-				event.data.mouse.x = data->event.u.keyButtonPointer.rootX;
-				event.data.mouse.y = data->event.u.keyButtonPointer.rootY;
 
-				#if defined(USE_XINERAMA) || defined(USE_XRANDR)
-				uint8_t count;
-				screen_data *screens = hook_create_screen_info(&count);
-				if (count > 1) {
-					event.data.mouse.x -= screens[0].x;
-					event.data.mouse.y -= screens[0].y;
-				}
+		// Track the number of clicks, the button must match the previous button.
+		if (button == hook->input.mouse.click.button && (long int) (timestamp - hook->input.mouse.click.time) <= hook_get_multi_click_time()) {
+			if (hook->input.mouse.click.count < USHRT_MAX) {
+				hook->input.mouse.click.count++;
+			}
+			else {
+				logger(LOG_LEVEL_WARN, "%s [%u]: Click count overflow detected!\n",
+						__FUNCTION__, __LINE__);
+			}
+		}
+		else {
+			// Reset the click count.
+			hook->input.mouse.click.count = 1;
 
-				if (screens != NULL) {
-					free(screens);
-				}
-				#endif
+			// Set the previous button.
+			hook->input.mouse.click.button = button;
+		}
 
-				logger(LOG_LEVEL_INFO,	"%s [%u]: Button %u  pressed %u time(s). (%u, %u)\n",
-						__FUNCTION__, __LINE__, event.data.mouse.button, event.data.mouse.clicks,
-						event.data.mouse.x, event.data.mouse.y);
+		// Save this events time to calculate the hook->input.mouse.click.count.
+		hook->input.mouse.click.time = timestamp;
 
-				// Fire mouse pressed event.
-				dispatch_event(&event);
-			}
-		}
-		else if (data->type == ButtonRelease) {
-			// X11 handles wheel events as button events.
-			if (data->event.u.u.detail != WheelUp && data->event.u.u.detail != WheelDown) {
-				/* This information is all static for X11, its up to the WM to
-				 * decide how to interpret the wheel events.
-				 */
-				uint16_t button = MOUSE_NOBUTTON;
-				switch (data->event.u.u.detail) {
-					// FIXME This should use a lookup table to handle button remapping.
-					case Button1:
-						button = MOUSE_BUTTON1;
-						unset_modifier_mask(MASK_BUTTON1);
-						break;
-
-					case Button2:
-						button = MOUSE_BUTTON2;
-						unset_modifier_mask(MASK_BUTTON2);
-						break;
-
-					case Button3:
-						button = MOUSE_BUTTON3;
-						unset_modifier_mask(MASK_BUTTON3);
-						break;
-
-					case XButton1:
-						button = MOUSE_BUTTON4;
-						unset_modifier_mask(MASK_BUTTON5);
-						break;
-
-					case XButton2:
-						button = MOUSE_BUTTON5;
-						unset_modifier_mask(MASK_BUTTON5);
-						break;
-
-					default:
-						// Do not set modifier masks past button MASK_BUTTON5.
-						break;
-				}
 
-				// Populate mouse released event.
-				event.time = timestamp;
-				event.reserved = 0x00;
+		// Populate mouse pressed event.
+		event.time = timestamp;
+		event.reserved = 0x00;
 
-				event.type = EVENT_MOUSE_RELEASED;
-				event.mask = get_modifiers();
+		event.type = EVENT_MOUSE_PRESSED;
+		event.mask = get_modifiers();
 
-				event.data.mouse.button = button;
-				event.data.mouse.clicks = hook->input.mouse.click.count;
-				event.data.mouse.x = data->event.u.keyButtonPointer.rootX;
-				event.data.mouse.y = data->event.u.keyButtonPointer.rootY;
+		event.data.mouse.button = button;
+		event.data.mouse.clicks = hook->input.mouse.click.count;
+		set_event_position(&event.data.mouse.x, &event.data.mouse.y, root_x, root_y);
 
-				#if defined(USE_XINERAMA) || defined(USE_XRANDR)
-				uint8_t count;
-				screen_data *screens = hook_create_screen_info(&count);
-				if (count > 1) {
-					event.data.mouse.x -= screens[0].x;
-					event.data.mouse.y -= screens[0].y;
-				}
+		logger(LOG_LEVEL_INFO,	"%s [%u]: Button %u  pressed %u time(s). (%u, %u)\n",
+				__FUNCTION__, __LINE__, event.data.mouse.button, event.data.mouse.clicks,
+				event.data.mouse.x, event.data.mouse.y);
 
-				if (screens != NULL) {
-					free(screens);
-				}
-				#endif
+		// Fire mouse pressed event.
+		dispatch_event(&event);
+	}
+}
 
-				logger(LOG_LEVEL_INFO,	"%s [%u]: Button %u released %u time(s). (%u, %u)\n",
-						__FUNCTION__, __LINE__, event.data.mouse.button,
-						event.data.mouse.clicks,
-						event.data.mouse.x, event.data.mouse.y);
-
-				// Fire mouse released event.
-				dispatch_event(&event);
-
-				// If the pressed event was not consumed...
-				if (event.reserved ^ 0x01 && hook->input.mouse.is_dragged != true) {
-					// Populate mouse clicked event.
-					event.time = timestamp;
-					event.reserved = 0x00;
-
-					event.type = EVENT_MOUSE_CLICKED;
-					event.mask = get_modifiers();
-
-					event.data.mouse.button = button;
-					event.data.mouse.clicks = hook->input.mouse.click.count;
-					event.data.mouse.x = data->event.u.keyButtonPointer.rootX;
-					event.data.mouse.y = data->event.u.keyButtonPointer.rootY;
-
-					#if defined(USE_XINERAMA) || defined(USE_XRANDR)
-					uint8_t count;
-					screen_data *screens = hook_create_screen_info(&count);
-					if (count > 1) {
-						event.data.mouse.x -= screens[0].x;
-						event.data.mouse.y -= screens[0].y;
-					}
+static void process_button_release(uint64_t timestamp, unsigned int core_button, int root_x, int root_y) {
+	// X11 handles wheel events as button events.
+	if (core_button != WheelUp && core_button != WheelDown) {
+		/* This information is all static for X11, its up to the WM to
+		 * decide how to interpret the wheel events.
+		 */
+		uint16_t button = MOUSE_NOBUTTON;
+		switch (core_button) {
+			// FIXME This should use a lookup table to handle button remapping.
+			case Button1:
+				button = MOUSE_BUTTON1;
+				unset_modifier_mask(MASK_BUTTON1);
+				break;
+
+			case Button2:
+				button = MOUSE_BUTTON2;
+				unset_modifier_mask(MASK_BUTTON2);
+				break;
+
+			case Button3:
+				button = MOUSE_BUTTON3;
+				unset_modifier_mask(MASK_BUTTON3);
+				break;
+
+			case XButton1:
+				button = MOUSE_BUTTON4;
+				unset_modifier_mask(MASK_BUTTON5);
+				break;
+
+			case XButton2:
+				button = MOUSE_BUTTON5;
+				unset_modifier_mask(MASK_BUTTON5);
+				break;
+
+			default:
+				// Do not set modifier masks past button MASK_BUTTON5.
+				break;
+		}
 
-					if (screens != NULL) {
-						free(screens);
-					}
-					#endif
+		// Populate mouse released event.
+		event.time = timestamp;
+		event.reserved = 0x00;
 
-					logger(LOG_LEVEL_INFO,	"%s [%u]: Button %u clicked %u time(s). (%u, %u)\n",
-							__FUNCTION__, __LINE__, event.data.mouse.button,
-							event.data.mouse.clicks,
-							event.data.mouse.x, event.data.mouse.y);
+		event.type = EVENT_MOUSE_RELEASED;
+		event.mask = get_modifiers();
 
-					// Fire mouse clicked event.
-					dispatch_event(&event);
-				}
+		event.data.mouse.button = button;
+		event.data.mouse.clicks = hook->input.mouse.click.count;
+		set_event_position(&event.data.mouse.x, &event.data.mouse.y, root_x, root_y);
 
-				// Reset the number of clicks.
-				if (button == hook->input.mouse.click.button && (long int) (event.time - hook->input.mouse.click.time) > hook_get_multi_click_time()) {
-					// Reset the click count.
-					hook->input.mouse.click.count = 0;
-				}
-			}
-		}
-		else if (data->type == MotionNotify) {
-			// Reset the click count.
-			if (hook->input.mouse.click.count != 0 && (long int) (timestamp - hook->input.mouse.click.time) > hook_get_multi_click_time()) {
-				hook->input.mouse.click.count = 0;
-			}
+		logger(LOG_LEVEL_INFO,	"%s [%u]: Button %u released %u time(s). (%u, %u)\n",
+				__FUNCTION__, __LINE__, event.data.mouse.button,
+				event.data.mouse.clicks,
+				event.data.mouse.x, event.data.mouse.y);
 
-			// Populate mouse move event.
+		// Fire mouse released event.
+		dispatch_event(&event);
+
+		// If the pressed event was not consumed...
+		if (event.reserved ^ 0x01 && hook->input.mouse.is_dragged != true) {
+			// Populate mouse clicked event.
 			event.time = timestamp;
 			event.reserved = 0x00;
 
+			event.type = EVENT_MOUSE_CLICKED;
 			event.mask = get_modifiers();
 
-			// Check the upper half of virtual modifiers for non-zero values and set the mouse
-			// dragged flag.  The last 3 bits are reserved for lock masks.
-			hook->input.mouse.is_dragged = ((event.mask & 0x1F00) > 0);
-			if (hook->input.mouse.is_dragged) {
-				// Create Mouse Dragged event.
-				event.type = EVENT_MOUSE_DRAGGED;
-			}
-			else {
-				// Create a Mouse Moved event.
-				event.type = EVENT_MOUSE_MOVED;
-			}
-
-			event.data.mouse.button = MOUSE_NOBUTTON;
+			event.data.mouse.button = button;
 			event.data.mouse.clicks = hook->input.mouse.click.count;
-			event.data.mouse.x = data->event.u.keyButtonPointer.rootX;
-			event.data.mouse.y = data->event.u.keyButtonPointer.rootY;
-
-			#if defined(USE_XINERAMA) || defined(USE_XRANDR)
-			uint8_t count;
-			screen_data *screens = hook_create_screen_info(&count);
-			if (count > 1) {
-				event.data.mouse.x -= screens[0].x;
-				event.data.mouse.y -= screens[0].y;
-			}
+			set_event_position(&event.data.mouse.x, &event.data.mouse.y, root_x, root_y);
 
-			if (screens != NULL) {
-				free(screens);
-			}
-			#endif
+			logger(LOG_LEVEL_INFO,	"%s [%u]: Button %u clicked %u time(s). (%u, %u)\n",
+					__FUNCTION__, __LINE__, event.data.mouse.button,
+					event.data.mouse.clicks,
+					event.data.mouse.x, event.data.mouse.y);
 
-			logger(LOG_LEVEL_INFO,	"%s [%u]: Mouse %s to %i, %i. (%#X)\n",
-					__FUNCTION__, __LINE__, hook->input.mouse.is_dragged ? "dragged" : "moved",
-					event.data.mouse.x, event.data.mouse.y, event.mask);
-
-			// Fire mouse move event.
+			// Fire mouse clicked event.
 			dispatch_event(&event);
 		}
-		else {
-			// In theory this *should* never execute.
-			logger(LOG_LEVEL_DEBUG,	"%s [%u]: Unhandled X11 event: %#X.\n",
-					__FUNCTION__, __LINE__, (unsigned int) data->type);
+
+		// Reset the number of clicks.
+		if (button == hook->input.mouse.click.button && (long int) (event.time - hook->input.mouse.click.time) > hook_get_multi_click_time()) {
+			// Reset the click count.
+			hook->input.mouse.click.count = 0;
 		}
 	}
+}
+
+static void process_motion(uint64_t timestamp, int root_x, int root_y) {
+	// Reset the click count.
+	if (hook->input.mouse.click.count != 0 && (long int) (timestamp - hook->input.mouse.click.time) > hook_get_multi_click_time()) {
+		hook->input.mouse.click.count = 0;
+	}
+
+	// Populate mouse move event.
+	event.time = timestamp;
+	event.reserved = 0x00;
+
+	event.mask = get_modifiers();
+
+	// Check the upper half of virtual modifiers for non-zero values and set the mouse
+	// dragged flag.  The last 3 bits are reserved for lock masks.
+	hook->input.mouse.is_dragged = ((event.mask & 0x1F00) > 0);
+	if (hook->input.mouse.is_dragged) {
+		// Create Mouse Dragged event.
+		event.type = EVENT_MOUSE_DRAGGED;
+	}
+	else {
+		// Create a Mouse Moved event.
+		event.type = EVENT_MOUSE_MOVED;
+	}
+
+	event.data.mouse.button = MOUSE_NOBUTTON;
+	event.data.mouse.clicks = hook->input.mouse.click.count;
+	set_event_position(&event.data.mouse.x, &event.data.mouse.y, root_x, root_y);
+
+	logger(LOG_LEVEL_INFO,	"%s [%u]: Mouse %s to %i, %i. (%#X)\n",
+			__FUNCTION__, __LINE__, hook->input.mouse.is_dragged ? "dragged" : "moved",
+			event.data.mouse.x, event.data.mouse.y, event.mask);
+
+	// Fire mouse move event.
+	dispatch_event(&event);
+}
+
+// Handle one recorded device event.
+static void process_recorded_event(uint64_t timestamp, const XRecordDatum *data) {
+	if (data->type < HOOK_STATS_INPUT_TYPES) {
+		stats_add(&stats.received[data->type], 1);
+	}
+
+	refresh_input_state(timestamp);
+
+	if (data->type == KeyPress) {
+		process_key_press(timestamp, (KeyCode) data->event.u.u.detail, data->event.u.keyButtonPointer.state);
+	}
+	else if (data->type == KeyRelease) {
+		process_key_release(timestamp, (KeyCode) data->event.u.u.detail, data->event.u.keyButtonPointer.state);
+	}
+	else if (data->type == ButtonPress) {
+		process_button_press(timestamp, data->event.u.u.detail,
+				data->event.u.keyButtonPointer.rootX, data->event.u.keyButtonPointer.rootY);
+	}
+	else if (data->type == ButtonRelease) {
+		process_button_release(timestamp, data->event.u.u.detail,
+				data->event.u.keyButtonPointer.rootX, data->event.u.keyButtonPointer.rootY);
+	}
+	else if (data->type == MotionNotify) {
+		process_motion(timestamp,
+				data->event.u.keyButtonPointer.rootX, data->event.u.keyButtonPointer.rootY);
+	}
+	else {
+		// In theory this *should* never execute.
+		logger(LOG_LEVEL_DEBUG,	"%s [%u]: Unhandled X11 event: %#X.\n",
+				__FUNCTION__, __LINE__, (unsigned int) data->type);
+	}
+}
+
+void hook_event_proc(XPointer closeure, XRecordInterceptData *recorded_data) {
+	stamp_input_time();
+
+	uint64_t timestamp = (uint64_t) recorded_data->server_time;
+
+	if (recorded_data->category == XRecordStartOfData) {
+		// The context is also re-enabled by hook_resume(), which is not a
+		// new start as far as the dispatcher is concerned.
+		dispatch_hook_enabled(timestamp);
+	}
+	else if (recorded_data->category == XRecordEndOfData) {
+		// The context is also disabled by hook_pause(), so the hook stop
+		// event is fired by xrecord_block() once the hook really exits.
+		event.time = timestamp;
+	}
+	else if (recorded_data->category == XRecordFromServer || recorded_data->category == XRecordFromClient) {
+		stats_add(&stats.replies, 1);
+		stats_add(&stats.bytes, recorded_data->data_len * 4);
+
+		// Get XRecord data.
+		process_recorded_event(timestamp, (XRecordDatum *) recorded_data->data);
+	}
 	else {
 		logger(LOG_LEVEL_WARN,	"%s [%u]: Unhandled X11 hook category! (%#X)\n",
 				__FUNCTION__, __LINE__, recorded_data->category);
@@ -817,6 +1202,7 @@ void hook_event_proc(XPointer closeure, XRecordInterceptData *recorded_data) {
 }
 
 
+
 static inline bool enable_key_repeate() {
 	// Attempt to setup detectable autorepeat.
 	// NOTE: is_auto_repeat is NOT stdbool!
@@ -837,159 +1223,1019 @@ static inline bool enable_key_repeate() {
 }
 
 
-static inline int xrecord_block() {
+#ifdef USE_XCB_RECORD
+static int xrecord_xcb_enable();
+#endif
+
+// Enable the XRecord context and block until it is disabled again by either
+// hook_pause() or hook_stop().
+static inline int xrecord_enable() {
 	int status = UIOHOOK_FAILURE;
 
+	#ifdef USE_XCB_RECORD
+	if (hook->backend == HOOK_BACKEND_XCB_RECORD) {
+		return xrecord_xcb_enable();
+	}
+	#endif
+
 	// Save the data display associated with this hook so it is passed to each event.
 	//XPointer closeure = (XPointer) (ctrl_display);
 	XPointer closeure = NULL;
 
-	#ifdef USE_XRECORD_ASYNC
-	// Async requires that we loop so that our thread does not return.
-	if (XRecordEnableContextAsync(hook->data.display, context, hook_event_proc, closeure) != 0) {
-		// Time in MS to sleep the runloop.
-		int timesleep = 100;
+	#ifdef USE_XRECORD_ASYNC
+	// Async requires that we loop so that our thread does not return.
+	if (XRecordEnableContextAsync(hook->data.display, hook->ctrl.context, hook_event_proc, closeure) != 0) {
+		// Set the exit status.
+		status = UIOHOOK_SUCCESS;
+
+		// Allow the thread loop to block.
+		pthread_mutex_lock(&hook_xrecord_mutex);
+		while (running && !paused && status == UIOHOOK_SUCCESS) {
+			// Unlock the mutex from the previous iteration.
+			pthread_mutex_unlock(&hook_xrecord_mutex);
+
+			// Handle every reply that arrived, then sleep until the server
+			// sends more or hook_stop() or hook_pause() wake us up.
+			XRecordProcessReplies(hook->data.display);
+			dispatch_properties_changed();
+			status = wait_for_data(hook->data.display);
+
+			pthread_mutex_lock(&hook_xrecord_mutex);
+		}
+
+		// Unlock after loop exit.
+		pthread_mutex_unlock(&hook_xrecord_mutex);
+
+		// Pick up anything left over, including XRecordEndOfData.
+		XRecordProcessReplies(hook->data.display);
+	}
+	#else
+	// Sync blocks until XRecordDisableContext() is called.
+	if (XRecordEnableContext(hook->data.display, hook->ctrl.context, hook_event_proc, closeure) != 0) {
+		status = UIOHOOK_SUCCESS;
+	}
+	#endif
+	else {
+		logger(LOG_LEVEL_ERROR,	"%s [%u]: XRecordEnableContext failure!\n",
+			__FUNCTION__, __LINE__);
+
+		// Set the exit status.
+		status = UIOHOOK_ERROR_X_RECORD_ENABLE_CONTEXT;
+	}
+
+	return status;
+}
+
+// Last device event the XRecord range has to cover for an event mask.  Key
+// events are always recorded because modifier and xkb state is tracked from
+// them, and motion needs button events to tell moves from drags.
+static unsigned char xrecord_range_last(uint32_t mask) {
+	if (mask & EVENT_MASK_MOUSE_MOTION) {
+		return MotionNotify;
+	}
+	else if (mask & (EVENT_MASK_MOUSE_BUTTON | EVENT_MASK_MOUSE_WHEEL)) {
+		return ButtonRelease;
+	}
+
+	return KeyRelease;
+}
+
+// Narrow or widen the recorded range to the current event mask, so the X
+// server never sends event classes nobody listens to.  This works whether or
+// not the context is enabled.
+// NOTE Must be called with hook_xrecord_mutex held.
+static int xrecord_update_range() {
+	int status = UIOHOOK_SUCCESS;
+
+	unsigned char last = xrecord_range_last(__atomic_load_n(&dispatch_event_mask, __ATOMIC_RELAXED));
+	if (hook->data.range->device_events.last != last) {
+		hook->data.range->device_events.last = last;
+
+		XRecordClientSpec clients = XRecordAllClients;
+		if (XRecordRegisterClients(hook->ctrl.display, hook->ctrl.context, 0, &clients, 1, &hook->data.range, 1) != 0) {
+			XSync(hook->ctrl.display, False);
+
+			logger(LOG_LEVEL_DEBUG,	"%s [%u]: Recording device events %u through %u.\n",
+					__FUNCTION__, __LINE__, KeyPress, last);
+		}
+		else {
+			logger(LOG_LEVEL_ERROR,	"%s [%u]: XRecordRegisterClients failure!\n",
+					__FUNCTION__, __LINE__);
+
+			status = UIOHOOK_ERROR_X_RECORD_REGISTER_CLIENTS;
+		}
+	}
+
+	return status;
+}
+
+static inline int xrecord_block() {
+	int status = UIOHOOK_FAILURE;
+
+	pthread_mutex_lock(&hook_xrecord_mutex);
+	running = true;
+	paused = false;
+
+	// Pick up a mask set while the context was being created.
+	xrecord_update_range();
+
+	do {
+		pthread_mutex_unlock(&hook_xrecord_mutex);
+
+		status = xrecord_enable();
+
+		pthread_mutex_lock(&hook_xrecord_mutex);
+		if (status == UIOHOOK_SUCCESS && running && paused) {
+			logger(LOG_LEVEL_DEBUG,	"%s [%u]: Hook paused.\n",
+					__FUNCTION__, __LINE__);
+
+			// Keep the displays and keymap loaded and wait for hook_resume()
+			// or hook_stop().
+			while (running && paused) {
+				pthread_cond_wait(&hook_xrecord_cond, &hook_xrecord_mutex);
+			}
+
+			if (running) {
+				logger(LOG_LEVEL_DEBUG,	"%s [%u]: Hook resumed.\n",
+						__FUNCTION__, __LINE__);
+
+				// Input that happened while paused was not seen, so pick up the
+				// current modifier state again.
+				pthread_mutex_unlock(&hook_xrecord_mutex);
+				#ifdef USE_XKBCOMMON
+				resync_xkb_state();
+				#endif
+				initialize_modifiers();
+				pthread_mutex_lock(&hook_xrecord_mutex);
+			}
+		}
+	} while (status == UIOHOOK_SUCCESS && running);
+
+	running = false;
+	paused = false;
+	pthread_mutex_unlock(&hook_xrecord_mutex);
+
+	dispatch_hook_disabled();
+
+	return status;
+}
+
+static int xrecord_alloc() {
+	int status = UIOHOOK_FAILURE;
+
+	// Make sure the data display is synchronized to prevent late event delivery!
+	// See Bug 42356 for more information.
+	// https://bugs.freedesktop.org/show_bug.cgi?id=42356#c4
+	XSynchronize(hook->data.display, True);
+
+	// Setup XRecord range.
+	XRecordClientSpec clients = XRecordAllClients;
+
+	hook->data.range = XRecordAllocRange();
+	if (hook->data.range != NULL) {
+		logger(LOG_LEVEL_DEBUG,	"%s [%u]: XRecordAllocRange successful.\n",
+				__FUNCTION__, __LINE__);
+
+		hook->data.range->device_events.first = KeyPress;
+		hook->data.range->device_events.last = xrecord_range_last(__atomic_load_n(&dispatch_event_mask, __ATOMIC_RELAXED));
+
+		// Note that the documentation for this function is incorrect,
+		// hook->data.display should be used!
+		// See: http://www.x.org/releases/X11R7.6/doc/libXtst/recordlib.txt
+		hook->ctrl.context = XRecordCreateContext(hook->data.display, XRecordFromServerTime, &clients, 1, &hook->data.range, 1);
+		if (hook->ctrl.context != 0) {
+			logger(LOG_LEVEL_DEBUG,	"%s [%u]: XRecordCreateContext successful.\n",
+					__FUNCTION__, __LINE__);
+
+			// Block until hook_stop() is called.
+			status = xrecord_block();
+
+			// Free up the context if it was set.
+			XRecordFreeContext(hook->data.display, hook->ctrl.context);
+		}
+		else {
+			logger(LOG_LEVEL_ERROR,	"%s [%u]: XRecordCreateContext failure!\n",
+					__FUNCTION__, __LINE__);
+
+			// Set the exit status.
+			status = UIOHOOK_ERROR_X_RECORD_CREATE_CONTEXT;
+		}
+
+		// Free the XRecord range.
+		XFree(hook->data.range);
+	}
+	else {
+		logger(LOG_LEVEL_ERROR,	"%s [%u]: XRecordAllocRange failure!\n",
+				__FUNCTION__, __LINE__);
+
+		// Set the exit status.
+		status = UIOHOOK_ERROR_X_RECORD_ALLOC_RANGE;
+	}
+
+	return status;
+}
+
+static int xrecord_query() {
+	int status = UIOHOOK_FAILURE;
+
+	// Check to make sure XRecord is installed and enabled.
+	int major, minor;
+	if (XRecordQueryVersion(hook->ctrl.display, &major, &minor) != 0) {
+		logger(LOG_LEVEL_INFO,	"%s [%u]: XRecord version: %i.%i.\n",
+				__FUNCTION__, __LINE__, major, minor);
+
+		status = xrecord_alloc();
+	}
+	else {
+		logger(LOG_LEVEL_ERROR,	"%s [%u]: XRecord is not currently available!\n",
+				__FUNCTION__, __LINE__);
+
+		status = UIOHOOK_ERROR_X_RECORD_NOT_FOUND;
+	}
+
+	return status;
+}
+
+#ifdef USE_XCB_RECORD
+/* xcb-record backend.
+ *
+ * The same XRecord context as the Xlib backend, enabled on a plain xcb
+ * connection.  Xlib hands every recorded event to hook_event_proc() in its own
+ * allocation, under the display lock and on a synchronous display.  Here each
+ * reply is parsed in place instead, and a reply carries every event the
+ * server recorded since it last flushed the connection, so bursts of motion
+ * cost one read and one allocation.  The context is still controlled through
+ * the Xlib control display, which only needs its id.
+ */
+
+// Handle the intercepted data of one reply to the enable request.
+static void xrecord_xcb_process_reply(const xcb_record_enable_context_reply_t *reply) {
+	stamp_input_time();
+
+	const uint8_t *data = xcb_record_enable_context_data(reply);
+	int length = xcb_record_enable_context_data_length(reply);
+
+	stats_add(&stats.replies, 1);
+	stats_add(&stats.bytes, length);
+
+	while (length > 0) {
+		uint64_t timestamp = (uint64_t) reply->server_time;
+
+		// Every element is preceded by its server time.
+		if (reply->element_header & XCB_RECORD_H_TYPE_FROM_SERVER_TIME) {
+			if (length < (int) sizeof(uint32_t)) {
+				break;
+			}
+
+			uint32_t server_time;
+			memcpy(&server_time, data, sizeof(server_time));
+			timestamp = (uint64_t) server_time;
+
+			data += sizeof(uint32_t);
+			length -= sizeof(uint32_t);
+		}
+
+		// Only device events are recorded, which are all the size of xEvent.
+		if (length < (int) sizeof(xEvent)) {
+			logger(LOG_LEVEL_WARN,	"%s [%u]: Discarding %i bytes of truncated data!\n",
+					__FUNCTION__, __LINE__, length);
+			break;
+		}
+
+		process_recorded_event(timestamp, (const XRecordDatum *) data);
+
+		data += sizeof(xEvent);
+		length -= sizeof(xEvent);
+	}
+}
+
+// Enable the XRecord context and read its replies until it is disabled again
+// by either hook_pause() or hook_stop().
+static int xrecord_xcb_enable() {
+	int status = UIOHOOK_SUCCESS;
+
+	xcb_record_enable_context_cookie_t cookie = xcb_record_enable_context(hook->data.connection, hook->ctrl.context);
+	xcb_flush(hook->data.connection);
+
+	bool enabled = true;
+	while (enabled) {
+		xcb_generic_error_t *error = NULL;
+		xcb_record_enable_context_reply_t *reply = xcb_record_enable_context_reply(hook->data.connection, cookie, &error);
+		if (reply == NULL) {
+			logger(LOG_LEVEL_ERROR,	"%s [%u]: xcb_record_enable_context failure! (%d)\n",
+					__FUNCTION__, __LINE__, error != NULL ? error->error_code : -1);
+
+			if (error != NULL) {
+				free(error);
+			}
+
+			status = UIOHOOK_ERROR_X_RECORD_ENABLE_CONTEXT;
+			break;
+		}
+
+		switch (reply->category) {
+			case XRecordStartOfData:
+				// The context is also re-enabled by hook_resume(), which is
+				// not a new start as far as the dispatcher is concerned.
+				dispatch_hook_enabled((uint64_t) reply->server_time);
+				break;
+
+			case XRecordEndOfData:
+				// The hook stop event is fired by xrecord_block() once the
+				// hook really exits.
+				event.time = (uint64_t) reply->server_time;
+				enabled = false;
+				break;
+
+			case XRecordFromServer:
+				xrecord_xcb_process_reply(reply);
+				break;
+
+			default:
+				logger(LOG_LEVEL_WARN,	"%s [%u]: Unhandled X11 hook category! (%#X)\n",
+						__FUNCTION__, __LINE__, reply->category);
+				break;
+		}
+
+		free(reply);
+	}
+
+	return status;
+}
+
+static int xrecord_xcb_alloc() {
+	int status = UIOHOOK_FAILURE;
+
+	// Keeps the range of the event mask for xrecord_update_range().
+	hook->data.range = XRecordAllocRange();
+	if (hook->data.range != NULL) {
+		hook->data.range->device_events.first = KeyPress;
+		hook->data.range->device_events.last = xrecord_range_last(__atomic_load_n(&dispatch_event_mask, __ATOMIC_RELAXED));
+
+		xcb_record_range_t range;
+		memset(&range, 0, sizeof(range));
+		range.device_events.first = hook->data.range->device_events.first;
+		range.device_events.last = hook->data.range->device_events.last;
+
+		xcb_record_client_spec_t clients = XCB_RECORD_CS_ALL_CLIENTS;
+
+		hook->ctrl.context = xcb_generate_id(hook->data.connection);
+		xcb_void_cookie_t cookie = xcb_record_create_context_checked(hook->data.connection, hook->ctrl.context,
+				XCB_RECORD_H_TYPE_FROM_SERVER_TIME, 1, 1, &clients, &range);
+
+		xcb_generic_error_t *error = xcb_request_check(hook->data.connection, cookie);
+		if (error == NULL) {
+			logger(LOG_LEVEL_DEBUG,	"%s [%u]: xcb_record_create_context successful.\n",
+					__FUNCTION__, __LINE__);
+
+			// Block until hook_stop() is called.
+			status = xrecord_block();
+
+			// Free up the context.
+			xcb_record_free_context(hook->data.connection, hook->ctrl.context);
+			xcb_flush(hook->data.connection);
+		}
+		else {
+			logger(LOG_LEVEL_ERROR,	"%s [%u]: xcb_record_create_context failure! (%d)\n",
+					__FUNCTION__, __LINE__, error->error_code);
+
+			free(error);
+
+			// Set the exit status.
+			status = UIOHOOK_ERROR_X_RECORD_CREATE_CONTEXT;
+		}
+		hook->ctrl.context = 0;
+
+		// Free the XRecord range.
+		XFree(hook->data.range);
+	}
+	else {
+		logger(LOG_LEVEL_ERROR,	"%s [%u]: XRecordAllocRange failure!\n",
+				__FUNCTION__, __LINE__);
+
+		// Set the exit status.
+		status = UIOHOOK_ERROR_X_RECORD_ALLOC_RANGE;
+	}
+
+	return status;
+}
+
+static int xrecord_xcb_query() {
+	int status = UIOHOOK_FAILURE;
+
+	// Check to make sure XRecord is installed and enabled.
+	xcb_record_query_version_reply_t *version = xcb_record_query_version_reply(hook->data.connection,
+			xcb_record_query_version(hook->data.connection, 1, 13), NULL);
+	if (version != NULL) {
+		logger(LOG_LEVEL_INFO,	"%s [%u]: XRecord version: %i.%i.\n",
+				__FUNCTION__, __LINE__, version->major_version, version->minor_version);
+
+		free(version);
+
+		status = xrecord_xcb_alloc();
+	}
+	else {
+		logger(LOG_LEVEL_ERROR,	"%s [%u]: XRecord is not currently available!\n",
+				__FUNCTION__, __LINE__);
+
+		status = UIOHOOK_ERROR_X_RECORD_NOT_FOUND;
+	}
+
+	return status;
+}
+#endif
+
+#ifdef USE_XINPUT2
+/* XInput2 backend.
+ *
+ * Raw events are selected on the root window of the data display and read by
+ * the hook thread itself, so there is no RECORD context and the data display
+ * does not have to be synchronous.  Raw events are delivered before pointer
+ * acceleration and grabs, but they carry neither a position nor a modifier
+ * state, so the pointer is queried for the events that need a position and
+ * the core modifier state is tracked alongside.  The server does not send raw
+ * events for auto-repeated keys.
+ */
+
+// Raw events needed for an event mask.  Key events are always selected because
+// modifier and xkb state is tracked from them, motion needs button events to
+// tell moves from drags, and smooth scrolling arrives as motion.
+static void xinput_event_mask(uint32_t mask, unsigned char *bits) {
+	XISetMask(bits, XI_RawKeyPress);
+	XISetMask(bits, XI_RawKeyRelease);
+
+	if (mask & (EVENT_MASK_MOUSE_BUTTON | EVENT_MASK_MOUSE_WHEEL | EVENT_MASK_MOUSE_MOTION)) {
+		XISetMask(bits, XI_RawButtonPress);
+		XISetMask(bits, XI_RawButtonRelease);
+	}
+
+	if (mask & (EVENT_MASK_MOUSE_MOTION | EVENT_MASK_MOUSE_WHEEL)) {
+		XISetMask(bits, XI_RawMotion);
+	}
+}
+
+// Select the raw events for an event mask on the root window, or nothing at
+// all while the hook is paused.
+static void xinput_select(bool enable, uint32_t mask) {
+	unsigned char raw_bits[XIMaskLen(XI_LASTEVENT)] = { 0 };
+	unsigned char device_bits[XIMaskLen(XI_LASTEVENT)] = { 0 };
+
+	if (enable) {
+		xinput_event_mask(mask, raw_bits);
+
+		// Scroll valuators change with the devices.
+		XISetMask(device_bits, XI_HierarchyChanged);
+		XISetMask(device_bits, XI_DeviceChanged);
+	}
+
+	XIEventMask masks[2];
+	masks[0].deviceid = XIAllMasterDevices;
+	masks[0].mask_len = sizeof(raw_bits);
+	masks[0].mask = raw_bits;
+	masks[1].deviceid = XIAllDevices;
+	masks[1].mask_len = sizeof(device_bits);
+	masks[1].mask = device_bits;
+
+	XISelectEvents(hook->data.display, DefaultRootWindow(hook->data.display), masks, 2);
+	XFlush(hook->data.display);
+
+	hook->xinput.selected = enable;
+	hook->xinput.selected_mask = mask;
+
+	// The pointer may have moved while raw motion was not selected.
+	hook->xinput.pointer_known = false;
+	hook->xinput.motion_pending = false;
+
+	logger(LOG_LEVEL_DEBUG,	"%s [%u]: Selected raw events for event mask %#X.\n",
+			__FUNCTION__, __LINE__, enable ? mask : 0);
+}
+
+// Load the scroll valuators of every physical device.
+static void xinput_load_scroll_classes() {
+	if (hook->xinput.scroll != NULL) {
+		free(hook->xinput.scroll);
+		hook->xinput.scroll = NULL;
+	}
+	hook->xinput.scroll_count = 0;
+
+	int device_count = 0;
+	XIDeviceInfo *devices = XIQueryDevice(hook->data.display, XIAllDevices, &device_count);
+	if (devices == NULL) {
+		logger(LOG_LEVEL_WARN,	"%s [%u]: XIQueryDevice failure!\n",
+				__FUNCTION__, __LINE__);
+		return;
+	}
+
+	// Master devices only mirror the classes of their current slave, and raw
+	// events report the slave as their source.
+	unsigned int count = 0;
+	int i, j;
+	for (i = 0; i < device_count; i++) {
+		if (devices[i].use == XISlavePointer || devices[i].use == XIFloatingSlave) {
+			for (j = 0; j < devices[i].num_classes; j++) {
+				if (devices[i].classes[j]->type == XIScrollClass) {
+					count++;
+				}
+			}
+		}
+	}
+
+	if (count > 0) {
+		hook->xinput.scroll = calloc(count, sizeof(xinput_scroll));
+		if (hook->xinput.scroll != NULL) {
+			for (i = 0; i < device_count; i++) {
+				if (devices[i].use != XISlavePointer && devices[i].use != XIFloatingSlave) {
+					continue;
+				}
+
+				for (j = 0; j < devices[i].num_classes; j++) {
+					XIScrollClassInfo *info = (XIScrollClassInfo *) devices[i].classes[j];
+					if (info->type == XIScrollClass && info->increment != 0) {
+						xinput_scroll *scroll = &hook->xinput.scroll[hook->xinput.scroll_count++];
+						scroll->deviceid = devices[i].deviceid;
+						scroll->number = info->number;
+						scroll->increment = info->increment;
+						scroll->distance = 0;
+
+						if (info->scroll_type == XIScrollTypeHorizontal) {
+							scroll->direction = WHEEL_HORIZONTAL_DIRECTION;
+						}
+						else {
+							scroll->direction = WHEEL_VERTICAL_DIRECTION;
+						}
+					}
+				}
+			}
+		}
+		else {
+			logger(LOG_LEVEL_ERROR,	"%s [%u]: Failed to allocate memory for scroll valuators!\n",
+					__FUNCTION__, __LINE__);
+		}
+	}
+
+	XIFreeDeviceInfo(devices);
+
+	logger(LOG_LEVEL_DEBUG,	"%s [%u]: Loaded %u scroll valuators.\n",
+			__FUNCTION__, __LINE__, hook->xinput.scroll_count);
+}
+
+// Whether a device scrolls through valuators.
+static bool xinput_has_scroll(int deviceid) {
+	unsigned int i;
+	for (i = 0; i < hook->xinput.scroll_count; i++) {
+		if (hook->xinput.scroll[i].deviceid == deviceid) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+// Load the pointer and keyboard state raw events do not carry.
+static void xinput_load_state() {
+	// Raw events report physical buttons, core events the mapped ones.
+	hook->xinput.button_count = XGetPointerMapping(hook->data.display,
+			hook->xinput.button_map, sizeof(hook->xinput.button_map));
+
+	#if !defined(USE_XKBCOMMON) && defined(USE_XKB)
+	XkbStateRec xkb_state;
+	if (XkbGetState(hook->data.display, XkbUseCoreKbd, &xkb_state) == Success) {
+		hook->xinput.core_state = XkbStateFieldFromRec(&xkb_state);
+	}
+	#endif
+
+	xinput_load_scroll_classes();
+}
+
+// Core button for a physical button, or 0 if the button is disabled.
+static inline unsigned int xinput_map_button(unsigned int button) {
+	if (button > 0 && button <= (unsigned int) hook->xinput.button_count) {
+		return hook->xinput.button_map[button - 1];
+	}
+
+	return button;
+}
+
+// Core modifier state to translate keys with.
+static unsigned int xinput_modifier_state() {
+	#if defined(USE_XKBCOMMON)
+	// Keys are translated through the xkb state instead.
+	return 0;
+	#elif defined(USE_XKB)
+	return hook->xinput.core_state;
+	#else
+	// Rebuild it from the tracked modifiers, assuming the usual mapping of
+	// Alt to Mod1, Num Lock to Mod2 and Super to Mod4.
+	uint16_t mask = get_modifiers();
+	unsigned int core_state = 0;
+
+	if (mask & (MASK_SHIFT))		{ core_state |= ShiftMask;		}
+	if (mask & (MASK_CAPS_LOCK))	{ core_state |= LockMask;		}
+	if (mask & (MASK_CTRL))			{ core_state |= ControlMask;	}
+	if (mask & (MASK_ALT))			{ core_state |= Mod1Mask;		}
+	if (mask & (MASK_NUM_LOCK))		{ core_state |= Mod2Mask;		}
+	if (mask & (MASK_META))			{ core_state |= Mod4Mask;		}
+
+	return core_state;
+	#endif
+}
+
+// Current pointer position on the root window.  Raw events carry none, so
+// it is queried from the server, but only if the pointer may have moved since
+// the last query: raw motion was received, or motion is not selected at all.
+static void xinput_pointer_position(int *root_x, int *root_y) {
+	if (!hook->xinput.pointer_known || !(hook->xinput.selected_mask & (EVENT_MASK_MOUSE_MOTION | EVENT_MASK_MOUSE_WHEEL))) {
+		Window unused_win;
+		int unused_int;
+		unsigned int unused_mask;
+
+		hook->xinput.pointer_known = XQueryPointer(hook->data.display, DefaultRootWindow(hook->data.display),
+				&unused_win, &unused_win, &hook->xinput.pointer_x, &hook->xinput.pointer_y, &unused_int, &unused_int, &unused_mask);
+		if (!hook->xinput.pointer_known) {
+			logger(LOG_LEVEL_WARN,	"%s [%u]: XQueryPointer failure!\n",
+					__FUNCTION__, __LINE__);
+		}
+	}
+
+	*root_x = hook->xinput.pointer_x;
+	*root_y = hook->xinput.pointer_y;
+}
+
+// Fire the motion event of the raw motion received since the last one, if it
+// moved the pointer.  Called before any other event and once the queue is
+// drained, so a burst of motion costs one round trip.
+static void xinput_flush_motion() {
+	if (!hook->xinput.motion_pending) {
+		return;
+	}
+	hook->xinput.motion_pending = false;
+
+	int root_x, root_y;
+	xinput_pointer_position(&root_x, &root_y);
+
+	// The core protocol only reports motion that moved the pointer.
+	if (hook->xinput.pointer_known && (root_x != hook->xinput.root_x || root_y != hook->xinput.root_y)) {
+		hook->xinput.root_x = root_x;
+		hook->xinput.root_y = root_y;
+
+		process_motion(hook->xinput.motion_time, root_x, root_y);
+	}
+}
+
+// Value of a valuator set in a raw event.  Only set valuators are sent, in
+// order of their number.
+static double xinput_valuator(XIRawEvent *raw, int number) {
+	int i, index = 0;
+	for (i = 0; i < number; i++) {
+		if (XIMaskIsSet(raw->valuators.mask, i)) {
+			index++;
+		}
+	}
+
+	return raw->valuators.values[index];
+}
+
+// Fire a wheel event for every whole increment scrolled by a raw motion event.
+// Fractions are carried over to the next event of the valuator.
+static void xinput_process_scroll(XIRawEvent *raw, uint64_t timestamp) {
+	bool has_position = false;
+	int root_x = 0, root_y = 0;
+
+	unsigned int i;
+	for (i = 0; i < hook->xinput.scroll_count; i++) {
+		xinput_scroll *scroll = &hook->xinput.scroll[i];
+		if (scroll->deviceid != raw->sourceid || scroll->number >= raw->valuators.mask_len * 8
+				|| !XIMaskIsSet(raw->valuators.mask, scroll->number)) {
+			continue;
+		}
+
+		scroll->distance += xinput_valuator(raw, scroll->number) / scroll->increment;
+		while (scroll->distance >= 1.0 || scroll->distance <= -1.0) {
+			if (!has_position) {
+				// Motion in the same event goes first.
+				xinput_flush_motion();
+				xinput_pointer_position(&root_x, &root_y);
+				has_position = true;
+			}
+
+			int16_t rotation = scroll->distance > 0 ? 1 : -1;
+			scroll->distance -= rotation;
+
+			process_wheel(timestamp, root_x, root_y, scroll->direction, rotation);
+		}
+	}
+}
+
+static void xinput_process_raw_event(int evtype, XIRawEvent *raw) {
+	uint64_t timestamp = (uint64_t) raw->time;
 
-		// Allow the thread loop to block.
-		pthread_mutex_lock(&hook_xrecord_mutex);
-		running = true;
+	// Valuators 0 and 1 are the axes that move the pointer.
+	bool moved = evtype == XI_RawMotion && raw->valuators.mask_len > 0
+			&& (XIMaskIsSet(raw->valuators.mask, 0) || XIMaskIsSet(raw->valuators.mask, 1));
 
-		do {
-			// Unlock the mutex from the previous iteration.
-			pthread_mutex_unlock(&hook_xrecord_mutex);
+	// Keep the events in order: pending motion goes before anything else,
+	// and a move makes the known position stale.
+	if (!moved) {
+		xinput_flush_motion();
+	}
 
-			XRecordProcessReplies(hook->data.display);
+	refresh_input_state(timestamp);
+
+	static const int core_types[] = {
+		[XI_RawKeyPress] = KeyPress,
+		[XI_RawKeyRelease] = KeyRelease,
+		[XI_RawButtonPress] = ButtonPress,
+		[XI_RawButtonRelease] = ButtonRelease,
+		[XI_RawMotion] = MotionNotify
+	};
+	stats_add(&stats.received[core_types[evtype]], 1);
+
+	switch (evtype) {
+		case XI_RawKeyPress:
+			process_key_press(timestamp, (KeyCode) raw->detail, xinput_modifier_state());
+			break;
+
+		case XI_RawKeyRelease:
+			process_key_release(timestamp, (KeyCode) raw->detail, xinput_modifier_state());
+			break;
+
+		case XI_RawButtonPress:
+		case XI_RawButtonRelease: {
+			unsigned int button = xinput_map_button(raw->detail);
+			if (button == 0) {
+				// Disabled by the pointer mapping.
+				break;
+			}
 
-			// Prevent 100% CPU utilization.
-			struct timeval tv;
-			gettimeofday(&tv, NULL);
+			// Wheel buttons emulated from scroll valuators were already reported
+			// by the motion event that carried them.
+			if ((raw->flags & XIPointerEmulated) && button >= WheelUp && button <= WheelRight
+					&& xinput_has_scroll(raw->sourceid)) {
+				break;
+			}
 
-			struct timespec ts;
-			ts.tv_sec = time(NULL) + timesleep / 1000;
-			ts.tv_nsec = tv.tv_usec * 1000 + 1000 * 1000 * (timesleep % 1000);
-			ts.tv_sec += ts.tv_nsec / (1000 * 1000 * 1000);
-			ts.tv_nsec %= (1000 * 1000 * 1000);
+			int root_x, root_y;
+			xinput_pointer_position(&root_x, &root_y);
 
-			pthread_mutex_lock(&hook_xrecord_mutex);
-			pthread_cond_timedwait(&hook_xrecord_cond, &hook_xrecord_mutex, &ts);
-		} while (running);
+			if (evtype == XI_RawButtonPress) {
+				process_button_press(timestamp, button, root_x, root_y);
+			}
+			else {
+				process_button_release(timestamp, button, root_x, root_y);
+			}
+			break;
+		}
 
-		// Unlock after loop exit.
-		pthread_mutex_unlock(&hook_xrecord_mutex);
+		case XI_RawMotion:
+			if (moved) {
+				hook->xinput.pointer_known = false;
+				hook->xinput.motion_pending = true;
+				hook->xinput.motion_time = timestamp;
+			}
 
-		// Set the exit status.
-		status = NULL;
-	}
-	#else
-	// Sync blocks until XRecordDisableContext() is called.
-	if (XRecordEnableContext(hook->data.display, hook->ctrl.context, hook_event_proc, closeure) != 0) {
-		status = UIOHOOK_SUCCESS;
+			xinput_process_scroll(raw, timestamp);
+			break;
 	}
-	#endif
-	else {
-		logger(LOG_LEVEL_ERROR,	"%s [%u]: XRecordEnableContext failure!\n",
-			__FUNCTION__, __LINE__);
+}
 
-		#ifdef USE_XRECORD_ASYNC
-		// Reset the running state.
-		pthread_mutex_lock(&hook_xrecord_mutex);
-		running = false;
-		pthread_mutex_unlock(&hook_xrecord_mutex);
-		#endif
+static void xinput_process_event(XEvent *ev) {
+	stamp_input_time();
+
+	if (ev->type == GenericEvent && ev->xcookie.extension == hook->xinput.opcode) {
+		if (XGetEventData(hook->data.display, &ev->xcookie)) {
+			switch (ev->xcookie.evtype) {
+				case XI_RawKeyPress:
+				case XI_RawKeyRelease:
+				case XI_RawButtonPress:
+				case XI_RawButtonRelease:
+				case XI_RawMotion:
+					xinput_process_raw_event(ev->xcookie.evtype, (XIRawEvent *) ev->xcookie.data);
+					break;
+
+				case XI_HierarchyChanged:
+				case XI_DeviceChanged:
+					xinput_load_scroll_classes();
+					break;
+			}
 
-		// Set the exit status.
-		status = UIOHOOK_ERROR_X_RECORD_ENABLE_CONTEXT;
+			XFreeEventData(hook->data.display, &ev->xcookie);
+		}
+	}
+	else if (ev->type == MappingNotify) {
+		if (ev->xmapping.request == MappingPointer) {
+			hook->xinput.button_count = XGetPointerMapping(hook->data.display,
+					hook->xinput.button_map, sizeof(hook->xinput.button_map));
+		}
+	}
+	#if !defined(USE_XKBCOMMON) && defined(USE_XKB)
+	else if (ev->type == hook->xinput.xkb_event_base) {
+		XkbEvent *xkb_event = (XkbEvent *) ev;
+		if (xkb_event->any.xkb_type == XkbStateNotify) {
+			// Sent after the raw event of the key that caused it, so raw key
+			// events see the state from before the key, like core events.
+			hook->xinput.core_state = XkbBuildCoreState(xkb_event->state.lookup_mods, xkb_event->state.group);
+		}
 	}
+	#endif
+}
 
-	return status;
+// Read raw events until hook_stop() is called.  hook_pause() deselects them
+// and waits for hook_resume() without closing the displays.
+// Current server time, which raw events are stamped with.  The server only
+// reports it in events, so append nothing to a property of a window of our
+// own and take the time of the notification.
+static uint64_t xinput_server_time() {
+	Display *display = hook->data.display;
+	XSetWindowAttributes attributes;
+	attributes.event_mask = PropertyChangeMask;
+
+	Window window = XCreateWindow(display, DefaultRootWindow(display), 0, 0, 1, 1, 0, 0,
+			InputOnly, CopyFromParent, CWEventMask, &attributes);
+	Atom property = XInternAtom(display, "_UIOHOOK_SERVER_TIME", False);
+	XChangeProperty(display, window, property, XA_STRING, 8, PropModeAppend, NULL, 0);
+
+	XEvent ev;
+	XWindowEvent(display, window, PropertyChangeMask, &ev);
+	XDestroyWindow(display, window);
+
+	return (uint64_t) ev.xproperty.time;
 }
 
-static int xrecord_alloc() {
-	int status = UIOHOOK_FAILURE;
+static int xinput_block() {
+	int status = UIOHOOK_SUCCESS;
 
-	// Make sure the data display is synchronized to prevent late event delivery!
-	// See Bug 42356 for more information.
-	// https://bugs.freedesktop.org/show_bug.cgi?id=42356#c4
-	XSynchronize(hook->data.display, True);
+	pthread_mutex_lock(&hook_xrecord_mutex);
+	running = true;
+	paused = false;
 
-	// Setup XRecord range.
-	XRecordClientSpec clients = XRecordAllClients;
+	while (running) {
+		if (paused) {
+			xinput_select(false, 0);
 
-	hook->data.range = XRecordAllocRange();
-	if (hook->data.range != NULL) {
-		logger(LOG_LEVEL_DEBUG,	"%s [%u]: XRecordAllocRange successful.\n",
-				__FUNCTION__, __LINE__);
+			logger(LOG_LEVEL_DEBUG,	"%s [%u]: Hook paused.\n",
+					__FUNCTION__, __LINE__);
 
-		hook->data.range->device_events.first = KeyPress;
-		hook->data.range->device_events.last = MotionNotify;
+			while (running && paused) {
+				pthread_cond_wait(&hook_xrecord_cond, &hook_xrecord_mutex);
+			}
 
-		// Note that the documentation for this function is incorrect,
-		// hook->data.display should be used!
-		// See: http://www.x.org/releases/X11R7.6/doc/libXtst/recordlib.txt
-		hook->ctrl.context = XRecordCreateContext(hook->data.display, XRecordFromServerTime, &clients, 1, &hook->data.range, 1);
-		if (hook->ctrl.context != 0) {
-			logger(LOG_LEVEL_DEBUG,	"%s [%u]: XRecordCreateContext successful.\n",
-					__FUNCTION__, __LINE__);
+			if (running) {
+				logger(LOG_LEVEL_DEBUG,	"%s [%u]: Hook resumed.\n",
+						__FUNCTION__, __LINE__);
 
-			// Block until hook_stop() is called.
-			status = xrecord_block();
+				// Input that happened while paused was not seen, so drop what
+				// is still queued and pick up the current state again.
+				pthread_mutex_unlock(&hook_xrecord_mutex);
+				XSync(hook->data.display, True);
+				xinput_load_state();
+				#ifdef USE_XKBCOMMON
+				resync_xkb_state();
+				#endif
+				initialize_modifiers();
+				pthread_mutex_lock(&hook_xrecord_mutex);
+			}
 
-			// Free up the context if it was set.
-			XRecordFreeContext(hook->data.display, hook->ctrl.context);
+			continue;
 		}
-		else {
-			logger(LOG_LEVEL_ERROR,	"%s [%u]: XRecordCreateContext failure!\n",
-					__FUNCTION__, __LINE__);
 
-			// Set the exit status.
-			status = UIOHOOK_ERROR_X_RECORD_CREATE_CONTEXT;
+		uint32_t mask = __atomic_load_n(&dispatch_event_mask, __ATOMIC_RELAXED);
+		if (!hook->xinput.selected || hook->xinput.selected_mask != mask) {
+			xinput_select(true, mask);
 		}
+		pthread_mutex_unlock(&hook_xrecord_mutex);
 
-		// Free the XRecord range.
-		XFree(hook->data.range);
+		// Resuming is not a new start as far as the dispatcher is concerned.
+		if (!hook_is_enabled) {
+			dispatch_hook_enabled(xinput_server_time());
+		}
+
+		// Handle everything Xlib has read or can read without blocking, then
+		// sleep until the server sends more or another thread wakes us up.
+		// The position queried for pending motion may read more events.
+		do {
+			while (XPending(hook->data.display) > 0) {
+				XEvent ev;
+				XNextEvent(hook->data.display, &ev);
+				xinput_process_event(&ev);
+			}
+			xinput_flush_motion();
+		} while (XEventsQueued(hook->data.display, QueuedAlready) > 0);
+		dispatch_properties_changed();
+
+		status = wait_for_data(hook->data.display);
+
+		pthread_mutex_lock(&hook_xrecord_mutex);
+		if (status != UIOHOOK_SUCCESS) {
+			break;
+		}
+	}
+
+	running = false;
+	paused = false;
+	pthread_mutex_unlock(&hook_xrecord_mutex);
+
+	dispatch_hook_disabled();
+
+	return status;
+}
+
+static int xinput_alloc() {
+	int status = UIOHOOK_FAILURE;
+
+	#if !defined(USE_XKBCOMMON) && defined(USE_XKB)
+	// Follow the core modifier state for key translation.
+	int xkb_opcode, xkb_error_base, xkb_major = XkbMajorVersion, xkb_minor = XkbMinorVersion;
+	if (XkbQueryExtension(hook->data.display, &xkb_opcode, &hook->xinput.xkb_event_base, &xkb_error_base, &xkb_major, &xkb_minor)) {
+		XkbSelectEventDetails(hook->data.display, XkbUseCoreKbd, XkbStateNotify,
+				XkbModifierStateMask | XkbGroupStateMask, XkbModifierStateMask | XkbGroupStateMask);
 	}
 	else {
-		logger(LOG_LEVEL_ERROR,	"%s [%u]: XRecordAllocRange failure!\n",
+		logger(LOG_LEVEL_WARN,	"%s [%u]: XkbQueryExtension failure!\n",
 				__FUNCTION__, __LINE__);
+	}
+	#endif
 
-		// Set the exit status.
-		status = UIOHOOK_ERROR_X_RECORD_ALLOC_RANGE;
+	xinput_load_state();
+
+	// Block until hook_stop() is called.
+	status = xinput_block();
+
+	if (hook->xinput.scroll != NULL) {
+		free(hook->xinput.scroll);
+		hook->xinput.scroll = NULL;
 	}
+	hook->xinput.scroll_count = 0;
 
 	return status;
 }
 
-static int xrecord_query() {
+static int xinput_query() {
 	int status = UIOHOOK_FAILURE;
 
-	// Check to make sure XRecord is installed and enabled.
-	int major, minor;
-	if (XRecordQueryVersion(hook->ctrl.display, &major, &minor) != 0) {
-		logger(LOG_LEVEL_INFO,	"%s [%u]: XRecord version: %i.%i.\n",
+	// Check to make sure XInput2 is installed and enabled.  Version 2.1 sends
+	// raw events to the root window during grabs and adds smooth scrolling.
+	int event_base, error_base;
+	int major = 2, minor = 2;
+	if (XQueryExtension(hook->data.display, "XInputExtension", &hook->xinput.opcode, &event_base, &error_base)
+			&& XIQueryVersion(hook->data.display, &major, &minor) == Success
+			&& (major > 2 || (major == 2 && minor >= 1))) {
+		logger(LOG_LEVEL_INFO,	"%s [%u]: XInput version: %i.%i.\n",
 				__FUNCTION__, __LINE__, major, minor);
 
-		status = xrecord_alloc();
+		status = xinput_alloc();
 	}
 	else {
-		logger(LOG_LEVEL_ERROR,	"%s [%u]: XRecord is not currently available!\n",
+		logger(LOG_LEVEL_ERROR,	"%s [%u]: XInput 2.1 is not currently available!\n",
 				__FUNCTION__, __LINE__);
 
-		status = UIOHOOK_ERROR_X_RECORD_NOT_FOUND;
+		status = UIOHOOK_ERROR_X_INPUT2_NOT_FOUND;
 	}
 
 	return status;
 }
+#endif
+
+// Set up the backend of this hook and block until hook_stop() is called.
+static int backend_query() {
+	#ifdef USE_XINPUT2
+	if (hook->backend == HOOK_BACKEND_XINPUT2) {
+		return xinput_query();
+	}
+	#endif
+
+	#ifdef USE_XCB_RECORD
+	if (hook->backend == HOOK_BACKEND_XCB_RECORD) {
+		return xrecord_xcb_query();
+	}
+	#endif
+
+	return xrecord_query();
+}
 
-static int xrecord_start() {
+static void enable_grab_mouse();
+
+static int hook_start() {
 	int status = UIOHOOK_FAILURE;
 
-	// Open the control display for XRecord.
+	// Open the control display.
 	hook->ctrl.display = XOpenDisplay(NULL);
 
-	// Open a data display for XRecord.
+	// Open a data display for the events.
 	// NOTE This display must be opened on the same thread as XRecord.
-	hook->data.display = XOpenDisplay(NULL);
-	if (hook->ctrl.display != NULL && hook->data.display != NULL) {
+	bool data_open = false;
+	#ifdef USE_XCB_RECORD
+	if (hook->backend == HOOK_BACKEND_XCB_RECORD) {
+		hook->data.connection = xcb_connect(NULL, NULL);
+		data_open = xcb_connection_has_error(hook->data.connection) == 0;
+	}
+	else
+	#endif
+	{
+		hook->data.display = XOpenDisplay(NULL);
+		data_open = hook->data.display != NULL;
+	}
+
+	if (hook->ctrl.display != NULL && data_open) {
 		logger(LOG_LEVEL_DEBUG,	"%s [%u]: XOpenDisplay successful.\n",
 				__FUNCTION__, __LINE__);
 
@@ -1003,6 +2249,11 @@ static int xrecord_start() {
 					__FUNCTION__, __LINE__);
 		}
 
+		// Apply a mouse grab that was requested before the hook was running.
+		if (grab_requested) {
+			enable_grab_mouse();
+		}
+
 		 #if defined(USE_XKBCOMMON)
 		// Open XCB Connection
 		hook->input.connection = XGetXCBConnection(hook->ctrl.display);
@@ -1027,12 +2278,29 @@ static int xrecord_start() {
 
 		#ifdef USE_XKBCOMMON
 		state = create_xkb_state(hook->input.context, hook->input.connection);
+		if (state != NULL) {
+			load_key_table(xkb_state_get_keymap(state));
+		}
+
+		// The state was just loaded from the server, so earlier changes are
+		// already part of it.
+		take_key_table_changes();
 		#endif
 
 		// Initialize starting modifiers.
 		initialize_modifiers();
 
-		status = xrecord_query();
+		#ifdef HOOK_WAKE_PIPE
+		if (open_wake_pipe()) {
+			status = backend_query();
+			close_wake_pipe();
+		}
+		else {
+			status = UIOHOOK_FAILURE;
+		}
+		#else
+		status = backend_query();
+		#endif
 
 		#ifdef USE_XKBCOMMON
 		if (state != NULL) {
@@ -1052,18 +2320,29 @@ static int xrecord_start() {
 		status = UIOHOOK_ERROR_X_OPEN_DISPLAY;
 	}
 
-	// Close down the XRecord data display.
+	// Close down the data display.
 	if (hook->data.display != NULL) {
 		XCloseDisplay(hook->data.display);
 		hook->data.display = NULL;
 	}
 
-	// Close down the XRecord control display.
+	#ifdef USE_XCB_RECORD
+	// The connection is allocated even if it failed.
+	if (hook->data.connection != NULL) {
+		xcb_disconnect(hook->data.connection);
+		hook->data.connection = NULL;
+	}
+	#endif
+
+	// Close down the control display.
 	if (hook->ctrl.display) {
 		XCloseDisplay(hook->ctrl.display);
 		hook->ctrl.display = NULL;
 	}
 
+	// Closing the control display also released any pointer grab.
+	grab_enabled = false;
+
 	return status;
 }
 
@@ -1097,6 +2376,13 @@ static void disable_grab_mouse() {
 }
 
 UIOHOOK_API void grab_mouse_click(bool enable) {
+	grab_requested = enable;
+
+	// If the hook is not running yet, the grab is applied by hook_start().
+	if (hook == NULL || hook->ctrl.display == NULL) {
+		return;
+	}
+
 	if(grab_enabled == enable) {
 		return;
 	}
@@ -1110,16 +2396,60 @@ UIOHOOK_API void grab_mouse_click(bool enable) {
 UIOHOOK_API int hook_run() {
 	int status = UIOHOOK_FAILURE;
 
+	// Generated events do not need an X server at all.
+	if (__atomic_load_n(&backend, __ATOMIC_RELAXED) == HOOK_BACKEND_SYNTHETIC) {
+		return synthetic_hook_run(&dispatch_synthetic_event);
+	}
+
 	// Hook data for future cleanup.
 	hook = malloc(sizeof(hook_info));
 	if (hook != NULL) {
+		hook->backend = __atomic_load_n(&backend, __ATOMIC_RELAXED);
+		if (hook->backend == HOOK_BACKEND_DEFAULT) {
+			hook->backend = HOOK_BACKEND_XRECORD;
+		}
+
+		hook->ctrl.display = NULL;
+		hook->ctrl.context = 0;
+		hook->data.display = NULL;
+		#ifdef USE_XCB_RECORD
+		hook->data.connection = NULL;
+		#endif
+		#ifdef HOOK_WAKE_PIPE
+		hook->wake[0] = -1;
+		hook->wake[1] = -1;
+		#endif
+		#ifdef USE_XINPUT2
+		hook->xinput.selected = false;
+		hook->xinput.selected_mask = 0;
+		hook->xinput.root_x = INT_MIN;
+		hook->xinput.root_y = INT_MIN;
+		hook->xinput.pointer_known = false;
+		hook->xinput.motion_pending = false;
+		hook->xinput.button_count = 0;
+		hook->xinput.scroll = NULL;
+		hook->xinput.scroll_count = 0;
+		#if !defined(USE_XKBCOMMON) && defined(USE_XKB)
+		hook->xinput.xkb_event_base = -1;
+		hook->xinput.core_state = 0;
+		#endif
+		#endif
+		#ifdef USE_XKBCOMMON
+		hook->input.connection = NULL;
+		hook->input.context = NULL;
+		#endif
+
 		hook->input.mask = 0x0000;
 		hook->input.mouse.is_dragged = false;
+
+		// Pointer control changes are not reported, so start from fresh values.
+		reload_system_properties();
+		hook->input.properties_generation = get_properties_generation();
 		hook->input.mouse.click.count = 0;
 		hook->input.mouse.click.time = 0;
 		hook->input.mouse.click.button = MOUSE_NOBUTTON;
 
-		status = xrecord_start();
+		status = hook_start();
 
 		// Free data associated with this hook.
 		free(hook);
@@ -1138,50 +2468,221 @@ UIOHOOK_API int hook_run() {
 	return status;
 }
 
-UIOHOOK_API int hook_stop() {
+// Disable the XRecord context if it is currently enabled.
+// NOTE Must be called with hook_xrecord_mutex held.
+static int xrecord_disable() {
 	int status = UIOHOOK_FAILURE;
 
-	if (hook != NULL && hook->ctrl.display != NULL && hook->ctrl.context != 0) {
-		// We need to make sure the context is still valid.
-		XRecordState *state = malloc(sizeof(XRecordState));
-		if (state != NULL) {
-			if (XRecordGetContext(hook->ctrl.display, hook->ctrl.context, &state) != 0) {
-				// Try to exit the thread naturally.
-				if (state->enabled && XRecordDisableContext(hook->ctrl.display, hook->ctrl.context) != 0) {
-					#ifdef USE_XRECORD_ASYNC
-					pthread_mutex_lock(&hook_xrecord_mutex);
-					running = false;
-					pthread_cond_signal(&hook_xrecord_cond);
-					pthread_mutex_unlock(&hook_xrecord_mutex);
-					#endif
-
-					// See Bug 42356 for more information.
-					// https://bugs.freedesktop.org/show_bug.cgi?id=42356#c4
-					//XFlush(hook->ctrl.display);
-					XSync(hook->ctrl.display, False);
-
-					status = UIOHOOK_SUCCESS;
-				}
+	// We need to make sure the context is still valid.
+	XRecordState *state = malloc(sizeof(XRecordState));
+	if (state != NULL) {
+		if (XRecordGetContext(hook->ctrl.display, hook->ctrl.context, &state) != 0) {
+			// Try to exit the thread naturally.
+			if (state->enabled && XRecordDisableContext(hook->ctrl.display, hook->ctrl.context) != 0) {
+				// See Bug 42356 for more information.
+				// https://bugs.freedesktop.org/show_bug.cgi?id=42356#c4
+				//XFlush(hook->ctrl.display);
+				XSync(hook->ctrl.display, False);
+
+				status = UIOHOOK_SUCCESS;
 			}
-			else {
-				logger(LOG_LEVEL_ERROR,	"%s [%u]: XRecordGetContext failure!\n",
-						__FUNCTION__, __LINE__);
+		}
+		else {
+			logger(LOG_LEVEL_ERROR,	"%s [%u]: XRecordGetContext failure!\n",
+					__FUNCTION__, __LINE__);
 
-				status = UIOHOOK_ERROR_X_RECORD_GET_CONTEXT;
-			}
+			status = UIOHOOK_ERROR_X_RECORD_GET_CONTEXT;
+		}
+
+		free(state);
+	}
+	else {
+		logger(LOG_LEVEL_ERROR,	"%s [%u]: Failed to allocate memory for XRecordState!\n",
+				__FUNCTION__, __LINE__);
+
+		status = UIOHOOK_ERROR_OUT_OF_MEMORY;
+	}
+
+	return status;
+}
+
+// Whether the hook thread has set up its backend and can be controlled.
+// NOTE Must be called with hook_xrecord_mutex held.
+static inline bool hook_is_controllable() {
+	if (!running || hook == NULL || hook->ctrl.display == NULL) {
+		return false;
+	}
+
+	#ifdef USE_XINPUT2
+	if (hook->backend == HOOK_BACKEND_XINPUT2) {
+		return hook->wake[1] >= 0;
+	}
+	#endif
+
+	return hook->ctrl.context != 0;
+}
+
+// Make the hook thread return to xrecord_block() or xinput_block(), so that it
+// notices a change of running or paused.
+// NOTE Must be called with hook_xrecord_mutex held.
+static int hook_interrupt() {
+	#ifdef USE_XINPUT2
+	if (hook->backend == HOOK_BACKEND_XINPUT2) {
+		return hook_wake();
+	}
+	#endif
+
+	int status = xrecord_disable();
+
+	#ifdef USE_XRECORD_ASYNC
+	if (status == UIOHOOK_SUCCESS && hook->backend == HOOK_BACKEND_XRECORD) {
+		// Do not rely on the end of data reply to end the wait.
+		status = hook_wake();
+	}
+	#endif
+
+	return status;
+}
+
+// Called by the settings thread when the system properties changed.  A hook
+// thread that waits on the wake up pipe reports the change right away, the
+// others with the next input event.
+void notify_properties_changed() {
+	#ifdef HOOK_WAKE_PIPE
+	pthread_mutex_lock(&hook_xrecord_mutex);
+	if (running && !paused && hook->wake[1] >= 0) {
+		hook_wake();
+	}
+	pthread_mutex_unlock(&hook_xrecord_mutex);
+	#endif
+}
+
+UIOHOOK_API int hook_stop() {
+	if (synthetic_hook_is_running()) {
+		return synthetic_hook_stop();
+	}
 
-			free(state);
+	int status = UIOHOOK_FAILURE;
+
+	pthread_mutex_lock(&hook_xrecord_mutex);
+	if (hook_is_controllable()) {
+		if (paused) {
+			// The hook thread is already waiting, just wake it up.
+			status = UIOHOOK_SUCCESS;
 		}
 		else {
-			logger(LOG_LEVEL_ERROR,	"%s [%u]: Failed to allocate memory for XRecordState!\n",
-					__FUNCTION__, __LINE__);
+			status = hook_interrupt();
+		}
 
-			status = UIOHOOK_ERROR_OUT_OF_MEMORY;
+		if (status == UIOHOOK_SUCCESS) {
+			running = false;
+			pthread_cond_signal(&hook_xrecord_cond);
 		}
 	}
+	pthread_mutex_unlock(&hook_xrecord_mutex);
+
+	logger(LOG_LEVEL_DEBUG, "%s [%u]: Status: %#X.\n",
+			__FUNCTION__, __LINE__, status);
+
+	return status;
+}
+
+UIOHOOK_API int hook_pause() {
+	if (synthetic_hook_is_running()) {
+		return synthetic_hook_pause();
+	}
+
+	int status = UIOHOOK_FAILURE;
+
+	pthread_mutex_lock(&hook_xrecord_mutex);
+	if (!paused && hook_is_controllable()) {
+		// Set before interrupting, the hook thread checks it as soon as
+		// XRecordEnableContext() or poll() returns.
+		paused = true;
+
+		status = hook_interrupt();
+		if (status != UIOHOOK_SUCCESS) {
+			paused = false;
+		}
+	}
+	pthread_mutex_unlock(&hook_xrecord_mutex);
+
+	logger(LOG_LEVEL_DEBUG, "%s [%u]: Status: %#X.\n",
+			__FUNCTION__, __LINE__, status);
+
+	return status;
+}
+
+UIOHOOK_API int hook_resume() {
+	if (synthetic_hook_is_running()) {
+		return synthetic_hook_resume();
+	}
+
+	int status = UIOHOOK_FAILURE;
+
+	pthread_mutex_lock(&hook_xrecord_mutex);
+	if (running && paused) {
+		paused = false;
+		pthread_cond_signal(&hook_xrecord_cond);
+
+		status = UIOHOOK_SUCCESS;
+	}
+	pthread_mutex_unlock(&hook_xrecord_mutex);
 
 	logger(LOG_LEVEL_DEBUG, "%s [%u]: Status: %#X.\n",
 			__FUNCTION__, __LINE__, status);
 
 	return status;
 }
+
+UIOHOOK_API int hook_set_event_mask(uint32_t mask) {
+	int status = UIOHOOK_SUCCESS;
+
+	__atomic_store_n(&dispatch_event_mask, mask, __ATOMIC_RELAXED);
+
+	// A hook that is not running picks the mask up when it creates its context.
+	pthread_mutex_lock(&hook_xrecord_mutex);
+	if (hook_is_controllable()) {
+		#ifdef USE_XINPUT2
+		if (hook->backend == HOOK_BACKEND_XINPUT2) {
+			// The hook thread selects the raw events itself.
+			status = hook_wake();
+		}
+		else
+		#endif
+		status = xrecord_update_range();
+	}
+	pthread_mutex_unlock(&hook_xrecord_mutex);
+
+	logger(LOG_LEVEL_DEBUG, "%s [%u]: Event mask: %#X, status: %#X.\n",
+			__FUNCTION__, __LINE__, mask, status);
+
+	return status;
+}
+
+UIOHOOK_API int hook_set_backend(hook_backend new_backend) {
+	int status = UIOHOOK_SUCCESS;
+
+	switch (new_backend) {
+		case HOOK_BACKEND_DEFAULT:
+		case HOOK_BACKEND_XRECORD:
+		case HOOK_BACKEND_SYNTHETIC:
+		#ifdef USE_XINPUT2
+		case HOOK_BACKEND_XINPUT2:
+		#endif
+		#ifdef USE_XCB_RECORD
+		case HOOK_BACKEND_XCB_RECORD:
+		#endif
+			__atomic_store_n(&backend, new_backend, __ATOMIC_RELAXED);
+			break;
+
+		default:
+			status = UIOHOOK_ERROR_BACKEND_UNSUPPORTED;
+			break;
+	}
+
+	logger(LOG_LEVEL_DEBUG, "%s [%u]: Backend: %u, status: %#X.\n",
+			__FUNCTION__, __LINE__, new_backend, status);
+
+	return status;
+}
@@ -35,6 +35,9 @@
 
 extern Display *properties_disp;
 
+// Synthetic event source, defined in synthetic_hook.c.
+extern bool synthetic_post_event(uiohook_event *const event);
+
 // This lookup table must be in the same order the masks are defined.
 #ifdef USE_XTEST
 static KeySym keymask_lookup[8] = {
@@ -331,6 +334,11 @@ static inline void post_mouse_motion_event(uiohook_event * const event) {
 }
 
 UIOHOOK_API void hook_post_event(uiohook_event * const event) {
+	// A running synthetic hook takes the event instead of the X server.
+	if (synthetic_post_event(event)) {
+		return;
+	}
+
 	XLockDisplay(properties_disp);
 
 	#ifdef USE_XTEST
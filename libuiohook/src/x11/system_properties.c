@@ -20,11 +20,16 @@
 #include <config.h>
 #endif
 
+#include <limits.h>
+#include <pthread.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <uiohook.h>
+#include <X11/Xatom.h>
 #include <X11/Xlib.h>
+#include <X11/Xresource.h>
 #ifdef USE_XKB
 #include <X11/XKBlib.h>
 #endif
@@ -35,7 +40,6 @@
 #if defined(USE_XINERAMA) && !defined(USE_XRANDR)
 #include <X11/extensions/Xinerama.h>
 #elif defined(USE_XRANDR)
-#include <pthread.h>
 #include <X11/extensions/Xrandr.h>
 #endif
 #ifdef USE_XT
@@ -48,28 +52,99 @@ static Display *xt_disp;
 #include "input_helper.h"
 #include "logger.h"
 
+// Hook thread wake up for property changes, defined in input_hook.c.
+extern void notify_properties_changed();
+
 Display *properties_disp;
 
+// Screen layout cache, so the hook thread never queries the X server for it.
+// The table is guarded by screen_cache_mutex.  The origin of the first screen
+// is what the hook needs for every mouse event, so it is also kept packed in
+// one word that can be read without locking.
+static pthread_mutex_t screen_cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+static screen_data *screen_cache = NULL;
+static unsigned char screen_cache_count = 0;
+static uint32_t screen_cache_origin = 0;
+
+static void update_screen_cache(Display *disp);
+
+// System properties cache, refreshed by the settings thread whenever the X
+// server reports a change.  Fields are written with properties_cache_mutex held
+// and each one can be read on its own without it.  The generation counts the
+// changes so the hook thread can notice them without locking, and the time is
+// the server time of the last change.
+static pthread_mutex_t properties_cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+static system_properties properties_cache = {
+	.auto_repeat_rate = -1,
+	.auto_repeat_delay = -1,
+	.pointer_acceleration_multiplier = -1,
+	.pointer_acceleration_threshold = -1,
+	.pointer_sensitivity = -1,
+	.multi_click_time = 200
+};
+static unsigned int properties_generation = 0;
+static uint64_t properties_time = 0;
+
+static bool update_properties_cache(Display *disp, uint64_t timestamp);
+
+#ifdef USE_XKB
+// Core keyboard indicator (LED) state, kept current by the settings thread so
+// the hook thread does not have to ask for it on every key.
+static unsigned int indicator_state = 0;
+
+unsigned int get_indicator_state() {
+	return __atomic_load_n(&indicator_state, __ATOMIC_ACQUIRE);
+}
+
+void set_indicator_state(unsigned int led_mask) {
+	__atomic_store_n(&indicator_state, led_mask, __ATOMIC_RELEASE);
+}
+#endif
+
 #ifdef USE_XRANDR
 static pthread_mutex_t xrandr_mutex = PTHREAD_MUTEX_INITIALIZER;
 static XRRScreenResources *xrandr_resources = NULL;
+#endif
 
 static void settings_cleanup_proc(void *arg) {
+	#ifdef USE_XRANDR
 	if (pthread_mutex_trylock(&xrandr_mutex) == 0) {
 		if (xrandr_resources != NULL) {
 			XRRFreeScreenResources(xrandr_resources);
 			xrandr_resources = NULL;
 		}
 
-		if (arg != NULL) {
-			XCloseDisplay((Display *) arg);
-			arg = NULL;
-		}
-
 		pthread_mutex_unlock(&xrandr_mutex);
 	}
+	#endif
+
+	if (arg != NULL) {
+		XCloseDisplay((Display *) arg);
+		arg = NULL;
+	}
+}
+
+#ifdef USE_XRANDR
+static void update_xrandr_resources(Display *disp, Window root) {
+	pthread_mutex_lock(&xrandr_mutex);
+	if (xrandr_resources != NULL) {
+		XRRFreeScreenResources(xrandr_resources);
+	}
+
+	xrandr_resources = XRRGetScreenResources(disp, root);
+	if (xrandr_resources == NULL) {
+		logger(LOG_LEVEL_WARN,	"%s [%u]: XRandR could not get screen resources!\n",
+				__FUNCTION__, __LINE__);
+	}
+	pthread_mutex_unlock(&xrandr_mutex);
+
+	update_screen_cache(disp);
 }
+#endif
 
+// Waits for the X server to report changes to the screen layout, the keyboard
+// controls, the keymap or the resource database and refreshes the matching
+// cache.
 static void *settings_thread_proc(void *arg) {
 	Display *settings_disp = XOpenDisplay(XDisplayName(NULL));;
 	if (settings_disp != NULL) {
@@ -78,37 +153,114 @@ static void *settings_thread_proc(void *arg) {
 
 		pthread_cleanup_push(settings_cleanup_proc, settings_disp);
 
-		int event_base = 0;
-		int error_base = 0;
-		if (XRRQueryExtension(settings_disp, &event_base, &error_base)) {
-			Window root = XDefaultRootWindow(settings_disp);
-			unsigned long event_mask = RRScreenChangeNotifyMask;
-			XRRSelectInput(settings_disp, root, event_mask);
-
-			XEvent ev;
-
-			while(settings_disp != NULL) {
-				XNextEvent(settings_disp, &ev);
-
-				if (ev.type == event_base + RRScreenChangeNotifyMask) {
-					logger(LOG_LEVEL_DEBUG,	"%s [%u]: Received XRRScreenChangeNotifyEvent.\n",
-							__FUNCTION__, __LINE__);
-
-					pthread_mutex_lock(&xrandr_mutex);
-					if (xrandr_resources != NULL) {
-						XRRFreeScreenResources(xrandr_resources);
-					}
-
-					xrandr_resources = XRRGetScreenResources(settings_disp, root);
-					if (xrandr_resources == NULL) {
-						logger(LOG_LEVEL_WARN,	"%s [%u]: XRandR could not get screen resources!\n",
-								__FUNCTION__, __LINE__);
-					}
-					pthread_mutex_unlock(&xrandr_mutex);
+		Window root = XDefaultRootWindow(settings_disp);
+
+		#ifdef USE_XRANDR
+		int xrandr_event_base = 0;
+		int xrandr_error_base = 0;
+		bool xrandr_enabled = XRRQueryExtension(settings_disp, &xrandr_event_base, &xrandr_error_base);
+		if (xrandr_enabled) {
+			XRRSelectInput(settings_disp, root, RRScreenChangeNotifyMask);
+
+			// Load the current layout, notifications only report changes.
+			update_xrandr_resources(settings_disp, root);
+		}
+		else {
+			logger(LOG_LEVEL_WARN,	"%s [%u]: XRandR is not currently available!\n",
+					__FUNCTION__, __LINE__);
+		}
+		#endif
+
+		#ifdef USE_XKB
+		// Auto repeat rate and delay changes, lock key LEDs, keymap changes and
+		// keyboard group switches.
+		int xkb_event_base = 0;
+		bool xkb_enabled = XkbQueryExtension(settings_disp, NULL, &xkb_event_base, NULL, NULL, NULL)
+				&& XkbSelectEventDetails(settings_disp, XkbUseCoreKbd, XkbControlsNotify,
+						XkbRepeatKeysMask, XkbRepeatKeysMask)
+				&& XkbSelectEventDetails(settings_disp, XkbUseCoreKbd, XkbIndicatorStateNotify,
+						XkbAllIndicatorsMask, XkbAllIndicatorsMask)
+				&& XkbSelectEvents(settings_disp, XkbUseCoreKbd, XkbNewKeyboardNotifyMask | XkbMapNotifyMask,
+						XkbNewKeyboardNotifyMask | XkbMapNotifyMask)
+				&& XkbSelectEventDetails(settings_disp, XkbUseCoreKbd, XkbStateNotify,
+						XkbGroupStateMask, XkbGroupStateMask);
+		if (xkb_enabled) {
+			unsigned int led_mask = 0x00;
+			if (XkbGetIndicatorState(settings_disp, XkbUseCoreKbd, &led_mask) == Success) {
+				set_indicator_state(led_mask);
+			}
+		}
+		else {
+			logger(LOG_LEVEL_WARN,	"%s [%u]: XKB notifications are not available!\n",
+					__FUNCTION__, __LINE__);
+		}
+		#endif
+
+		// Resource database changes, for the multi-click time.
+		XSelectInput(settings_disp, root, PropertyChangeMask);
+
+		XEvent ev;
+
+		while(settings_disp != NULL) {
+			XNextEvent(settings_disp, &ev);
+
+			#ifdef USE_XRANDR
+			if (xrandr_enabled && ev.type == xrandr_event_base + RRScreenChangeNotify) {
+				logger(LOG_LEVEL_DEBUG,	"%s [%u]: Received XRRScreenChangeNotifyEvent.\n",
+						__FUNCTION__, __LINE__);
+
+				XRRUpdateConfiguration(&ev);
+				update_xrandr_resources(settings_disp, root);
+				continue;
+			}
+			#endif
+
+			#ifdef USE_XKB
+			if (xkb_enabled && ev.type == xkb_event_base && ((XkbAnyEvent *) &ev)->xkb_type == XkbIndicatorStateNotify) {
+				set_indicator_state(((XkbIndicatorNotifyEvent *) &ev)->state);
+				continue;
+			}
+
+			if (xkb_enabled && ev.type == xkb_event_base && ((XkbAnyEvent *) &ev)->xkb_type == XkbControlsNotify) {
+				logger(LOG_LEVEL_DEBUG,	"%s [%u]: Received XkbControlsNotifyEvent.\n",
+						__FUNCTION__, __LINE__);
+
+				if (update_properties_cache(settings_disp, (uint64_t) ((XkbControlsNotifyEvent *) &ev)->time)) {
+					notify_properties_changed();
 				}
-				else {
-					logger(LOG_LEVEL_WARN,	"%s [%u]: XRandR is not currently available!\n",
-							__FUNCTION__, __LINE__);
+				continue;
+			}
+
+			if (xkb_enabled && ev.type == xkb_event_base && (((XkbAnyEvent *) &ev)->xkb_type == XkbNewKeyboardNotify
+					|| ((XkbAnyEvent *) &ev)->xkb_type == XkbMapNotify)) {
+				logger(LOG_LEVEL_DEBUG,	"%s [%u]: Received XKB keymap change.\n",
+						__FUNCTION__, __LINE__);
+
+				invalidate_key_table(KEY_TABLE_KEYMAP);
+				continue;
+			}
+
+			if (xkb_enabled && ev.type == xkb_event_base && ((XkbAnyEvent *) &ev)->xkb_type == XkbStateNotify) {
+				invalidate_key_table(KEY_TABLE_GROUP);
+				continue;
+			}
+			#endif
+
+			if (ev.type == MappingNotify && ev.xmapping.request != MappingPointer) {
+				logger(LOG_LEVEL_DEBUG,	"%s [%u]: Received MappingNotify.\n",
+						__FUNCTION__, __LINE__);
+
+				XRefreshKeyboardMapping(&ev.xmapping);
+				invalidate_key_table(KEY_TABLE_KEYMAP);
+				continue;
+			}
+
+			if (ev.type == PropertyNotify && ev.xproperty.atom == XA_RESOURCE_MANAGER) {
+				logger(LOG_LEVEL_DEBUG,	"%s [%u]: Received RESOURCE_MANAGER change.\n",
+						__FUNCTION__, __LINE__);
+
+				if (update_properties_cache(settings_disp, (uint64_t) ev.xproperty.time)) {
+					notify_properties_changed();
 				}
 			}
 		}
@@ -124,16 +276,16 @@ static void *settings_thread_proc(void *arg) {
 
 	return NULL;
 }
-#endif
 
-UIOHOOK_API screen_data* hook_create_screen_info(unsigned char *count) {
+// Ask the X server for the current screen layout.
+static screen_data* query_screen_info(Display *disp, unsigned char *count) {
 	*count = 0;
 	screen_data *screens = NULL;
 
 	#if defined(USE_XINERAMA) && !defined(USE_XRANDR)
-	if (XineramaIsActive(properties_disp)) {
+	if (XineramaIsActive(disp)) {
 		int xine_count = 0;
-		XineramaScreenInfo *xine_info = XineramaQueryScreens(properties_disp, &xine_count);
+		XineramaScreenInfo *xine_info = XineramaQueryScreens(disp, &xine_count);
 
 		if (xine_info != NULL) {
 			if (xine_count > UINT8_MAX) {
@@ -183,7 +335,7 @@ UIOHOOK_API screen_data* hook_create_screen_info(unsigned char *count) {
 		if (screens != NULL) {
 			int i = 0;
 			for (i = 0; i < xrandr_count; i++) {
-				XRRCrtcInfo *crtc_info = XRRGetCrtcInfo(properties_disp, xrandr_resources, xrandr_resources->crtcs[i]);
+				XRRCrtcInfo *crtc_info = XRRGetCrtcInfo(disp, xrandr_resources, xrandr_resources->crtcs[i]);
 
 				if (crtc_info != NULL) {
 					screens[i] = (screen_data) {
@@ -205,7 +357,7 @@ UIOHOOK_API screen_data* hook_create_screen_info(unsigned char *count) {
 	}
 	pthread_mutex_unlock(&xrandr_mutex);
 	#else
-	Screen* default_screen = DefaultScreenOfDisplay(properties_disp);
+	Screen* default_screen = DefaultScreenOfDisplay(disp);
 
 	if (default_screen->width > 0 && default_screen->height > 0) {
 		screens = malloc(sizeof(screen_data));
@@ -226,17 +378,74 @@ UIOHOOK_API screen_data* hook_create_screen_info(unsigned char *count) {
 	return screens;
 }
 
-UIOHOOK_API long int hook_get_auto_repeat_rate() {
+// Replace the cached screen layout with the current one.
+static void update_screen_cache(Display *disp) {
+	unsigned char count = 0;
+	screen_data *screens = NULL;
+	if (disp != NULL) {
+		screens = query_screen_info(disp, &count);
+	}
+
+	// Coordinates are only offset when more than one screen is attached.
+	uint32_t origin = 0;
+	if (screens != NULL && count > 1) {
+		origin = ((uint32_t) (uint16_t) screens[0].x << 16) | (uint16_t) screens[0].y;
+	}
+
+	pthread_mutex_lock(&screen_cache_mutex);
+	screen_data *old_screens = screen_cache;
+	screen_cache = screens;
+	screen_cache_count = screens != NULL ? count : 0;
+	__atomic_store_n(&screen_cache_origin, origin, __ATOMIC_RELEASE);
+	pthread_mutex_unlock(&screen_cache_mutex);
+
+	if (old_screens != NULL) {
+		free(old_screens);
+	}
+}
+
+// Origin of the first screen if more than one is attached, (0, 0) otherwise.
+// Used by the hook thread for every mouse event, so it only reads the cache.
+void get_screen_origin(int16_t *x, int16_t *y) {
+	uint32_t origin = __atomic_load_n(&screen_cache_origin, __ATOMIC_ACQUIRE);
+
+	*x = (int16_t) (origin >> 16);
+	*y = (int16_t) (origin & 0xFFFF);
+}
+
+UIOHOOK_API screen_data* hook_create_screen_info(unsigned char *count) {
+	#ifndef USE_XRANDR
+	// Nothing tells us about layout changes without XRandR, so look again.
+	update_screen_cache(properties_disp);
+	#endif
+
+	*count = 0;
+	screen_data *screens = NULL;
+
+	pthread_mutex_lock(&screen_cache_mutex);
+	if (screen_cache != NULL && screen_cache_count > 0) {
+		screens = malloc(sizeof(screen_data) * screen_cache_count);
+		if (screens != NULL) {
+			memcpy(screens, screen_cache, sizeof(screen_data) * screen_cache_count);
+			*count = screen_cache_count;
+		}
+	}
+	pthread_mutex_unlock(&screen_cache_mutex);
+
+	return screens;
+}
+
+static long int query_auto_repeat_rate(Display *disp) {
 	bool successful = false;
 	long int value = -1;
 	unsigned int delay = 0, rate = 0;
 
 	// Check and make sure we could connect to the x server.
-	if (properties_disp != NULL) {
+	if (disp != NULL) {
 		#ifdef USE_XKB
 		// Attempt to acquire the keyboard auto repeat rate using the XKB extension.
 		if (!successful) {
-			successful = XkbGetAutoRepeatRate(properties_disp, XkbUseCoreKbd, &delay, &rate);
+			successful = XkbGetAutoRepeatRate(disp, XkbUseCoreKbd, &delay, &rate);
 
 			if (successful) {
 				logger(LOG_LEVEL_INFO,	"%s [%u]: XkbGetAutoRepeatRate: %u.\n",
@@ -249,7 +458,7 @@ UIOHOOK_API long int hook_get_auto_repeat_rate() {
 		// Fallback to the XF86 Misc extension if available and other efforts failed.
 		if (!successful) {
 			XF86MiscKbdSettings kb_info;
-			successful = (bool) XF86MiscGetKbdSettings(properties_disp, &kb_info);
+			successful = (bool) XF86MiscGetKbdSettings(disp, &kb_info);
 			if (successful) {
 				logger(LOG_LEVEL_INFO,	"%s [%u]: XF86MiscGetKbdSettings: %i.\n",
 						__FUNCTION__, __LINE__, kbdinfo.rate);
@@ -272,17 +481,17 @@ UIOHOOK_API long int hook_get_auto_repeat_rate() {
 	return value;
 }
 
-UIOHOOK_API long int hook_get_auto_repeat_delay() {
+static long int query_auto_repeat_delay(Display *disp) {
 	bool successful = false;
 	long int value = -1;
 	unsigned int delay = 0, rate = 0;
 
 	// Check and make sure we could connect to the x server.
-	if (properties_disp != NULL) {
+	if (disp != NULL) {
 		#ifdef USE_XKB
 		// Attempt to acquire the keyboard auto repeat rate using the XKB extension.
 		if (!successful) {
-			successful = XkbGetAutoRepeatRate(properties_disp, XkbUseCoreKbd, &delay, &rate);
+			successful = XkbGetAutoRepeatRate(disp, XkbUseCoreKbd, &delay, &rate);
 
 			if (successful) {
 				logger(LOG_LEVEL_INFO,	"%s [%u]: XkbGetAutoRepeatRate: %u.\n",
@@ -295,7 +504,7 @@ UIOHOOK_API long int hook_get_auto_repeat_delay() {
 		// Fallback to the XF86 Misc extension if available and other efforts failed.
 		if (!successful) {
 			XF86MiscKbdSettings kb_info;
-			successful = (bool) XF86MiscGetKbdSettings(properties_disp, &kb_info);
+			successful = (bool) XF86MiscGetKbdSettings(disp, &kb_info);
 			if (successful) {
 				logger(LOG_LEVEL_INFO,	"%s [%u]: XF86MiscGetKbdSettings: %i.\n",
 						__FUNCTION__, __LINE__, kbdinfo.delay);
@@ -318,13 +527,13 @@ UIOHOOK_API long int hook_get_auto_repeat_delay() {
 	return value;
 }
 
-UIOHOOK_API long int hook_get_pointer_acceleration_multiplier() {
+static long int query_pointer_acceleration_multiplier(Display *disp) {
 	long int value = -1;
 	int accel_numerator, accel_denominator, threshold;
 
 	// Check and make sure we could connect to the x server.
-	if (properties_disp != NULL) {
-		XGetPointerControl(properties_disp, &accel_numerator, &accel_denominator, &threshold);
+	if (disp != NULL) {
+		XGetPointerControl(disp, &accel_numerator, &accel_denominator, &threshold);
 		if (accel_denominator >= 0) {
 			logger(LOG_LEVEL_INFO,	"%s [%u]: XGetPointerControl: %i.\n",
 					__FUNCTION__, __LINE__, accel_denominator);
@@ -340,13 +549,13 @@ UIOHOOK_API long int hook_get_pointer_acceleration_multiplier() {
 	return value;
 }
 
-UIOHOOK_API long int hook_get_pointer_acceleration_threshold() {
+static long int query_pointer_acceleration_threshold(Display *disp) {
 	long int value = -1;
 	int accel_numerator, accel_denominator, threshold;
 
 	// Check and make sure we could connect to the x server.
-	if (properties_disp != NULL) {
-		XGetPointerControl(properties_disp, &accel_numerator, &accel_denominator, &threshold);
+	if (disp != NULL) {
+		XGetPointerControl(disp, &accel_numerator, &accel_denominator, &threshold);
 		if (threshold >= 0) {
 			logger(LOG_LEVEL_INFO,	"%s [%u]: XGetPointerControl: %i.\n",
 					__FUNCTION__, __LINE__, threshold);
@@ -362,13 +571,13 @@ UIOHOOK_API long int hook_get_pointer_acceleration_threshold() {
 	return value;
 }
 
-UIOHOOK_API long int hook_get_pointer_sensitivity() {
+static long int query_pointer_sensitivity(Display *disp) {
 	long int value = -1;
 	int accel_numerator, accel_denominator, threshold;
 
 	// Check and make sure we could connect to the x server.
-	if (properties_disp != NULL) {
-		XGetPointerControl(properties_disp, &accel_numerator, &accel_denominator, &threshold);
+	if (disp != NULL) {
+		XGetPointerControl(disp, &accel_numerator, &accel_denominator, &threshold);
 		if (accel_numerator >= 0) {
 			logger(LOG_LEVEL_INFO,	"%s [%u]: XGetPointerControl: %i.\n",
 					__FUNCTION__, __LINE__, accel_numerator);
@@ -384,7 +593,43 @@ UIOHOOK_API long int hook_get_pointer_sensitivity() {
 	return value;
 }
 
-UIOHOOK_API long int hook_get_multi_click_time() {
+// Load the current RESOURCE_MANAGER property.  XGetDefault() keeps using the
+// database that was loaded when the display was opened, so it never sees
+// changes made with xrdb afterwards.
+static XrmDatabase load_resources(Display *disp) {
+	XrmDatabase resources = NULL;
+
+	Atom type;
+	int format;
+	unsigned long count, remaining;
+	unsigned char *data = NULL;
+	if (XGetWindowProperty(disp, XDefaultRootWindow(disp), XA_RESOURCE_MANAGER, 0, LONG_MAX / 4, False, XA_STRING,
+			&type, &format, &count, &remaining, &data) == Success && data != NULL) {
+		if (type == XA_STRING && format == 8) {
+			resources = XrmGetStringDatabase((char *) data);
+		}
+
+		XFree(data);
+	}
+
+	return resources;
+}
+
+static char* get_resource(XrmDatabase resources, const char *name, const char *class) {
+	char *value = NULL;
+
+	if (resources != NULL) {
+		char *type;
+		XrmValue resource;
+		if (XrmGetResource(resources, name, class, &type, &resource) && resource.addr != NULL) {
+			value = (char *) resource.addr;
+		}
+	}
+
+	return value;
+}
+
+static long int query_multi_click_time(Display *disp) {
 	long int value = 200;
 	int click_time;
 	bool successful = false;
@@ -411,12 +656,14 @@ UIOHOOK_API long int hook_get_multi_click_time() {
 	#endif
 
 	// Check and make sure we could connect to the x server.
-	if (properties_disp != NULL) {
+	if (disp != NULL) {
+		XrmDatabase resources = load_resources(disp);
+
 		// Try and acquire the multi-click time from the user defined X defaults.
 		if (!successful) {
-			char *xprop = XGetDefault(properties_disp, "*", "multiClickTime");
+			char *xprop = get_resource(resources, "multiClickTime", "MultiClickTime");
 			if (xprop != NULL && sscanf(xprop, "%4i", &click_time) != EOF) {
-				logger(LOG_LEVEL_INFO,	"%s [%u]: X default 'multiClickTime' property: %i.\n",
+				logger(LOG_LEVEL_INFO,	"%s [%u]: X resource 'multiClickTime': %i.\n",
 						__FUNCTION__, __LINE__, click_time);
 
 				successful = true;
@@ -424,14 +671,18 @@ UIOHOOK_API long int hook_get_multi_click_time() {
 		}
 
 		if (!successful) {
-			char *xprop = XGetDefault(properties_disp, "OpenWindows", "MultiClickTimeout");
+			char *xprop = get_resource(resources, "OpenWindows.MultiClickTimeout", "OpenWindows.MultiClickTimeout");
 			if (xprop != NULL && sscanf(xprop, "%4i", &click_time) != EOF) {
-				logger(LOG_LEVEL_INFO,	"%s [%u]: X default 'MultiClickTimeout' property: %i.\n",
+				logger(LOG_LEVEL_INFO,	"%s [%u]: X resource 'MultiClickTimeout': %i.\n",
 						__FUNCTION__, __LINE__, click_time);
 
 				successful = true;
 			}
 		}
+
+		if (resources != NULL) {
+			XrmDestroyDatabase(resources);
+		}
 	}
 	else {
 		logger(LOG_LEVEL_ERROR,	"%s [%u]: %s\n",
@@ -445,11 +696,93 @@ UIOHOOK_API long int hook_get_multi_click_time() {
 	return value;
 }
 
+// Query every property and publish them if anything changed.  Returns whether
+// they did.
+static bool update_properties_cache(Display *disp, uint64_t timestamp) {
+	system_properties properties = {
+		.auto_repeat_rate = query_auto_repeat_rate(disp),
+		.auto_repeat_delay = query_auto_repeat_delay(disp),
+		.pointer_acceleration_multiplier = query_pointer_acceleration_multiplier(disp),
+		.pointer_acceleration_threshold = query_pointer_acceleration_threshold(disp),
+		.pointer_sensitivity = query_pointer_sensitivity(disp),
+		.multi_click_time = query_multi_click_time(disp)
+	};
+
+	pthread_mutex_lock(&properties_cache_mutex);
+	bool changed = memcmp(&properties, &properties_cache, sizeof(system_properties)) != 0;
+	if (changed) {
+		__atomic_store_n(&properties_cache.auto_repeat_rate, properties.auto_repeat_rate, __ATOMIC_RELAXED);
+		__atomic_store_n(&properties_cache.auto_repeat_delay, properties.auto_repeat_delay, __ATOMIC_RELAXED);
+		__atomic_store_n(&properties_cache.pointer_acceleration_multiplier, properties.pointer_acceleration_multiplier, __ATOMIC_RELAXED);
+		__atomic_store_n(&properties_cache.pointer_acceleration_threshold, properties.pointer_acceleration_threshold, __ATOMIC_RELAXED);
+		__atomic_store_n(&properties_cache.pointer_sensitivity, properties.pointer_sensitivity, __ATOMIC_RELAXED);
+		__atomic_store_n(&properties_cache.multi_click_time, properties.multi_click_time, __ATOMIC_RELAXED);
+
+		__atomic_store_n(&properties_time, timestamp, __ATOMIC_RELAXED);
+		__atomic_add_fetch(&properties_generation, 1, __ATOMIC_RELEASE);
+
+		logger(LOG_LEVEL_DEBUG,	"%s [%u]: System properties changed.\n",
+				__FUNCTION__, __LINE__);
+	}
+	pthread_mutex_unlock(&properties_cache_mutex);
+
+	return changed;
+}
+
+// Query the properties again.  The X server does not report pointer control
+// changes, so the hook does this whenever it starts.
+void reload_system_properties() {
+	update_properties_cache(properties_disp, 0);
+}
+
+// Incremented every time the cached properties change.
+unsigned int get_properties_generation() {
+	return __atomic_load_n(&properties_generation, __ATOMIC_ACQUIRE);
+}
+
+// Server time of the change that produced the generation last read, or 0 if
+// it was not reported by the server.
+uint64_t get_properties_time() {
+	return __atomic_load_n(&properties_time, __ATOMIC_RELAXED);
+}
+
+UIOHOOK_API void hook_get_system_properties(system_properties *properties) {
+	pthread_mutex_lock(&properties_cache_mutex);
+	*properties = properties_cache;
+	pthread_mutex_unlock(&properties_cache_mutex);
+}
+
+UIOHOOK_API long int hook_get_auto_repeat_rate() {
+	return __atomic_load_n(&properties_cache.auto_repeat_rate, __ATOMIC_RELAXED);
+}
+
+UIOHOOK_API long int hook_get_auto_repeat_delay() {
+	return __atomic_load_n(&properties_cache.auto_repeat_delay, __ATOMIC_RELAXED);
+}
+
+UIOHOOK_API long int hook_get_pointer_acceleration_multiplier() {
+	return __atomic_load_n(&properties_cache.pointer_acceleration_multiplier, __ATOMIC_RELAXED);
+}
+
+UIOHOOK_API long int hook_get_pointer_acceleration_threshold() {
+	return __atomic_load_n(&properties_cache.pointer_acceleration_threshold, __ATOMIC_RELAXED);
+}
+
+UIOHOOK_API long int hook_get_pointer_sensitivity() {
+	return __atomic_load_n(&properties_cache.pointer_sensitivity, __ATOMIC_RELAXED);
+}
+
+UIOHOOK_API long int hook_get_multi_click_time() {
+	// Called for every button press and release on the hook thread.
+	return __atomic_load_n(&properties_cache.multi_click_time, __ATOMIC_RELAXED);
+}
+
 // Create a shared object constructor.
 __attribute__ ((constructor))
 void on_library_load() {
 	// Make sure we are initialized for threading.
 	XInitThreads();
+	XrmInitialize();
 
 	// Open local display.
 	properties_disp = XOpenDisplay(XDisplayName(NULL));
@@ -462,7 +795,18 @@ void on_library_load() {
 				__FUNCTION__, __LINE__, "XOpenDisplay success.");
 	}
 
-	#ifdef USE_XRANDR
+	#ifdef USE_XT
+	XtToolkitInitialize();
+	xt_context = XtCreateApplicationContext();
+
+	int argc = 0;
+	char ** argv = { NULL };
+	xt_disp = XtOpenDisplay(xt_context, NULL, "UIOHook", "libuiohook", NULL, 0, &argc, argv);
+	#endif
+
+	// Load the system properties, the settings thread keeps them current.
+	update_properties_cache(properties_disp, 0);
+
 	// Create the thread attribute.
 	pthread_attr_t settings_thread_attr;
 	pthread_attr_init(&settings_thread_attr);
@@ -479,19 +823,14 @@ void on_library_load() {
 
 	// Make sure the thread attribute is removed.
 	pthread_attr_destroy(&settings_thread_attr);
-	#endif
-
-	#ifdef USE_XT
-	XtToolkitInitialize();
-	xt_context = XtCreateApplicationContext();
-
-	int argc = 0;
-	char ** argv = { NULL };
-	xt_disp = XtOpenDisplay(xt_context, NULL, "UIOHook", "libuiohook", NULL, 0, &argc, argv);
-	#endif
 
 	// Initialize.
 	load_input_helper(properties_disp);
+
+	#ifndef USE_XRANDR
+	// The settings thread loads the cache when XRandR is available.
+	update_screen_cache(properties_disp);
+	#endif
 }
 
 // Create a shared object destructor.
@@ -503,6 +842,14 @@ void on_library_unload() {
 	// Cleanup.
 	unload_input_helper();
 
+	pthread_mutex_lock(&screen_cache_mutex);
+	if (screen_cache != NULL) {
+		free(screen_cache);
+		screen_cache = NULL;
+		screen_cache_count = 0;
+	}
+	pthread_mutex_unlock(&screen_cache_mutex);
+
 	#ifdef USE_XT
 	XtCloseDisplay(xt_disp);
 	XtDestroyApplicationContext(xt_context);
@@ -0,0 +1,451 @@
+/* libUIOHook: Cross-platfrom userland keyboard and mouse hooking.
+ * Copyright (C) 2006-2017 Alexander Barker.  All Rights Received.
+ * https://github.com/kwhat/libuiohook/
+ *
+ * libUIOHook is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libUIOHook is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Microbenchmark for the X11 key translation functions.
+ *
+ * The input helper is compiled into this program so the direct maps can be
+ * compared against binary searches over the same keysym_unicode_table.  Every
+ * 16-bit keysym and character is checked for identical results before the
+ * lookups are timed, and the program fails if any result differs.
+ *
+ * All 256 keycodes are also swept through keycode_to_scancode() and
+ * scancode_to_keycode(), for both the XFree86 and the evdev tables, and
+ * checked against input_helper_golden.h.  With xkbcommon, keycode_to_unicode()
+ * is checked against a US layout and timed, using a keymap compiled from the
+ * XKB data files, or the keymap of the X server with -d, for example under
+ * Xvfb.
+ *
+ * Usage: benchhook [-d]
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "input_helper.c"
+#include "input_helper_golden.h"
+
+#define BENCH_ROUNDS 2000
+
+#define TABLE_SIZE (sizeof(keysym_unicode_table) / sizeof(struct codepair))
+
+// keysym_to_unicode() as it was before the direct maps.
+static size_t search_keysym_to_unicode(KeySym keysym, uint16_t *buffer, size_t size) {
+	size_t count = 0;
+
+	int min = 0;
+	int max = TABLE_SIZE - 1;
+	int mid;
+
+	#ifdef XK_LATIN1
+	if ((keysym >= 0x0020 && keysym <= 0x007E)
+			|| (keysym >= 0x00A0 && keysym <= 0x00FF)) {
+
+		if (count < size) {
+			buffer[count++] = keysym;
+		}
+
+		return count;
+	}
+	#endif
+
+	if ((keysym & 0xFF000000) == 0x01000000) {
+		if (count < size) {
+			buffer[count++] = keysym & 0x00FFFFFF;
+		}
+
+		return count;
+	}
+
+	while (max >= min) {
+		mid = (min + max) / 2;
+		if (keysym_unicode_table[mid].keysym < keysym) {
+			min = mid + 1;
+		}
+		else if (keysym_unicode_table[mid].keysym > keysym) {
+			max = mid - 1;
+		}
+		else {
+			if (count < size) {
+				buffer[count++] = keysym_unicode_table[mid].unicode;
+			}
+
+			return count;
+		}
+	}
+
+	return count;
+}
+
+// unicode_to_keysym() as it was before the direct maps.  The table is sorted
+// by keysym, not by character, so this search misses most characters.
+static KeySym search_unicode_to_keysym(uint16_t unicode) {
+	int min = 0;
+	int max = TABLE_SIZE - 1;
+	int mid;
+
+	#ifdef XK_LATIN1
+	if ((unicode >= 0x0020 && unicode <= 0x007E) ||
+			(unicode >= 0x00A0 && unicode <= 0x00FF)) {
+		return unicode;
+	}
+	#endif
+
+	while (max >= min) {
+		mid = (min + max) / 2;
+		if (keysym_unicode_table[mid].unicode < unicode) {
+			min = mid + 1;
+		}
+		else if (keysym_unicode_table[mid].unicode > unicode) {
+			max = mid - 1;
+		}
+		else {
+			return keysym_unicode_table[mid].keysym;
+		}
+	}
+
+	return unicode | 0x01000000;
+}
+
+// The result unicode_to_keysym() is meant to have: the first keysym of the
+// table for the character.
+static KeySym scan_unicode_to_keysym(uint16_t unicode) {
+	#ifdef XK_LATIN1
+	if ((unicode >= 0x0020 && unicode <= 0x007E) ||
+			(unicode >= 0x00A0 && unicode <= 0x00FF)) {
+		return unicode;
+	}
+	#endif
+
+	size_t i;
+	for (i = 0; i < TABLE_SIZE; i++) {
+		if (keysym_unicode_table[i].unicode == unicode) {
+			return keysym_unicode_table[i].keysym;
+		}
+	}
+
+	return unicode | 0x01000000;
+}
+
+static double now() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int check_keysym_to_unicode() {
+	int failures = 0;
+
+	uint32_t keysym;
+	for (keysym = 0; keysym <= 0xFFFF; keysym++) {
+		uint16_t expected[2] = { 0, 0 }, actual[2] = { 0, 0 };
+		size_t expected_count = search_keysym_to_unicode(keysym, expected, 2);
+		size_t actual_count = keysym_to_unicode(keysym, actual, 2);
+
+		if (expected_count != actual_count || expected[0] != actual[0]) {
+			printf("keysym_to_unicode(%#06X): expected %zu [%#06X], got %zu [%#06X]\n",
+					keysym, expected_count, expected[0], actual_count, actual[0]);
+			failures++;
+		}
+	}
+
+	return failures;
+}
+
+static int check_unicode_to_keysym() {
+	int failures = 0, search_misses = 0;
+
+	uint32_t unicode;
+	for (unicode = 0; unicode <= 0xFFFF; unicode++) {
+		KeySym expected = scan_unicode_to_keysym(unicode);
+		KeySym actual = unicode_to_keysym(unicode);
+
+		if (expected != actual) {
+			printf("unicode_to_keysym(U+%04X): expected %#lX, got %#lX\n",
+					unicode, expected, actual);
+			failures++;
+		}
+
+		if (search_unicode_to_keysym(unicode) != expected) {
+			search_misses++;
+		}
+	}
+
+	printf("unicode_to_keysym: the binary search got %d of 65536 characters wrong\n", search_misses);
+
+	return failures;
+}
+
+static void bench_keysym_to_unicode() {
+	uint16_t buffer[2];
+	volatile size_t sink = 0;
+	size_t i;
+	int round;
+
+	double start = now();
+	for (round = 0; round < BENCH_ROUNDS; round++) {
+		for (i = 0; i < TABLE_SIZE; i++) {
+			sink += search_keysym_to_unicode(keysym_unicode_table[i].keysym, buffer, 2);
+		}
+	}
+	double search = now() - start;
+
+	start = now();
+	for (round = 0; round < BENCH_ROUNDS; round++) {
+		for (i = 0; i < TABLE_SIZE; i++) {
+			sink += keysym_to_unicode(keysym_unicode_table[i].keysym, buffer, 2);
+		}
+	}
+	double map = now() - start;
+
+	double lookups = (double) BENCH_ROUNDS * TABLE_SIZE;
+	printf("keysym_to_unicode: binary search %.2f ns, direct map %.2f ns per lookup (%.1fx)\n",
+			search * 1e9 / lookups, map * 1e9 / lookups, search / map);
+}
+
+static void bench_unicode_to_keysym() {
+	volatile KeySym sink = 0;
+	size_t i;
+	int round;
+
+	double start = now();
+	for (round = 0; round < BENCH_ROUNDS; round++) {
+		for (i = 0; i < TABLE_SIZE; i++) {
+			sink += search_unicode_to_keysym(keysym_unicode_table[i].unicode);
+		}
+	}
+	double search = now() - start;
+
+	start = now();
+	for (round = 0; round < BENCH_ROUNDS; round++) {
+		for (i = 0; i < TABLE_SIZE; i++) {
+			sink += unicode_to_keysym(keysym_unicode_table[i].unicode);
+		}
+	}
+	double map = now() - start;
+
+	double lookups = (double) BENCH_ROUNDS * TABLE_SIZE;
+	printf("unicode_to_keysym: binary search %.2f ns, direct map %.2f ns per lookup (%.1fx)\n",
+			search * 1e9 / lookups, map * 1e9 / lookups, search / map);
+}
+
+static int check_scancode_table(const char *name, const uint16_t *scancodes, const uint16_t *keycodes) {
+	int failures = 0;
+
+	unsigned int keycode;
+	for (keycode = 0; keycode <= 0xFF; keycode++) {
+		uint16_t scancode = keycode_to_scancode(keycode);
+		if (scancode != scancodes[keycode]) {
+			printf("%s keycode_to_scancode(%u): expected %#06X, got %#06X\n",
+					name, keycode, scancodes[keycode], scancode);
+			failures++;
+		}
+
+		KeyCode actual = scancode_to_keycode(scancodes[keycode]);
+		if (actual != keycodes[keycode]) {
+			printf("%s scancode_to_keycode(%#06X): expected %u, got %u\n",
+					name, scancodes[keycode], keycodes[keycode], actual);
+			failures++;
+		}
+	}
+
+	return failures;
+}
+
+static void bench_scancode_table(const char *name, const uint16_t *scancodes) {
+	volatile unsigned int sink = 0;
+	unsigned int keycode;
+	int round;
+
+	double start = now();
+	for (round = 0; round < BENCH_ROUNDS; round++) {
+		for (keycode = 0; keycode <= 0xFF; keycode++) {
+			sink += keycode_to_scancode(keycode);
+		}
+	}
+	double to_scancode = now() - start;
+
+	start = now();
+	for (round = 0; round < BENCH_ROUNDS; round++) {
+		for (keycode = 0; keycode <= 0xFF; keycode++) {
+			sink += scancode_to_keycode(scancodes[keycode]);
+		}
+	}
+	double to_keycode = now() - start;
+
+	double calls = (double) BENCH_ROUNDS * 0x100;
+	printf("%s: keycode_to_scancode %.2f ns, scancode_to_keycode %.2f ns per call\n",
+			name, to_scancode * 1e9 / calls, to_keycode * 1e9 / calls);
+}
+
+#ifdef USE_XKBCOMMON
+// Characters of the US layout without and with Shift, by rows of consecutive
+// evdev keycodes.
+static const struct {
+	KeyCode keycode;
+	const char *plain;
+	const char *shifted;
+} us_layout[] = {
+	{ 10, "1234567890-=",	"!@#$%^&*()_+"	},
+	{ 24, "qwertyuiop[]",	"QWERTYUIOP{}"	},
+	{ 38, "asdfghjkl;'`",	"ASDFGHJKL:\"~"	},
+	{ 51, "\\zxcvbnm,./",	"|ZXCVBNM<>?"	},
+	{ 65, " ",				" "				},
+};
+
+static struct xkb_state * create_bench_state(struct xkb_context *context, Display *disp) {
+	if (disp != NULL) {
+		return create_xkb_state(context, XGetXCBConnection(disp));
+	}
+
+	struct xkb_rule_names names = {
+		.rules = "evdev",
+		.model = "pc105",
+		.layout = "us",
+		.variant = NULL,
+		.options = NULL
+	};
+
+	struct xkb_keymap *keymap = xkb_keymap_new_from_names(context, &names, XKB_KEYMAP_COMPILE_NO_FLAGS);
+	if (keymap == NULL) {
+		return NULL;
+	}
+
+	struct xkb_state *state = xkb_state_new(keymap);
+	xkb_keymap_unref(keymap);
+
+	return state;
+}
+
+static int check_keycode_to_unicode(struct xkb_state *state) {
+	int failures = 0;
+
+	xkb_mod_index_t shift_mod = xkb_keymap_mod_get_index(xkb_state_get_keymap(state), XKB_MOD_NAME_SHIFT);
+
+	int shifted;
+	for (shifted = 0; shifted <= 1; shifted++) {
+		xkb_state_update_mask(state, shifted ? 1 << shift_mod : 0, 0, 0, 0, 0, 0);
+
+		size_t row, i;
+		for (row = 0; row < sizeof(us_layout) / sizeof(us_layout[0]); row++) {
+			const char *chars = shifted ? us_layout[row].shifted : us_layout[row].plain;
+
+			for (i = 0; chars[i] != '\0'; i++) {
+				KeyCode keycode = us_layout[row].keycode + i;
+				uint16_t buffer[2] = { 0, 0 };
+				size_t count = keycode_to_unicode(state, keycode, buffer, 2);
+
+				if (count != 1 || buffer[0] != (uint16_t) chars[i]) {
+					printf("keycode_to_unicode(%u)%s: expected '%c', got %zu [%#06X]\n",
+							keycode, shifted ? " with Shift" : "", chars[i], count, buffer[0]);
+					failures++;
+				}
+			}
+		}
+	}
+
+	xkb_state_update_mask(state, 0, 0, 0, 0, 0, 0);
+
+	return failures;
+}
+
+static void bench_keycode_to_unicode(struct xkb_state *state) {
+	uint16_t buffer[2];
+	volatile size_t sink = 0;
+	unsigned int keycode;
+	int round;
+
+	double start = now();
+	for (round = 0; round < BENCH_ROUNDS; round++) {
+		for (keycode = 0; keycode <= 0xFF; keycode++) {
+			sink += keycode_to_unicode(state, keycode, buffer, 2);
+		}
+	}
+	double elapsed = now() - start;
+
+	double calls = (double) BENCH_ROUNDS * 0x100;
+	printf("keycode_to_unicode: %.2f ns per call\n", elapsed * 1e9 / calls);
+}
+#endif
+
+int main(int argc, char *argv[]) {
+	Display *disp = NULL;
+	if (argc > 1) {
+		if (strcmp(argv[1], "-d") != 0) {
+			printf("Usage: %s [-d]\n", argv[0]);
+			return 1;
+		}
+
+		disp = XOpenDisplay(NULL);
+		if (disp == NULL) {
+			printf("Unable to open the X display!\n");
+			return 1;
+		}
+	}
+
+	load_unicode_maps();
+
+	int failures = check_keysym_to_unicode() + check_unicode_to_keysym();
+
+	#if defined(USE_EVDEV) && defined(USE_XKB)
+	is_evdev = true;
+	failures += check_scancode_table("evdev", golden_evdev_scancodes, golden_evdev_keycodes);
+	is_evdev = false;
+	#endif
+	failures += check_scancode_table("xfree86", golden_xfree86_scancodes, golden_xfree86_keycodes);
+
+	#ifdef USE_XKBCOMMON
+	struct xkb_context *context = xkb_context_new(XKB_CONTEXT_NO_FLAGS);
+	struct xkb_state *state = context != NULL ? create_bench_state(context, disp) : NULL;
+	if (state == NULL) {
+		printf("Unable to create the keymap!\n");
+		return 1;
+	}
+
+	failures += check_keycode_to_unicode(state);
+	#endif
+
+	if (failures > 0) {
+		printf("%d lookups differ from the reference.\n", failures);
+		return 1;
+	}
+
+	bench_keysym_to_unicode();
+	bench_unicode_to_keysym();
+
+	#if defined(USE_EVDEV) && defined(USE_XKB)
+	is_evdev = true;
+	bench_scancode_table("evdev", golden_evdev_scancodes);
+	is_evdev = false;
+	#endif
+	bench_scancode_table("xfree86", golden_xfree86_scancodes);
+
+	#ifdef USE_XKBCOMMON
+	bench_keycode_to_unicode(state);
+
+	destroy_xkb_state(state);
+	xkb_context_unref(context);
+	#endif
+
+	if (disp != NULL) {
+		XCloseDisplay(disp);
+	}
+
+	return 0;
+}
@@ -93,9 +93,55 @@ static char * test_bidirectional_scancode() {
 	return NULL;
 }
 
+#if !defined(__APPLE__) && !defined(__MACH__) && !defined(_WIN32)
+/* Indicator state reported by the fake server for test_key_lock_mask() */
+static unsigned int server_led_mask;
+static unsigned int led_queries;
+
+static unsigned int query_led_mask() {
+	led_queries++;
+
+	return server_led_mask;
+}
+
+/* Make sure lock key presses follow the server and nothing else asks it */
+static char * test_key_lock_mask() {
+	led_queries = 0;
+
+	// Caps Lock mapped to a key that does not toggle the LED, as with
+	// ctrl:nocaps: the tracked state never changes, and neither may the mask.
+	server_led_mask = 0x00;
+	mu_assert("error, caps lock set without an LED", key_lock_mask(VC_CAPS_LOCK, true, 0x00, query_led_mask) == 0x0000);
+	mu_assert("error, caps lock set on release", key_lock_mask(VC_CAPS_LOCK, false, 0x00, query_led_mask) == 0x0000);
+	mu_assert("error, caps lock set without an LED", key_lock_mask(VC_CAPS_LOCK, true, 0x00, query_led_mask) == 0x0000);
+	mu_assert("error, caps lock set on release", key_lock_mask(VC_CAPS_LOCK, false, 0x00, query_led_mask) == 0x0000);
+	mu_assert("error, server not asked for each lock key press", led_queries == 2);
+
+	// Two presses before the tracked state catches up.
+	server_led_mask = 0x01;
+	mu_assert("error, caps lock not set", key_lock_mask(VC_CAPS_LOCK, true, 0x00, query_led_mask) == MASK_CAPS_LOCK);
+	server_led_mask = 0x00;
+	mu_assert("error, caps lock not cleared", key_lock_mask(VC_CAPS_LOCK, true, 0x00, query_led_mask) == 0x0000);
+
+	// A keyboard without a Scroll Lock LED.
+	mu_assert("error, scroll lock set without an LED", key_lock_mask(VC_SCROLL_LOCK, true, 0x00, query_led_mask) == 0x0000);
+	mu_assert("error, server not asked for each lock key press", led_queries == 5);
+
+	// Every other key uses the tracked state, which other clients change too.
+	mu_assert("error, tracked num lock not used", key_lock_mask(VC_A, true, 0x02, query_led_mask) == MASK_NUM_LOCK);
+	mu_assert("error, tracked locks not used", key_lock_mask(VC_NUM_LOCK, false, 0x05, query_led_mask) == (MASK_CAPS_LOCK | MASK_SCROLL_LOCK));
+	mu_assert("error, server asked for an ordinary key", led_queries == 5);
+
+	return NULL;
+}
+#endif
+
 char * input_helper_tests() {
 	mu_run_test(test_bidirectional_keycode);
 	mu_run_test(test_bidirectional_scancode);
+	#if !defined(__APPLE__) && !defined(__MACH__) && !defined(_WIN32)
+	mu_run_test(test_key_lock_mask);
+	#endif
 
 	return NULL;
 }
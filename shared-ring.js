@@ -0,0 +1,99 @@
+/**
+ * Reader for the binary event ring used by `start({ shared: true })`.
+ *
+ * The native hook thread writes one fixed-size record per event into a
+ * SharedArrayBuffer and advances the head index. This reader walks the records
+ * between tail and head through a single Int32Array, then publishes the new
+ * tail with Atomics.store() so the slots can be reused. Nothing is allocated
+ * per event.
+ */
+class SharedEventRing {
+  /**
+   * @param {SharedArrayBuffer} buffer Buffer returned by the native addon
+   * @param {Object} layout Layout description exported by the native addon
+   */
+  constructor(buffer, layout) {
+    this.buffer = buffer;
+    this.layout = layout;
+
+    /**
+     * Int32Array over the whole buffer. Record fields are read as
+     * `ring.view[offset + ring.fields.x]`.
+     */
+    this.view = new Int32Array(buffer);
+    this.fields = layout.fields;
+    this.capacity = this.view[layout.capacity];
+
+    this._mask = this.capacity - 1;
+    this._recordInts = this.view[layout.recordInts];
+    this._recordsStart = layout.headerBytes / 4;
+  }
+
+  /**
+   * Number of records waiting to be read.
+   * @return {number}
+   */
+  get pending() {
+    const head = Atomics.load(this.view, this.layout.head);
+    const tail = Atomics.load(this.view, this.layout.tail);
+    return (head - tail) >>> 0;
+  }
+
+  /**
+   * Number of events the hook thread dropped because the ring was full.
+   * @return {number}
+   */
+  get dropped() {
+    return Atomics.load(this.view, this.layout.dropped) >>> 0;
+  }
+
+  /**
+   * Call `visitor(view, offset)` for every pending record, oldest first.
+   * `offset` is the Int32Array index of the record, so a field is read with
+   * `view[offset + ring.fields.name]`. The record is only valid during the
+   * call.
+   * @param {Function} visitor
+   * @return {number} Number of records read
+   */
+  read(visitor) {
+    const view = this.view;
+    const head = Atomics.load(view, this.layout.head);
+    let tail = Atomics.load(view, this.layout.tail);
+    let count = 0;
+
+    while (tail !== head) {
+      visitor(
+        view,
+        this._recordsStart + (tail & this._mask) * this._recordInts
+      );
+      tail = (tail + 1) | 0;
+      count++;
+    }
+
+    Atomics.store(view, this.layout.tail, tail);
+    return count;
+  }
+
+  /**
+   * Skip every pending record without reading it.
+   */
+  discard() {
+    const head = Atomics.load(this.view, this.layout.head);
+    Atomics.store(this.view, this.layout.tail, head);
+  }
+
+  /**
+   * Event time of a record in milliseconds.
+   * @param {number} offset Record offset as passed to the `read()` visitor
+   * @return {number}
+   */
+  time(offset) {
+    const view = this.view;
+    return (
+      (view[offset + this.fields.timeHigh] >>> 0) * 0x100000000 +
+      (view[offset + this.fields.timeLow] >>> 0)
+    );
+  }
+}
+
+module.exports = SharedEventRing;
@@ -0,0 +1,229 @@
+#pragma once
+
+#include <cstdint>
+
+#include "uiohook.h"
+#include "event_ring.h"
+
+// An event ready for JavaScript.  Events that went through coalescing carry
+// the number of events merged into them, and for motion the distance the
+// pointer covered across them; samples is 0 for every other event.
+struct CoalescedEvent
+{
+  QueuedEvent queued;
+  uint64_t dequeued;
+  int32_t dx;
+  int32_t dy;
+  uint32_t samples;
+};
+
+// Merges runs of mouse motion and wheel events taken off the ring, on the JS
+// thread, so a burst costs one event object and one emit instead of one per
+// event.
+//
+// A run is consecutive events of the same type and modifier mask; wheel
+// events must also scroll the same way.  A motion run keeps the position of
+// its last event, a wheel run the sum of the rotations.  Any other event
+// ends the run first, so events still reach JavaScript in the order they
+// happened.  Without a rate the run is delivered at the end of every drain,
+// so events are only merged while JavaScript is behind.  With a rate, runs
+// are delivered at most that many times a second and keep growing across
+// drains in between.
+class EventCoalescer
+{
+  public:
+
+    EventCoalescer(bool motion, bool wheel, uint32_t rate) :
+    fMotion(motion),
+    fWheel(wheel),
+    fPeriod(rate > 0 ? 1000000000ULL / rate : 0),
+    fDelivered(0),
+    fHasRun(false),
+    fHasPosition(false),
+    fLastX(0),
+    fLastY(0),
+    fRunX(0),
+    fRunY(0)
+    {
+    }
+
+    // Take the next event off the ring.  Returns the number of events to
+    // deliver now, in order, which is at most two: the run it ended and the
+    // event itself.
+    size_t Add(const QueuedEvent &queued, uint64_t dequeued, CoalescedEvent ready[2])
+    {
+      const uiohook_event &event = queued.event;
+      size_t count = 0;
+
+      if (fHasRun && Continues(event)) {
+        Merge(event);
+        Track(event);
+        return 0;
+      }
+
+      if (fHasRun) {
+        TakeRun(ready[count++], dequeued);
+      }
+
+      if (Coalesces(event)) {
+        StartRun(queued, dequeued);
+      } else {
+        ready[count].queued = queued;
+        ready[count].dequeued = dequeued;
+        ready[count].dx = 0;
+        ready[count].dy = 0;
+        ready[count].samples = 0;
+        count++;
+      }
+      Track(event);
+
+      return count;
+    }
+
+    // Take the pending run if it is due at now.  Returns false if there is
+    // none, or if it has to wait; Wait() then tells how long.
+    bool Flush(uint64_t now, CoalescedEvent &ready)
+    {
+      if (!fHasRun || Wait(now) > 0) {
+        return false;
+      }
+
+      TakeRun(ready, now);
+      return true;
+    }
+
+    // Nanoseconds until the pending run is due, 0 if it is due now or there
+    // is none.
+    uint64_t Wait(uint64_t now) const
+    {
+      if (!fHasRun || now - fDelivered >= fPeriod) {
+        return 0;
+      }
+
+      return fPeriod - (now - fDelivered);
+    }
+
+  private:
+
+    bool Coalesces(const uiohook_event &event) const
+    {
+      switch (event.type) {
+        case EVENT_MOUSE_MOVED:
+        case EVENT_MOUSE_DRAGGED:
+          return fMotion;
+
+        case EVENT_MOUSE_WHEEL:
+          return fWheel;
+
+        default:
+          return false;
+      }
+    }
+
+    bool Continues(const uiohook_event &event) const
+    {
+      const uiohook_event &run = fRun.queued.event;
+      if (event.type != run.type || event.mask != run.mask || !Coalesces(event)) {
+        return false;
+      }
+
+      if (event.type == EVENT_MOUSE_WHEEL) {
+        return event.data.wheel.direction == run.data.wheel.direction
+            && event.data.wheel.type == run.data.wheel.type
+            && event.data.wheel.amount == run.data.wheel.amount;
+      }
+
+      return true;
+    }
+
+    void StartRun(const QueuedEvent &queued, uint64_t dequeued)
+    {
+      // The stage times stay those of the first event, which waited longest.
+      fRun.queued = queued;
+      fRun.dequeued = dequeued;
+      fRun.samples = 1;
+      fHasRun = true;
+
+      if (queued.event.type != EVENT_MOUSE_WHEEL) {
+        fRunX = fHasPosition ? fLastX : queued.event.data.mouse.x;
+        fRunY = fHasPosition ? fLastY : queued.event.data.mouse.y;
+      }
+    }
+
+    void Merge(const uiohook_event &event)
+    {
+      uiohook_event &run = fRun.queued.event;
+      run.time = event.time;
+
+      if (event.type == EVENT_MOUSE_WHEEL) {
+        run.data.wheel.rotation += event.data.wheel.rotation;
+        run.data.wheel.x = event.data.wheel.x;
+        run.data.wheel.y = event.data.wheel.y;
+      } else {
+        run.data.mouse = event.data.mouse;
+      }
+
+      fRun.samples++;
+    }
+
+    void TakeRun(CoalescedEvent &ready, uint64_t now)
+    {
+      ready = fRun;
+
+      const uiohook_event &event = fRun.queued.event;
+      if (event.type == EVENT_MOUSE_WHEEL) {
+        ready.dx = 0;
+        ready.dy = 0;
+      } else {
+        ready.dx = (int32_t) event.data.mouse.x - fRunX;
+        ready.dy = (int32_t) event.data.mouse.y - fRunY;
+      }
+
+      fHasRun = false;
+      fDelivered = now;
+    }
+
+    // Remember where the pointer was last seen, for the distance of a run.
+    void Track(const uiohook_event &event)
+    {
+      switch (event.type) {
+        case EVENT_MOUSE_CLICKED:
+        case EVENT_MOUSE_PRESSED:
+        case EVENT_MOUSE_RELEASED:
+        case EVENT_MOUSE_MOVED:
+        case EVENT_MOUSE_DRAGGED:
+          fLastX = event.data.mouse.x;
+          fLastY = event.data.mouse.y;
+          fHasPosition = true;
+          break;
+
+        case EVENT_MOUSE_WHEEL:
+          fLastX = event.data.wheel.x;
+          fLastY = event.data.wheel.y;
+          fHasPosition = true;
+          break;
+
+        default:
+          break;
+      }
+    }
+
+    bool fMotion;
+    bool fWheel;
+
+    // Shortest time between two delivered runs, in nanoseconds.
+    uint64_t fPeriod;
+
+    uint64_t fDelivered;
+
+    CoalescedEvent fRun;
+    bool fHasRun;
+
+    bool fHasPosition;
+    int32_t fLastX;
+    int32_t fLastY;
+
+    // Pointer position before the first event of the run.
+    int32_t fRunX;
+    int32_t fRunY;
+};
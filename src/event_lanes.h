@@ -0,0 +1,131 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "uiohook.h"
+#include "event_ring.h"
+
+// Skew that lets priority events overtake any number of other events.
+#define PRIORITY_SKEW_UNBOUNDED UINT32_MAX
+
+// The queue between the hook thread and the JS thread, which is a single
+// EventRing unless key and button events get a lane of their own.
+//
+// With the priority lane, the consumer keeps the oldest event of each lane
+// off its ring to compare their times, and serves the priority event first
+// unless it would overtake an event queued more than the skew before it.
+// Each lane keeps its own order, so key events never pass each other.
+class EventLanes
+{
+  public:
+
+    EventLanes(size_t capacity, OverflowPolicy policy, uint32_t blockTimeout,
+        bool priority, uint32_t skew) :
+    fEvents(capacity, policy, blockTimeout),
+    // The priority lane only gets slots if it is used.
+    fPriorityEvents(priority ? capacity : 0, policy, blockTimeout),
+    fPriority(priority),
+    fSkew(skew),
+    fHasPriorityHead(false),
+    fHasOtherHead(false)
+    {
+    }
+
+    // Events that go into the priority lane: discrete input that must not
+    // wait behind a flood of motion.
+    static bool IsPriority(event_type type)
+    {
+      switch (type) {
+        case EVENT_KEY_PRESSED:
+        case EVENT_KEY_RELEASED:
+        case EVENT_KEY_TYPED:
+        case EVENT_MOUSE_PRESSED:
+        case EVENT_MOUSE_RELEASED:
+        case EVENT_MOUSE_CLICKED:
+          return true;
+
+        default:
+          return false;
+      }
+    }
+
+    // Producer side.  Returns false if the event was dropped or coalesced.
+    bool Push(const QueuedEvent &event)
+    {
+      if (fPriority && IsPriority(event.event.type)) {
+        return fPriorityEvents.Push(event);
+      }
+
+      return fEvents.Push(event);
+    }
+
+    // Consumer side.  Returns false if both lanes are empty.
+    bool Pop(QueuedEvent &event)
+    {
+      if (!fPriority) {
+        return fEvents.Pop(event);
+      }
+
+      if (!fHasPriorityHead) {
+        fHasPriorityHead = fPriorityEvents.Pop(fPriorityHead);
+      }
+      if (!fHasOtherHead) {
+        fHasOtherHead = fEvents.Pop(fOtherHead);
+      }
+
+      bool priority = fHasPriorityHead;
+      if (fHasPriorityHead && fHasOtherHead && fSkew != PRIORITY_SKEW_UNBOUNDED
+          && fPriorityHead.queued > fOtherHead.queued) {
+        priority = fPriorityHead.queued - fOtherHead.queued <= fSkew * 1000000ULL;
+      }
+
+      if (priority) {
+        event = fPriorityHead;
+        fHasPriorityHead = false;
+        return true;
+      }
+
+      if (fHasOtherHead) {
+        event = fOtherHead;
+        fHasOtherHead = false;
+        return true;
+      }
+
+      return false;
+    }
+
+    size_t Capacity() const
+    {
+      return fPriority ? fEvents.Capacity() + fPriorityEvents.Capacity() : fEvents.Capacity();
+    }
+
+    // Events of the type lost by either lane, see EventRing.
+    uint64_t Dropped(size_t type) const
+    {
+      return fEvents.Dropped(type) + fPriorityEvents.Dropped(type);
+    }
+
+    uint64_t Coalesced(size_t type) const
+    {
+      return fEvents.Coalesced(type) + fPriorityEvents.Coalesced(type);
+    }
+
+  private:
+
+    EventLanes(const EventLanes &);
+    EventLanes &operator=(const EventLanes &);
+
+    EventRing fEvents;
+    EventRing fPriorityEvents;
+
+    // Read-only after construction.
+    bool fPriority;
+    uint32_t fSkew;
+
+    // Consumer only.
+    QueuedEvent fPriorityHead;
+    QueuedEvent fOtherHead;
+    bool fHasPriorityHead;
+    bool fHasOtherHead;
+};
@@ -0,0 +1,366 @@
+#include "event_object.h"
+
+// Property names, internalized once at module init.
+enum EventName {
+  NAME_TYPE,
+  NAME_MASK,
+  NAME_TIME,
+  NAME_KEYBOARD,
+  NAME_MOUSE,
+  NAME_WHEEL,
+  NAME_SHIFT_KEY,
+  NAME_ALT_KEY,
+  NAME_CTRL_KEY,
+  NAME_META_KEY,
+  NAME_CAPS_LOCK,
+  NAME_NUM_LOCK,
+  NAME_SCROLL_LOCK,
+  NAME_KEYCHAR,
+  NAME_KEYCODE,
+  NAME_RAWCODE,
+  NAME_BUTTON,
+  NAME_CLICKS,
+  NAME_X,
+  NAME_Y,
+  NAME_AMOUNT,
+  NAME_DIRECTION,
+  NAME_ROTATION,
+  NAME_DX,
+  NAME_DY,
+  NAME_SAMPLES,
+  NAME_COUNT
+};
+
+static const char *sNameStrings[NAME_COUNT] = {
+  "type",
+  "mask",
+  "time",
+  "keyboard",
+  "mouse",
+  "wheel",
+  "shiftKey",
+  "altKey",
+  "ctrlKey",
+  "metaKey",
+  "capsLock",
+  "numLock",
+  "scrollLock",
+  "keychar",
+  "keycode",
+  "rawcode",
+  "button",
+  "clicks",
+  "x",
+  "y",
+  "amount",
+  "direction",
+  "rotation",
+  "dx",
+  "dy",
+  "samples"
+};
+
+// Event objects come in six shapes.  Key typed events are the only keyboard
+// events with a keychar, so they get a shape of their own, and so do the
+// motion and wheel events that went through coalescing.
+enum EventKind {
+  KIND_KEY,
+  KIND_KEY_TYPED,
+  KIND_MOUSE,
+  KIND_WHEEL,
+  KIND_MOUSE_COALESCED,
+  KIND_WHEEL_COALESCED,
+  KIND_COUNT
+};
+
+static Nan::Persistent<v8::String> sNames[NAME_COUNT];
+
+// JavaScript event names indexed by event_type.
+static Nan::Persistent<v8::String> sTypeNames[EVENT_MOUSE_WHEEL + 1];
+
+// Template for the raw message and for the event data it carries.
+static Nan::Persistent<v8::ObjectTemplate> sMessageTemplates[KIND_COUNT];
+static Nan::Persistent<v8::ObjectTemplate> sDataTemplates[KIND_COUNT];
+
+// Objects handed out again and again in reuse mode.
+static Nan::Persistent<v8::Object> sReusedMessages[KIND_COUNT];
+static Nan::Persistent<v8::Object> sReusedData[KIND_COUNT];
+
+static inline v8::Local<v8::String> name(EventName id) {
+  return Nan::New(sNames[id]);
+}
+
+static inline void set(v8::Local<v8::Object> obj, EventName id, v8::Local<v8::Value> value) {
+  Nan::Set(obj, name(id), value);
+}
+
+static int eventKind(event_type type) {
+  switch (type) {
+    case EVENT_KEY_PRESSED:
+    case EVENT_KEY_RELEASED:
+      return KIND_KEY;
+
+    case EVENT_KEY_TYPED:
+      return KIND_KEY_TYPED;
+
+    case EVENT_MOUSE_CLICKED:
+    case EVENT_MOUSE_PRESSED:
+    case EVENT_MOUSE_RELEASED:
+    case EVENT_MOUSE_MOVED:
+    case EVENT_MOUSE_DRAGGED:
+      return KIND_MOUSE;
+
+    case EVENT_MOUSE_WHEEL:
+      return KIND_WHEEL;
+
+    default:
+      return -1;
+  }
+}
+
+// Declare the properties of a template in the order they appear on the
+// object.  Every instance then starts out with the same hidden class.
+static v8::Local<v8::ObjectTemplate> newTemplate(const EventName *ids, size_t count) {
+  v8::Local<v8::ObjectTemplate> tpl = Nan::New<v8::ObjectTemplate>();
+  for (size_t i = 0; i < count; i++) {
+    tpl->Set(name(ids[i]), Nan::Undefined());
+  }
+
+  return tpl;
+}
+
+void initEventObjects() {
+  Nan::HandleScope scope;
+
+  for (int i = 0; i < NAME_COUNT; i++) {
+    sNames[i].Reset(Nan::New(sNameStrings[i]).ToLocalChecked());
+  }
+
+  sTypeNames[EVENT_KEY_TYPED].Reset(Nan::New("keypress").ToLocalChecked());
+  sTypeNames[EVENT_KEY_PRESSED].Reset(Nan::New("keydown").ToLocalChecked());
+  sTypeNames[EVENT_KEY_RELEASED].Reset(Nan::New("keyup").ToLocalChecked());
+  sTypeNames[EVENT_MOUSE_CLICKED].Reset(Nan::New("mouseclick").ToLocalChecked());
+  sTypeNames[EVENT_MOUSE_PRESSED].Reset(Nan::New("mousedown").ToLocalChecked());
+  sTypeNames[EVENT_MOUSE_RELEASED].Reset(Nan::New("mouseup").ToLocalChecked());
+  sTypeNames[EVENT_MOUSE_MOVED].Reset(Nan::New("mousemove").ToLocalChecked());
+  sTypeNames[EVENT_MOUSE_DRAGGED].Reset(Nan::New("mousedrag").ToLocalChecked());
+  sTypeNames[EVENT_MOUSE_WHEEL].Reset(Nan::New("mousewheel").ToLocalChecked());
+
+  // The data object carries the JavaScript event name as its type, so the
+  // property exists from the start instead of being added by index.js.
+  // Every kind carries the modifier and lock key state.
+  static const EventName key[] = {
+    NAME_SHIFT_KEY, NAME_ALT_KEY, NAME_CTRL_KEY, NAME_META_KEY,
+    NAME_CAPS_LOCK, NAME_NUM_LOCK, NAME_SCROLL_LOCK,
+    NAME_KEYCODE, NAME_RAWCODE, NAME_TYPE
+  };
+  static const EventName keyTyped[] = {
+    NAME_SHIFT_KEY, NAME_ALT_KEY, NAME_CTRL_KEY, NAME_META_KEY,
+    NAME_CAPS_LOCK, NAME_NUM_LOCK, NAME_SCROLL_LOCK,
+    NAME_KEYCHAR, NAME_KEYCODE, NAME_RAWCODE, NAME_TYPE
+  };
+  static const EventName mouse[] = {
+    NAME_BUTTON, NAME_CLICKS, NAME_X, NAME_Y, NAME_TYPE,
+    NAME_SHIFT_KEY, NAME_ALT_KEY, NAME_CTRL_KEY, NAME_META_KEY,
+    NAME_CAPS_LOCK, NAME_NUM_LOCK, NAME_SCROLL_LOCK
+  };
+  static const EventName wheel[] = {
+    NAME_AMOUNT, NAME_CLICKS, NAME_DIRECTION, NAME_ROTATION, NAME_TYPE,
+    NAME_X, NAME_Y,
+    NAME_SHIFT_KEY, NAME_ALT_KEY, NAME_CTRL_KEY, NAME_META_KEY,
+    NAME_CAPS_LOCK, NAME_NUM_LOCK, NAME_SCROLL_LOCK
+  };
+  static const EventName mouseCoalesced[] = {
+    NAME_BUTTON, NAME_CLICKS, NAME_X, NAME_Y, NAME_TYPE,
+    NAME_SHIFT_KEY, NAME_ALT_KEY, NAME_CTRL_KEY, NAME_META_KEY,
+    NAME_CAPS_LOCK, NAME_NUM_LOCK, NAME_SCROLL_LOCK,
+    NAME_DX, NAME_DY, NAME_SAMPLES
+  };
+  static const EventName wheelCoalesced[] = {
+    NAME_AMOUNT, NAME_CLICKS, NAME_DIRECTION, NAME_ROTATION, NAME_TYPE,
+    NAME_X, NAME_Y,
+    NAME_SHIFT_KEY, NAME_ALT_KEY, NAME_CTRL_KEY, NAME_META_KEY,
+    NAME_CAPS_LOCK, NAME_NUM_LOCK, NAME_SCROLL_LOCK,
+    NAME_SAMPLES
+  };
+
+  sDataTemplates[KIND_KEY].Reset(newTemplate(key, sizeof(key) / sizeof(key[0])));
+  sDataTemplates[KIND_KEY_TYPED].Reset(newTemplate(keyTyped, sizeof(keyTyped) / sizeof(keyTyped[0])));
+  sDataTemplates[KIND_MOUSE].Reset(newTemplate(mouse, sizeof(mouse) / sizeof(mouse[0])));
+  sDataTemplates[KIND_WHEEL].Reset(newTemplate(wheel, sizeof(wheel) / sizeof(wheel[0])));
+  sDataTemplates[KIND_MOUSE_COALESCED].Reset(newTemplate(mouseCoalesced, sizeof(mouseCoalesced) / sizeof(mouseCoalesced[0])));
+  sDataTemplates[KIND_WHEEL_COALESCED].Reset(newTemplate(wheelCoalesced, sizeof(wheelCoalesced) / sizeof(wheelCoalesced[0])));
+
+  static const EventName keyMessage[] = { NAME_TYPE, NAME_MASK, NAME_TIME, NAME_KEYBOARD };
+  static const EventName mouseMessage[] = { NAME_TYPE, NAME_MASK, NAME_TIME, NAME_MOUSE };
+  static const EventName wheelMessage[] = { NAME_TYPE, NAME_MASK, NAME_TIME, NAME_WHEEL };
+
+  sMessageTemplates[KIND_KEY].Reset(newTemplate(keyMessage, 4));
+  sMessageTemplates[KIND_KEY_TYPED].Reset(newTemplate(keyMessage, 4));
+  sMessageTemplates[KIND_MOUSE].Reset(newTemplate(mouseMessage, 4));
+  sMessageTemplates[KIND_WHEEL].Reset(newTemplate(wheelMessage, 4));
+  sMessageTemplates[KIND_MOUSE_COALESCED].Reset(newTemplate(mouseMessage, 4));
+  sMessageTemplates[KIND_WHEEL_COALESCED].Reset(newTemplate(wheelMessage, 4));
+}
+
+// Decode the modifier mask libuiohook keeps for every event.  The mask of a
+// modifier key's own press or release may not include the key yet, or any
+// more, so key events also count the key itself.
+static void fillModifiers(v8::Local<v8::Object> data, const uiohook_event &event) {
+  uint16_t mask = event.mask;
+
+  if (event.type == EVENT_KEY_PRESSED || event.type == EVENT_KEY_RELEASED || event.type == EVENT_KEY_TYPED) {
+    switch (event.data.keyboard.keycode) {
+      case VC_SHIFT_L:   mask |= MASK_SHIFT_L; break;
+      case VC_SHIFT_R:   mask |= MASK_SHIFT_R; break;
+      case VC_CONTROL_L: mask |= MASK_CTRL_L;  break;
+      case VC_CONTROL_R: mask |= MASK_CTRL_R;  break;
+      case VC_ALT_L:     mask |= MASK_ALT_L;   break;
+      case VC_ALT_R:     mask |= MASK_ALT_R;   break;
+      case VC_META_L:    mask |= MASK_META_L;  break;
+      case VC_META_R:    mask |= MASK_META_R;  break;
+    }
+  }
+
+  set(data, NAME_SHIFT_KEY, Nan::New((mask & (MASK_SHIFT)) != 0));
+  set(data, NAME_ALT_KEY, Nan::New((mask & (MASK_ALT)) != 0));
+  set(data, NAME_CTRL_KEY, Nan::New((mask & (MASK_CTRL)) != 0));
+  set(data, NAME_META_KEY, Nan::New((mask & (MASK_META)) != 0));
+  set(data, NAME_CAPS_LOCK, Nan::New((mask & MASK_CAPS_LOCK) != 0));
+  set(data, NAME_NUM_LOCK, Nan::New((mask & MASK_NUM_LOCK) != 0));
+  set(data, NAME_SCROLL_LOCK, Nan::New((mask & MASK_SCROLL_LOCK) != 0));
+}
+
+static void fillData(v8::Local<v8::Object> data, const uiohook_event &event) {
+  set(data, NAME_TYPE, Nan::New(sTypeNames[event.type]));
+  fillModifiers(data, event);
+
+  switch (event.type) {
+    case EVENT_KEY_TYPED:
+      set(data, NAME_KEYCHAR, Nan::New((uint16_t)event.data.keyboard.keychar));
+      // Fall through.
+
+    case EVENT_KEY_PRESSED:
+    case EVENT_KEY_RELEASED:
+      set(data, NAME_KEYCODE, Nan::New((uint16_t)event.data.keyboard.keycode));
+      set(data, NAME_RAWCODE, Nan::New((uint16_t)event.data.keyboard.rawcode));
+      break;
+
+    case EVENT_MOUSE_WHEEL:
+      set(data, NAME_AMOUNT, Nan::New((uint16_t)event.data.wheel.amount));
+      set(data, NAME_CLICKS, Nan::New((uint16_t)event.data.wheel.clicks));
+      set(data, NAME_DIRECTION, Nan::New((int16_t)event.data.wheel.direction));
+      set(data, NAME_ROTATION, Nan::New((int16_t)event.data.wheel.rotation));
+      set(data, NAME_X, Nan::New((int16_t)event.data.wheel.x));
+      set(data, NAME_Y, Nan::New((int16_t)event.data.wheel.y));
+      break;
+
+    default:
+      set(data, NAME_BUTTON, Nan::New((uint16_t)event.data.mouse.button));
+      set(data, NAME_CLICKS, Nan::New((uint16_t)event.data.mouse.clicks));
+      set(data, NAME_X, Nan::New((int16_t)event.data.mouse.x));
+      set(data, NAME_Y, Nan::New((int16_t)event.data.mouse.y));
+      break;
+  }
+}
+
+static void fillMessage(v8::Local<v8::Object> msg, const uiohook_event &event) {
+  set(msg, NAME_TYPE, Nan::New((uint16_t)event.type));
+  set(msg, NAME_MASK, Nan::New((uint16_t)event.mask));
+  set(msg, NAME_TIME, Nan::New((uint16_t)event.time));
+}
+
+static EventName dataName(int kind) {
+  switch (kind) {
+    case KIND_MOUSE:
+    case KIND_MOUSE_COALESCED:
+      return NAME_MOUSE;
+
+    case KIND_WHEEL:
+    case KIND_WHEEL_COALESCED:
+      return NAME_WHEEL;
+
+    default:
+      return NAME_KEYBOARD;
+  }
+}
+
+static v8::Local<v8::Object> newEventObject(int kind, const uiohook_event &event, v8::Local<v8::Object> &data) {
+  data = Nan::NewInstance(Nan::New(sDataTemplates[kind])).ToLocalChecked();
+  fillData(data, event);
+
+  v8::Local<v8::Object> msg = Nan::NewInstance(Nan::New(sMessageTemplates[kind])).ToLocalChecked();
+  fillMessage(msg, event);
+  set(msg, dataName(kind), data);
+
+  return msg;
+}
+
+static v8::Local<v8::Object> reusedEventObject(int kind, const uiohook_event &event, v8::Local<v8::Object> &data) {
+  if (sReusedMessages[kind].IsEmpty()) {
+    data = Nan::NewInstance(Nan::New(sDataTemplates[kind])).ToLocalChecked();
+    v8::Local<v8::Object> msg = Nan::NewInstance(Nan::New(sMessageTemplates[kind])).ToLocalChecked();
+    set(msg, dataName(kind), data);
+
+    sReusedData[kind].Reset(data);
+    sReusedMessages[kind].Reset(msg);
+  }
+
+  data = Nan::New(sReusedData[kind]);
+  fillData(data, event);
+
+  v8::Local<v8::Object> msg = Nan::New(sReusedMessages[kind]);
+  fillMessage(msg, event);
+
+  return msg;
+}
+
+static void fillCoalesced(v8::Local<v8::Object> data, int kind, int32_t dx, int32_t dy, uint32_t samples) {
+  if (kind == KIND_MOUSE_COALESCED) {
+    set(data, NAME_DX, Nan::New(dx));
+    set(data, NAME_DY, Nan::New(dy));
+  }
+  set(data, NAME_SAMPLES, Nan::New(samples));
+}
+
+v8::Local<v8::Object> fillEventObject(const uiohook_event &event) {
+  const int kind = eventKind(event.type);
+  if (kind < 0) {
+    v8::Local<v8::Object> msg = Nan::New<v8::Object>();
+    fillMessage(msg, event);
+    return msg;
+  }
+
+  v8::Local<v8::Object> data;
+  return newEventObject(kind, event, data);
+}
+
+v8::Local<v8::Object> fillReusedEventObject(const uiohook_event &event) {
+  const int kind = eventKind(event.type);
+  if (kind < 0) {
+    return fillEventObject(event);
+  }
+
+  v8::Local<v8::Object> data;
+  return reusedEventObject(kind, event, data);
+}
+
+v8::Local<v8::Object> fillCoalescedEventObject(const uiohook_event &event, int32_t dx, int32_t dy, uint32_t samples) {
+  const int kind = event.type == EVENT_MOUSE_WHEEL ? KIND_WHEEL_COALESCED : KIND_MOUSE_COALESCED;
+
+  v8::Local<v8::Object> data;
+  v8::Local<v8::Object> msg = newEventObject(kind, event, data);
+  fillCoalesced(data, kind, dx, dy, samples);
+
+  return msg;
+}
+
+v8::Local<v8::Object> fillReusedCoalescedEventObject(const uiohook_event &event, int32_t dx, int32_t dy, uint32_t samples) {
+  const int kind = event.type == EVENT_MOUSE_WHEEL ? KIND_WHEEL_COALESCED : KIND_MOUSE_COALESCED;
+
+  v8::Local<v8::Object> data;
+  v8::Local<v8::Object> msg = reusedEventObject(kind, event, data);
+  fillCoalesced(data, kind, dx, dy, samples);
+
+  return msg;
+}
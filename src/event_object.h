@@ -0,0 +1,26 @@
+#pragma once
+
+#include <nan.h>
+
+#include "uiohook.h"
+
+// Create the property names and object templates used for event objects.
+// Must be called once on the JS thread before any event is converted.
+void initEventObjects();
+
+// Build a new event object for JavaScript.
+v8::Local<v8::Object> fillEventObject(const uiohook_event &event);
+
+// Fill the single cached object for the event's kind and return it.  The
+// object is overwritten by the next event of the same kind, so callers must
+// not hold on to it.
+v8::Local<v8::Object> fillReusedEventObject(const uiohook_event &event);
+
+// Build the object for a motion or wheel event that went through coalescing.
+// It also carries the number of events merged into it as samples, and for
+// motion the distance covered as dx and dy.
+v8::Local<v8::Object> fillCoalescedEventObject(const uiohook_event &event, int32_t dx, int32_t dy, uint32_t samples);
+
+// As fillCoalescedEventObject(), but with one cached object per kind like
+// fillReusedEventObject().
+v8::Local<v8::Object> fillReusedCoalescedEventObject(const uiohook_event &event, int32_t dx, int32_t dy, uint32_t samples);
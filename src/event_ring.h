@@ -0,0 +1,257 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+
+#include "uiohook.h"
+
+// Size of a cache line on the platforms we build for.
+#define EVENT_RING_CACHE_LINE 64
+
+// Default and upper bound for the number of slots in the ring.
+#define EVENT_RING_DEFAULT_CAPACITY 4096
+#define EVENT_RING_MAX_CAPACITY (1 << 20)
+
+// Default time OVERFLOW_BLOCK waits for room, in milliseconds.
+#define EVENT_RING_DEFAULT_BLOCK_TIMEOUT 10
+
+// An event as queued by the hook thread, with the monotonic times in
+// nanoseconds at which its input was received and at which it was queued.
+struct QueuedEvent
+{
+  uiohook_event event;
+  uint64_t received;
+  uint64_t queued;
+};
+
+// What the producer does with an event that finds the ring full.
+enum OverflowPolicy
+{
+  OVERFLOW_DROP_NEWEST,     // Drop the event.
+  OVERFLOW_DROP_OLDEST,     // Drop the oldest queued event to make room.
+  OVERFLOW_COALESCE_MOTION, // Make room by dropping motion first, see Push().
+  OVERFLOW_BLOCK            // Wait for room, then drop the event.
+};
+
+// Bounded single-producer/single-consumer ring of uiohook events.
+//
+// The hook thread is the only producer (dispatch_proc) and the libuv thread is
+// the only consumer (HandleProgressCallback).  Both sides are wait-free: the
+// head is only written by the producer, and the tail only by the consumer,
+// except that the policies which drop the oldest event let the producer take
+// it with a compare-and-swap on the tail.  The consumer then also advances
+// the tail by compare-and-swap, and retries when the producer won.  The slots
+// are allocated once, so nothing on the hook thread ever touches the
+// allocator.
+//
+// The producer's and the consumer's indices sit on cache lines of their own,
+// so the ring must be allocated with its alignment.  Before C++17 plain new
+// does not guarantee that; see HookProcessWorker::operator new.
+//
+// Events that did not make it into the ring are counted per event type, as
+// dropped or, for motion under OVERFLOW_COALESCE_MOTION, as coalesced into
+// the motion that followed.
+class alignas(EVENT_RING_CACHE_LINE) EventRing
+{
+  public:
+
+    explicit EventRing(size_t capacity = EVENT_RING_DEFAULT_CAPACITY,
+        OverflowPolicy policy = OVERFLOW_DROP_NEWEST,
+        uint32_t blockTimeout = EVENT_RING_DEFAULT_BLOCK_TIMEOUT) :
+    fHead(0),
+    fTailCache(0),
+    fTail(0),
+    fHeadCache(0),
+    fPolicy(policy),
+    fBlockTimeout(blockTimeout)
+    {
+      const size_t size = RoundCapacity(capacity);
+
+      fMask = size - 1;
+      fSlots = new QueuedEvent[size];
+
+      for (size_t i = 0; i < HOOK_STATS_EVENT_TYPES; i++) {
+        fDropped[i].store(0, std::memory_order_relaxed);
+        fCoalesced[i].store(0, std::memory_order_relaxed);
+      }
+    }
+
+    ~EventRing()
+    {
+      delete[] fSlots;
+    }
+
+    // Producer side.  Returns false if the event was dropped or coalesced.
+    //
+    // Under OVERFLOW_COALESCE_MOTION a full ring makes room by dropping the
+    // oldest event if that is motion, which later motion supersedes, and
+    // otherwise drops the new event if that is motion.  Only when both are
+    // key, button or wheel events is the oldest of them dropped.
+    bool Push(const QueuedEvent &event)
+    {
+      const size_t head = fHead.load(std::memory_order_relaxed);
+      if (head - fTailCache > fMask) {
+        fTailCache = fTail.load(std::memory_order_acquire);
+        if (head - fTailCache > fMask && !MakeRoom(event, head)) {
+          return false;
+        }
+      }
+
+      fSlots[head & fMask] = event;
+      fHead.store(head + 1, std::memory_order_release);
+
+      return true;
+    }
+
+    // Consumer side.  Returns false if the ring is empty.
+    bool Pop(QueuedEvent &event)
+    {
+      size_t tail = fTail.load(std::memory_order_acquire);
+      for (;;) {
+        // The producer may move the tail past the cached head.
+        if ((ptrdiff_t) (fHeadCache - tail) <= 0) {
+          fHeadCache = fHead.load(std::memory_order_acquire);
+          if (tail == fHeadCache) {
+            return false;
+          }
+        }
+
+        event = fSlots[tail & fMask];
+
+        if (!SharedTail()) {
+          fTail.store(tail + 1, std::memory_order_release);
+          return true;
+        }
+
+        // The producer may have taken this slot while it was copied, in
+        // which case the copy is discarded and the next slot is read.
+        if (fTail.compare_exchange_strong(tail, tail + 1, std::memory_order_acq_rel)) {
+          return true;
+        }
+      }
+    }
+
+    // Round up to a power of two so indices can be masked instead of divided.
+    static size_t RoundCapacity(size_t capacity)
+    {
+      size_t size = 2;
+      while (size < capacity && size < EVENT_RING_MAX_CAPACITY) {
+        size <<= 1;
+      }
+
+      return size;
+    }
+
+    size_t Capacity() const
+    {
+      return fMask + 1;
+    }
+
+    // Events of the type discarded to stay within the capacity.
+    uint64_t Dropped(size_t type) const
+    {
+      return fDropped[type].load(std::memory_order_relaxed);
+    }
+
+    // Motion events of the type discarded in favour of later motion.
+    uint64_t Coalesced(size_t type) const
+    {
+      return fCoalesced[type].load(std::memory_order_relaxed);
+    }
+
+  private:
+
+    EventRing(const EventRing &);
+    EventRing &operator=(const EventRing &);
+
+    // Whether the producer may advance the tail too.
+    bool SharedTail() const
+    {
+      return fPolicy == OVERFLOW_DROP_OLDEST || fPolicy == OVERFLOW_COALESCE_MOTION;
+    }
+
+    static bool IsMotion(const uiohook_event &event)
+    {
+      return event.type == EVENT_MOUSE_MOVED || event.type == EVENT_MOUSE_DRAGGED;
+    }
+
+    // Count a discarded event.  Producer only.
+    void Discard(std::atomic<uint64_t> *counters, const uiohook_event &event)
+    {
+      if (event.type < HOOK_STATS_EVENT_TYPES) {
+        counters[event.type].fetch_add(1, std::memory_order_relaxed);
+      }
+    }
+
+    // Apply the overflow policy to the full ring.  Returns true if there is
+    // room for the event now.  Producer only.
+    bool MakeRoom(const QueuedEvent &event, size_t head)
+    {
+      switch (fPolicy) {
+        case OVERFLOW_BLOCK: {
+          // The consumer was signalled when the events ahead were queued.
+          const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(fBlockTimeout);
+          do {
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+
+            fTailCache = fTail.load(std::memory_order_acquire);
+            if (head - fTailCache <= fMask) {
+              return true;
+            }
+          } while (std::chrono::steady_clock::now() < deadline);
+
+          Discard(fDropped, event.event);
+          return false;
+        }
+
+        case OVERFLOW_COALESCE_MOTION:
+        case OVERFLOW_DROP_OLDEST: {
+          size_t tail = fTailCache;
+          const uiohook_event &oldest = fSlots[tail & fMask].event;
+          const bool coalesce = fPolicy == OVERFLOW_COALESCE_MOTION;
+
+          if (coalesce && !IsMotion(oldest) && IsMotion(event.event)) {
+            Discard(fCoalesced, event.event);
+            return false;
+          }
+
+          // The oldest event is only read, not written, until the tail moves
+          // past it, so it is still intact if the exchange succeeds.
+          const uiohook_event discarded = oldest;
+          if (fTail.compare_exchange_strong(tail, tail + 1, std::memory_order_acq_rel)) {
+            Discard(coalesce && IsMotion(discarded) ? fCoalesced : fDropped, discarded);
+            fTailCache = tail + 1;
+          } else {
+            // The consumer took it first, which made room as well.
+            fTailCache = tail;
+          }
+          return true;
+        }
+
+        case OVERFLOW_DROP_NEWEST:
+        default:
+          Discard(fDropped, event.event);
+          return false;
+      }
+    }
+
+    // Producer owned cache lines, including the loss counters, which only
+    // the producer writes and the consumer reads once per drain.
+    alignas(EVENT_RING_CACHE_LINE) std::atomic<size_t> fHead;
+    size_t fTailCache;
+    std::atomic<uint64_t> fDropped[HOOK_STATS_EVENT_TYPES];
+    std::atomic<uint64_t> fCoalesced[HOOK_STATS_EVENT_TYPES];
+
+    // Consumer owned cache line.
+    alignas(EVENT_RING_CACHE_LINE) std::atomic<size_t> fTail;
+    size_t fHeadCache;
+
+    // Read-mostly state shared by both sides.
+    alignas(EVENT_RING_CACHE_LINE) OverflowPolicy fPolicy;
+    uint32_t fBlockTimeout;
+    size_t fMask;
+    QueuedEvent *fSlots;
+};
@@ -1,16 +1,17 @@
 #include "iohook.h"
+#include "event_object.h"
+#include "latency_stats.h"
 #include "uiohook.h"
 
+#include <cstdlib>
+#include <cstring>
+
 #ifdef _WIN32
+#include <malloc.h>
 #include <windows.h>
 #else
-#if defined(__APPLE__) && defined(__MACH__)
-#include <CoreFoundation/CoreFoundation.h>
-#endif
-
 #include <pthread.h>
 #endif
-#include <queue>
 
 using namespace v8;
 using Callback = Nan::Callback;
@@ -19,11 +20,22 @@ static bool sIsDebug = false;
 
 static HookProcessWorker* sIOHook = nullptr;
 
-static std::queue<uiohook_event> zqueue;
+// Kept across hook sessions until resetLatencyStats().  The hook stage is
+// recorded by the hook thread, the others by the JS thread.
+static LatencyHistogram sLatency[LATENCY_STAGES];
 
 // Native thread errors.
 #define UIOHOOK_ERROR_THREAD_CREATE       0x10
 
+// Message type of the overflow report, outside libuiohook's event types.
+#define IOHOOK_EVENT_OVERFLOW             0x100
+
+// Names of the event types, as emitted by index.js.
+static const char *sEventNames[HOOK_STATS_EVENT_TYPES] = {
+  nullptr, "hookenabled", "hookdisabled", "keypress", "keydown", "keyup", "mouseclick",
+  "mousedown", "mouseup", "mousemove", "mousedrag", "mousewheel", "systempropertieschange"
+};
+
 // Thread and mutex variables.
 #ifdef _WIN32
 static HANDLE hook_thread;
@@ -103,11 +115,6 @@ void dispatch_proc(uiohook_event * const event) {
       #ifdef _WIN32
       LeaveCriticalSection(&hook_running_mutex);
       #else
-      #if defined(__APPLE__) && defined(__MACH__)
-      // Stop the main runloop so that this program ends.
-      CFRunLoopStop(CFRunLoopGetMain());
-      #endif
-
       pthread_mutex_unlock(&hook_running_mutex);
       #endif
       break;
@@ -121,11 +128,27 @@ void dispatch_proc(uiohook_event * const event) {
     case EVENT_MOUSE_MOVED:
     case EVENT_MOUSE_DRAGGED:
     case EVENT_MOUSE_WHEEL:
-      uiohook_event event_copy;
-      memcpy(&event_copy, event, sizeof(uiohook_event));
-      zqueue.push(event_copy);
-      sIOHook->fHookExecution->Send(event, sizeof(uiohook_event));
+    case EVENT_SYSTEM_PROPERTIES_CHANGED: {
+      // Both clocks are monotonic.  Where libuiohook does not stamp input,
+      // the hook stage is skipped and the other stages start from here.
+      QueuedEvent queued = { *event, hook_get_input_time(), uv_hrtime() };
+      if (queued.received != 0 && queued.received <= queued.queued) {
+        sLatency[LATENCY_HOOK].Record(queued.queued - queued.received);
+      } else {
+        queued.received = queued.queued;
+      }
+
+      // Copy the event into the ring and wake up the JS thread.  Nothing here
+      // allocates, and uv_async_send() coalesces repeated wakeups.
+      if (sIOHook->fOptions.shared) {
+        if (sIOHook->fSharedRing.Push(*event)) {
+          sIOHook->Signal();
+        }
+      } else if (sIOHook->fEventLanes.Push(queued)) {
+        sIOHook->Signal();
+      }
       break;
+    }
   }
 }
 
@@ -270,9 +293,7 @@ int hook_enable() {
   return status;
 }
 
-void run() {
-  // Lock the thread control mutex.  This will be unlocked when the
-  // thread has finished starting, or when it has fully stopped.
+int run() {
   #ifdef _WIN32
   // Create event handles for the thread hook.
   InitializeCriticalSection(&hook_running_mutex);
@@ -290,23 +311,13 @@ void run() {
   // Set the event callback for uiohook events.
   hook_set_dispatch_proc(&dispatch_proc);
 
-  // Start the hook and block.
+  // Start the hook thread and wait until it is running or has failed.
   // NOTE If EVENT_HOOK_ENABLED was delivered, the status will always succeed.
   int status = hook_enable();
   switch (status) {
     case UIOHOOK_SUCCESS:
-      // We no longer block, so we need to explicitly wait for the thread to die.
-      #ifdef _WIN32
-      WaitForSingleObject(hook_thread,  INFINITE);
-      #else
-      #if defined(__APPLE__) && defined(__MACH__)
-      // NOTE Darwin requires that you start your own runloop from main.
-      CFRunLoopRun();
-      #endif
-
-      pthread_join(hook_thread, NULL);
-      #endif
-      break;
+      // The hook thread keeps running until stop() joins it.
+      return status;
 
     // System level errors.
     case UIOHOOK_ERROR_OUT_OF_MEMORY:
@@ -335,6 +346,10 @@ void run() {
       logger_proc(LOG_LEVEL_ERROR, "Failed to enable XRecord context. (%#X)\n", status);
       break;
 
+    case UIOHOOK_ERROR_X_INPUT2_NOT_FOUND:
+      logger_proc(LOG_LEVEL_ERROR, "Unable to locate XInput 2.1 extension. (%#X)\n", status);
+      break;
+
 
     // Windows specific errors.
     case UIOHOOK_ERROR_SET_WINDOWS_HOOK_EX:
@@ -369,11 +384,26 @@ void run() {
       logger_proc(LOG_LEVEL_ERROR, "An unknown hook error occurred. (%#X)\n", status);
       break;
   }
+
+  // The hook thread has already exited, nothing else uses the locks.
+  #ifdef _WIN32
+  DeleteCriticalSection(&hook_running_mutex);
+  DeleteCriticalSection(&hook_control_mutex);
+  #else
+  pthread_mutex_destroy(&hook_running_mutex);
+  pthread_mutex_destroy(&hook_control_mutex);
+  pthread_cond_destroy(&hook_control_cond);
+  #endif
+
+  return status;
 }
 
-void stop() {
+int stop() {
   int status = hook_stop();
   switch (status) {
+    case UIOHOOK_SUCCESS:
+      break;
+
     // System level errors.
     case UIOHOOK_ERROR_OUT_OF_MEMORY:
       logger_proc(LOG_LEVEL_ERROR, "Failed to allocate memory. (%#X)", status);
@@ -391,117 +421,447 @@ void stop() {
       break;
   }
 
+  // Without a successful hook_stop(), hook_run() was never told to return and
+  // joining would wait forever.  The thread and its locks are left alone.
+  if (status != UIOHOOK_SUCCESS) {
+    return status;
+  }
+
+  // Wait for hook_run() to return before tearing down the locks it uses.
   #ifdef _WIN32
-  // Create event handles for the thread hook.
+  WaitForSingleObject(hook_thread, INFINITE);
   CloseHandle(hook_thread);
   DeleteCriticalSection(&hook_running_mutex);
   DeleteCriticalSection(&hook_control_mutex);
   #else
+  pthread_join(hook_thread, NULL);
   pthread_mutex_destroy(&hook_running_mutex);
   pthread_mutex_destroy(&hook_control_mutex);
   pthread_cond_destroy(&hook_control_cond);
   #endif
+
+  return status;
 }
 
-HookProcessWorker::HookProcessWorker(Nan::Callback * callback) :
-Nan::AsyncProgressWorkerBase<uiohook_event>(callback),
-fHookExecution(nullptr)
+HookProcessWorker::HookProcessWorker(Nan::Callback * callback, const HookOptions &options) :
+fOptions(options),
+fEventLanes(options.queueCapacity, options.overflow, options.overflowTimeout, options.priority, options.prioritySkew),
+fCoalescer(options.coalesceMotion, options.coalesceWheel, options.coalesceRate),
+fCallback(callback),
+fAsyncResource("iohook:HookProcessWorker"),
+fAsync(new uv_async_t),
+fTimer(new uv_timer_t),
+fOpenHandles(2),
+fClosing(false)
 {
+  uv_async_init(Nan::GetCurrentEventLoop(), fAsync, AsyncCallback);
+  fAsync->data = this;
 
+  uv_timer_init(Nan::GetCurrentEventLoop(), fTimer);
+  fTimer->data = this;
+
+  for (size_t i = 0; i < HOOK_STATS_EVENT_TYPES; i++) {
+    fReportedDropped[i] = 0;
+    fReportedCoalesced[i] = 0;
+  }
 }
 
-v8::Local<v8::Object> fillEventObject(uiohook_event event) {
-  v8::Local<v8::Object> obj = Nan::New<v8::Object>();
+void *HookProcessWorker::operator new(size_t size)
+{
+  #ifdef _WIN32
+  void *ptr = _aligned_malloc(size, alignof(HookProcessWorker));
+  #else
+  void *ptr = nullptr;
+  if (posix_memalign(&ptr, alignof(HookProcessWorker), size) != 0) {
+    ptr = nullptr;
+  }
+  #endif
 
-  obj->Set(v8::Isolate::GetCurrent()->GetCurrentContext(), Nan::New("type").ToLocalChecked(), Nan::New((uint16_t)event.type));
-  obj->Set(v8::Isolate::GetCurrent()->GetCurrentContext(), Nan::New("mask").ToLocalChecked(), Nan::New((uint16_t)event.mask));
-  obj->Set(v8::Isolate::GetCurrent()->GetCurrentContext(), Nan::New("time").ToLocalChecked(), Nan::New((uint16_t)event.time));
+  if (ptr == nullptr) {
+    // Same as plain new without exceptions, which addons are built without.
+    abort();
+  }
 
-  if ((event.type >= EVENT_KEY_TYPED) && (event.type <= EVENT_KEY_RELEASED)) {
-    v8::Local<v8::Object> keyboard = Nan::New<v8::Object>();
+  return ptr;
+}
 
-    if (event.data.keyboard.keycode == VC_SHIFT_L || event.data.keyboard.keycode == VC_SHIFT_R) {
-      keyboard->Set(v8::Isolate::GetCurrent()->GetCurrentContext(), Nan::New("shiftKey").ToLocalChecked(), Nan::New(true));
-    } else {
-      keyboard->Set(v8::Isolate::GetCurrent()->GetCurrentContext(), Nan::New("shiftKey").ToLocalChecked(), Nan::New(false));
-    }
+void HookProcessWorker::operator delete(void *ptr)
+{
+  #ifdef _WIN32
+  _aligned_free(ptr);
+  #else
+  free(ptr);
+  #endif
+}
 
-    if (event.data.keyboard.keycode == VC_ALT_L || event.data.keyboard.keycode == VC_ALT_R) {
-      keyboard->Set(v8::Isolate::GetCurrent()->GetCurrentContext(), Nan::New("altKey").ToLocalChecked(), Nan::New(true));
-    } else {
-      keyboard->Set(v8::Isolate::GetCurrent()->GetCurrentContext(), Nan::New("altKey").ToLocalChecked(), Nan::New(false));
-    }
+HookProcessWorker::~HookProcessWorker()
+{
+  delete fAsync;
+  delete fTimer;
+  delete fCallback;
+}
 
-    if (event.data.keyboard.keycode == VC_CONTROL_L || event.data.keyboard.keycode == VC_CONTROL_R) {
-      keyboard->Set(v8::Isolate::GetCurrent()->GetCurrentContext(), Nan::New("ctrlKey").ToLocalChecked(), Nan::New(true));
-    } else {
-      keyboard->Set(v8::Isolate::GetCurrent()->GetCurrentContext(), Nan::New("ctrlKey").ToLocalChecked(), Nan::New(false));
-    }
+int HookProcessWorker::Start()
+{
+  // Picked up by hook_run() on the hook thread.
+  int status = hook_set_backend(fOptions.backend);
+  if (status != UIOHOOK_SUCCESS) {
+    logger_proc(LOG_LEVEL_ERROR, "Hook backend %u is not available. (%#X)\n", fOptions.backend, status);
+    return status;
+  }
 
-    if (event.data.keyboard.keycode == VC_META_L || event.data.keyboard.keycode == VC_META_R) {
-      keyboard->Set(v8::Isolate::GetCurrent()->GetCurrentContext(), Nan::New("metaKey").ToLocalChecked(), Nan::New(true));
-    } else {
-      keyboard->Set(v8::Isolate::GetCurrent()->GetCurrentContext(), Nan::New("metaKey").ToLocalChecked(), Nan::New(false));
+  if (fOptions.backend == HOOK_BACKEND_SYNTHETIC) {
+    fOptions.synthetic.replay_file = fOptions.syntheticReplayFile.empty() ? NULL : fOptions.syntheticReplayFile.c_str();
+    status = hook_set_synthetic_options(&fOptions.synthetic);
+    if (status != UIOHOOK_SUCCESS) {
+      return status;
     }
+  }
 
-    if (event.type == EVENT_KEY_TYPED) {
-      keyboard->Set(v8::Isolate::GetCurrent()->GetCurrentContext(), Nan::New("keychar").ToLocalChecked(), Nan::New((uint16_t)event.data.keyboard.keychar));
-    }
+  return run();
+}
 
-    keyboard->Set(v8::Isolate::GetCurrent()->GetCurrentContext(), Nan::New("keycode").ToLocalChecked(), Nan::New((uint16_t)event.data.keyboard.keycode));
-    keyboard->Set(v8::Isolate::GetCurrent()->GetCurrentContext(), Nan::New("rawcode").ToLocalChecked(), Nan::New((uint16_t)event.data.keyboard.rawcode));
-
-    obj->Set(v8::Isolate::GetCurrent()->GetCurrentContext(), Nan::New("keyboard").ToLocalChecked(), keyboard);
-  } else if ((event.type >= EVENT_MOUSE_CLICKED) && (event.type < EVENT_MOUSE_WHEEL)) {
-    v8::Local<v8::Object> mouse = Nan::New<v8::Object>();
-    mouse->Set(v8::Isolate::GetCurrent()->GetCurrentContext(), Nan::New("button").ToLocalChecked(), Nan::New((uint16_t)event.data.mouse.button));
-    mouse->Set(v8::Isolate::GetCurrent()->GetCurrentContext(), Nan::New("clicks").ToLocalChecked(), Nan::New((uint16_t)event.data.mouse.clicks));
-    mouse->Set(v8::Isolate::GetCurrent()->GetCurrentContext(), Nan::New("x").ToLocalChecked(), Nan::New((int16_t)event.data.mouse.x));
-    mouse->Set(v8::Isolate::GetCurrent()->GetCurrentContext(), Nan::New("y").ToLocalChecked(), Nan::New((int16_t)event.data.mouse.y));
-
-    obj->Set(v8::Isolate::GetCurrent()->GetCurrentContext(), Nan::New("mouse").ToLocalChecked(), mouse);
-  } else if (event.type == EVENT_MOUSE_WHEEL) {
-    v8::Local<v8::Object> wheel = Nan::New<v8::Object>();
-    wheel->Set(v8::Isolate::GetCurrent()->GetCurrentContext(), Nan::New("amount").ToLocalChecked(), Nan::New((uint16_t)event.data.wheel.amount));
-    wheel->Set(v8::Isolate::GetCurrent()->GetCurrentContext(), Nan::New("clicks").ToLocalChecked(), Nan::New((uint16_t)event.data.wheel.clicks));
-    wheel->Set(v8::Isolate::GetCurrent()->GetCurrentContext(), Nan::New("direction").ToLocalChecked(), Nan::New((int16_t)event.data.wheel.direction));
-    wheel->Set(v8::Isolate::GetCurrent()->GetCurrentContext(), Nan::New("rotation").ToLocalChecked(), Nan::New((int16_t)event.data.wheel.rotation));
-    wheel->Set(v8::Isolate::GetCurrent()->GetCurrentContext(), Nan::New("type").ToLocalChecked(), Nan::New((int16_t)event.data.wheel.type));
-    wheel->Set(v8::Isolate::GetCurrent()->GetCurrentContext(), Nan::New("x").ToLocalChecked(), Nan::New((int16_t)event.data.wheel.x));
-    wheel->Set(v8::Isolate::GetCurrent()->GetCurrentContext(), Nan::New("y").ToLocalChecked(), Nan::New((int16_t)event.data.wheel.y));
-
-    obj->Set(v8::Isolate::GetCurrent()->GetCurrentContext(), Nan::New("wheel").ToLocalChecked(), wheel);
+int HookProcessWorker::Stop()
+{
+  // The hook thread may still use the worker if it could not be stopped.
+  int status = stop();
+  if (status == UIOHOOK_SUCCESS) {
+    Close();
   }
-  return obj;
+
+  return status;
 }
 
-void HookProcessWorker::HandleProgressCallback(const uiohook_event * event, size_t size)
+void HookProcessWorker::Close()
 {
-  uiohook_event ev;
-  while (!zqueue.empty()) {
-    ev = zqueue.front();
+  // A listener may unload the hook while HandleProgressCallback() is calling
+  // into JavaScript, which must then stop touching the rings and handles.
+  fClosing = true;
+
+  // The handles can only be freed once libuv is done with them.  Events
+  // still queued at this point are dropped with the worker.
+  uv_close(reinterpret_cast<uv_handle_t *>(fAsync), AsyncClose);
+  uv_close(reinterpret_cast<uv_handle_t *>(fTimer), AsyncClose);
+}
 
-    HandleScope scope(Isolate::GetCurrent());
+void HookProcessWorker::Signal()
+{
+  uv_async_send(fAsync);
+}
+
+void HookProcessWorker::AsyncCallback(uv_async_t *handle)
+{
+  static_cast<HookProcessWorker *>(handle->data)->HandleProgressCallback();
+}
+
+void HookProcessWorker::AsyncClose(uv_handle_t *handle)
+{
+  HookProcessWorker *worker = static_cast<HookProcessWorker *>(handle->data);
+  if (--worker->fOpenHandles == 0) {
+    delete worker;
+  }
+}
+
+void HookProcessWorker::TimerCallback(uv_timer_t *handle)
+{
+  // The held back run is due now, the drain delivers it.
+  static_cast<HookProcessWorker *>(handle->data)->HandleProgressCallback();
+}
+
+v8::Local<v8::SharedArrayBuffer> HookProcessWorker::CreateSharedBuffer()
+{
+  v8::Isolate *isolate = v8::Isolate::GetCurrent();
+  const size_t length = SharedEventRing::ByteLength(fOptions.queueCapacity);
+
+  #if V8_MAJOR_VERSION >= 8
+  fSharedStore = v8::SharedArrayBuffer::NewBackingStore(isolate, length);
+  fSharedRing.Attach(fSharedStore->Data(), fOptions.queueCapacity);
+
+  return v8::SharedArrayBuffer::New(isolate, fSharedStore);
+  #else
+  // Older V8 cannot tell us when JavaScript lets go of externalized memory,
+  // so the ring is deliberately never freed.  It is one allocation per
+  // load() and is sized by queueCapacity.
+  void *data = malloc(length);
+  fSharedRing.Attach(data, fOptions.queueCapacity);
 
-    v8::Local<v8::Object> obj = fillEventObject(ev);
+  return v8::SharedArrayBuffer::New(isolate, data, length, v8::ArrayBufferCreationMode::kExternalized);
+  #endif
+}
 
-    v8::Local<v8::Value> argv[] = { obj };
-    callback->Call(1, argv);
+bool HookProcessWorker::TakeOverflow(v8::Local<v8::Object> &msg)
+{
+  // Most drains lose nothing, so count before creating any objects.
+  uint64_t typeDropped[HOOK_STATS_EVENT_TYPES];
+  uint64_t typeCoalesced[HOOK_STATS_EVENT_TYPES];
+  uint64_t dropped = 0, coalesced = 0;
+
+  for (size_t i = 0; i < HOOK_STATS_EVENT_TYPES; i++) {
+    typeDropped[i] = fEventLanes.Dropped(i) - fReportedDropped[i];
+    typeCoalesced[i] = fEventLanes.Coalesced(i) - fReportedCoalesced[i];
+    dropped += typeDropped[i];
+    coalesced += typeCoalesced[i];
+  }
 
-    zqueue.pop();
+  if (dropped + coalesced == 0) {
+    return false;
   }
+
+  v8::Local<v8::Object> types = Nan::New<v8::Object>();
+  for (size_t i = 0; i < HOOK_STATS_EVENT_TYPES; i++) {
+    fReportedDropped[i] += typeDropped[i];
+    fReportedCoalesced[i] += typeCoalesced[i];
+
+    if (typeDropped[i] + typeCoalesced[i] > 0 && sEventNames[i] != nullptr) {
+      Nan::Set(types, Nan::New(sEventNames[i]).ToLocalChecked(), Nan::New((double) (typeDropped[i] + typeCoalesced[i])));
+    }
+  }
+
+  v8::Local<v8::Object> overflow = Nan::New<v8::Object>();
+  Nan::Set(overflow, Nan::New("dropped").ToLocalChecked(), Nan::New((double) dropped));
+  Nan::Set(overflow, Nan::New("coalesced").ToLocalChecked(), Nan::New((double) coalesced));
+  Nan::Set(overflow, Nan::New("types").ToLocalChecked(), types);
+
+  msg = Nan::New<v8::Object>();
+  Nan::Set(msg, Nan::New("type").ToLocalChecked(), Nan::New(IOHOOK_EVENT_OVERFLOW));
+  Nan::Set(msg, Nan::New("overflow").ToLocalChecked(), overflow);
+
+  return true;
+}
+
+// Record the stages of an event that JavaScript is done with.
+static void record_latency(uint64_t received, uint64_t queued, uint64_t dequeued, uint64_t returned) {
+  sLatency[LATENCY_QUEUE].Record(dequeued - queued);
+  sLatency[LATENCY_HANDLER].Record(returned - dequeued);
+  sLatency[LATENCY_TOTAL].Record(returned - received);
 }
 
-void HookProcessWorker::Execute(const Nan::AsyncProgressWorkerBase<uiohook_event>::ExecutionProgress& progress)
+v8::Local<v8::Object> HookProcessWorker::EventObject(const CoalescedEvent &ready)
 {
-  fHookExecution = &progress;
-  run();
+  const uiohook_event &event = ready.queued.event;
+
+  if (ready.samples > 0) {
+    return fOptions.reuseEventObject && !fOptions.batch
+        ? fillReusedCoalescedEventObject(event, ready.dx, ready.dy, ready.samples)
+        : fillCoalescedEventObject(event, ready.dx, ready.dy, ready.samples);
+  }
+
+  return fOptions.reuseEventObject && !fOptions.batch ? fillReusedEventObject(event) : fillEventObject(event);
 }
 
-void HookProcessWorker::Stop()
+void HookProcessWorker::HandleProgressCallback()
 {
-  stop();
-  sIsRunning = false;
+  QueuedEvent queued;
+  CoalescedEvent ready[2];
+
+  if (fOptions.shared) {
+    // The records are already in shared memory, just ring the doorbell.
+    HandleScope scope(Isolate::GetCurrent());
+    fCallback->Call(0, nullptr, &fAsyncResource);
+    return;
+  }
+
+  if (fOptions.batch) {
+    // Hand everything that is queued to JavaScript in one call, so the
+    // MakeCallback and microtask checkpoint cost is paid once per wakeup.
+    HandleScope scope(Isolate::GetCurrent());
+
+    v8::Local<v8::Array> batch = Nan::New<v8::Array>();
+    uint32_t count = 0;
+    fBatchTimes.clear();
+    while (fEventLanes.Pop(queued)) {
+      const size_t readyCount = fCoalescer.Add(queued, uv_hrtime(), ready);
+      for (size_t i = 0; i < readyCount; i++) {
+        fBatchTimes.push_back({ ready[i].queued.received, ready[i].queued.queued, ready[i].dequeued });
+        Nan::Set(batch, count++, EventObject(ready[i]));
+      }
+    }
+
+    if (fCoalescer.Flush(uv_hrtime(), ready[0])) {
+      fBatchTimes.push_back({ ready[0].queued.received, ready[0].queued.queued, ready[0].dequeued });
+      Nan::Set(batch, count++, EventObject(ready[0]));
+    }
+
+    // Lost events are reported after the events that made it.
+    v8::Local<v8::Object> overflow;
+    if (TakeOverflow(overflow)) {
+      Nan::Set(batch, count++, overflow);
+    }
+
+    if (count > 0) {
+      v8::Local<v8::Value> argv[] = { batch };
+      fCallback->Call(1, argv, &fAsyncResource);
+      if (fClosing) {
+        return;
+      }
+
+      const uint64_t returned = uv_hrtime();
+      for (const BatchTimes &times : fBatchTimes) {
+        record_latency(times.received, times.queued, times.dequeued, returned);
+      }
+    }
+  } else {
+    while (fEventLanes.Pop(queued)) {
+      const size_t readyCount = fCoalescer.Add(queued, uv_hrtime(), ready);
+      for (size_t i = 0; i < readyCount; i++) {
+        HandleScope scope(Isolate::GetCurrent());
+
+        v8::Local<v8::Value> argv[] = { EventObject(ready[i]) };
+        fCallback->Call(1, argv, &fAsyncResource);
+        if (fClosing) {
+          return;
+        }
+
+        record_latency(ready[i].queued.received, ready[i].queued.queued, ready[i].dequeued, uv_hrtime());
+      }
+    }
+
+    HandleScope scope(Isolate::GetCurrent());
+    if (fCoalescer.Flush(uv_hrtime(), ready[0])) {
+      v8::Local<v8::Value> argv[] = { EventObject(ready[0]) };
+      fCallback->Call(1, argv, &fAsyncResource);
+      if (fClosing) {
+        return;
+      }
+
+      record_latency(ready[0].queued.received, ready[0].queued.queued, ready[0].dequeued, uv_hrtime());
+    }
+
+    v8::Local<v8::Object> overflow;
+    if (TakeOverflow(overflow)) {
+      v8::Local<v8::Value> argv[] = { overflow };
+      fCallback->Call(1, argv, &fAsyncResource);
+      if (fClosing) {
+        return;
+      }
+    }
+  }
+
+  // A run held back for the rate is delivered by the timer, unless the next
+  // drain gets to it first.
+  const uint64_t wait = fCoalescer.Wait(uv_hrtime());
+  if (wait > 0 && !uv_is_active(reinterpret_cast<uv_handle_t *>(fTimer))) {
+    uv_timer_start(fTimer, TimerCallback, (wait + 999999) / 1000000, 0);
+  }
+}
+
+static HookOptions parse_options(v8::Local<v8::Object> obj) {
+  HookOptions options;
+
+  v8::Local<v8::Value> capacity = Nan::Get(obj, Nan::New("queueCapacity").ToLocalChecked()).ToLocalChecked();
+  if (capacity->IsNumber()) {
+    options.queueCapacity = Nan::To<uint32_t>(capacity).FromJust();
+  }
+
+  v8::Local<v8::Value> batch = Nan::Get(obj, Nan::New("batch").ToLocalChecked()).ToLocalChecked();
+  options.batch = batch->IsTrue();
+
+  v8::Local<v8::Value> shared = Nan::Get(obj, Nan::New("shared").ToLocalChecked()).ToLocalChecked();
+  options.shared = shared->IsTrue();
+
+  v8::Local<v8::Value> reuse = Nan::Get(obj, Nan::New("reuseEventObject").ToLocalChecked()).ToLocalChecked();
+  options.reuseEventObject = reuse->IsTrue();
+
+  v8::Local<v8::Value> overflow = Nan::Get(obj, Nan::New("overflow").ToLocalChecked()).ToLocalChecked();
+  if (overflow->IsString()) {
+    Nan::Utf8String name(overflow);
+    if (strcmp(*name, "drop-newest") == 0) {
+      options.overflow = OVERFLOW_DROP_NEWEST;
+    } else if (strcmp(*name, "drop-oldest") == 0) {
+      options.overflow = OVERFLOW_DROP_OLDEST;
+    } else if (strcmp(*name, "coalesce-motion") == 0) {
+      options.overflow = OVERFLOW_COALESCE_MOTION;
+    } else if (strcmp(*name, "block") == 0) {
+      options.overflow = OVERFLOW_BLOCK;
+    }
+  }
+
+  v8::Local<v8::Value> overflowTimeout = Nan::Get(obj, Nan::New("overflowTimeout").ToLocalChecked()).ToLocalChecked();
+  if (overflowTimeout->IsNumber()) {
+    options.overflowTimeout = Nan::To<uint32_t>(overflowTimeout).FromJust();
+  }
+
+  // Either true to serve the priority lane first, or { maxSkew }.
+  v8::Local<v8::Value> priority = Nan::Get(obj, Nan::New("priority").ToLocalChecked()).ToLocalChecked();
+  if (priority->IsTrue()) {
+    options.priority = true;
+  } else if (priority->IsObject()) {
+    options.priority = true;
+
+    v8::Local<v8::Value> skew = Nan::Get(priority.As<v8::Object>(), Nan::New("maxSkew").ToLocalChecked()).ToLocalChecked();
+    if (skew->IsNumber()) {
+      options.prioritySkew = Nan::To<uint32_t>(skew).FromJust();
+    }
+  }
+
+  // Either true for motion and wheel, or { motion, wheel, rate }.
+  v8::Local<v8::Value> coalesce = Nan::Get(obj, Nan::New("coalesce").ToLocalChecked()).ToLocalChecked();
+  if (coalesce->IsTrue()) {
+    options.coalesceMotion = true;
+    options.coalesceWheel = true;
+  } else if (coalesce->IsObject()) {
+    v8::Local<v8::Object> source = coalesce.As<v8::Object>();
+
+    options.coalesceMotion = Nan::Get(source, Nan::New("motion").ToLocalChecked()).ToLocalChecked()->IsTrue();
+    options.coalesceWheel = Nan::Get(source, Nan::New("wheel").ToLocalChecked()).ToLocalChecked()->IsTrue();
+
+    v8::Local<v8::Value> rate = Nan::Get(source, Nan::New("rate").ToLocalChecked()).ToLocalChecked();
+    if (rate->IsNumber()) {
+      options.coalesceRate = Nan::To<uint32_t>(rate).FromJust();
+    }
+  }
+
+  v8::Local<v8::Value> backend = Nan::Get(obj, Nan::New("backend").ToLocalChecked()).ToLocalChecked();
+  if (backend->IsString()) {
+    Nan::Utf8String name(backend);
+    if (strcmp(*name, "xrecord") == 0) {
+      options.backend = HOOK_BACKEND_XRECORD;
+    } else if (strcmp(*name, "xinput2") == 0) {
+      options.backend = HOOK_BACKEND_XINPUT2;
+    } else if (strcmp(*name, "xcb-record") == 0) {
+      options.backend = HOOK_BACKEND_XCB_RECORD;
+    } else if (strcmp(*name, "synthetic") == 0) {
+      options.backend = HOOK_BACKEND_SYNTHETIC;
+    }
+  }
+
+  v8::Local<v8::Value> synthetic = Nan::Get(obj, Nan::New("synthetic").ToLocalChecked()).ToLocalChecked();
+  if (synthetic->IsObject()) {
+    v8::Local<v8::Object> source = synthetic.As<v8::Object>();
+
+    v8::Local<v8::Value> motionRate = Nan::Get(source, Nan::New("motionRate").ToLocalChecked()).ToLocalChecked();
+    if (motionRate->IsNumber()) {
+      options.synthetic.motion_rate = Nan::To<uint32_t>(motionRate).FromJust();
+    }
+
+    v8::Local<v8::Value> keyRate = Nan::Get(source, Nan::New("keyRate").ToLocalChecked()).ToLocalChecked();
+    if (keyRate->IsNumber()) {
+      options.synthetic.key_rate = Nan::To<uint32_t>(keyRate).FromJust();
+    }
+
+    v8::Local<v8::Value> keyBurst = Nan::Get(source, Nan::New("keyBurst").ToLocalChecked()).ToLocalChecked();
+    if (keyBurst->IsNumber()) {
+      options.synthetic.key_burst = (uint16_t) Nan::To<uint32_t>(keyBurst).FromJust();
+    }
+
+    v8::Local<v8::Value> wheelRate = Nan::Get(source, Nan::New("wheelRate").ToLocalChecked()).ToLocalChecked();
+    if (wheelRate->IsNumber()) {
+      options.synthetic.wheel_rate = Nan::To<uint32_t>(wheelRate).FromJust();
+    }
+
+    v8::Local<v8::Value> duration = Nan::Get(source, Nan::New("duration").ToLocalChecked()).ToLocalChecked();
+    if (duration->IsNumber()) {
+      options.synthetic.duration = Nan::To<uint32_t>(duration).FromJust();
+    }
+
+    v8::Local<v8::Value> replayFile = Nan::Get(source, Nan::New("replayFile").ToLocalChecked()).ToLocalChecked();
+    if (replayFile->IsString()) {
+      Nan::Utf8String path(replayFile);
+      options.syntheticReplayFile = *path;
+    }
+  }
+
+  return options;
 }
 
 NAN_METHOD(GrabMouseClick) {
@@ -524,19 +884,40 @@ NAN_METHOD(StartHook) {
   {
     if (info.Length() > 0)
     {
-      if (info.Length() == 2) {
+      HookOptions options;
+      if (info.Length() >= 2) {
         if (info[1]->IsTrue()) {
           sIsDebug = true;
         } else {
           sIsDebug = false;
         }
       }
+      if (info.Length() >= 3 && info[2]->IsObject()) {
+        options = parse_options(info[2].As<v8::Object>());
+      }
       if (info[0]->IsFunction())
       {
         Callback* callback = new Callback(info[0].As<Function>());
-        sIOHook = new HookProcessWorker(callback);
-        Nan::AsyncQueueWorker(sIOHook);
-        sIsRunning = true;
+        sIOHook = new HookProcessWorker(callback, options);
+
+        // The ring must exist before the hook thread can write to it.
+        v8::Local<v8::SharedArrayBuffer> buffer;
+        if (options.shared) {
+          buffer = sIOHook->CreateSharedBuffer();
+        }
+
+        int status = sIOHook->Start();
+        if (status == UIOHOOK_SUCCESS) {
+          sIsRunning = true;
+          if (options.shared) {
+            info.GetReturnValue().Set(buffer);
+          }
+        } else {
+          // The status tells index.js that the hook is not loaded.
+          sIOHook->Close();
+          sIOHook = nullptr;
+          info.GetReturnValue().Set(status);
+        }
       }
     }
   }
@@ -546,22 +927,212 @@ NAN_METHOD(StopHook) {
   //allow one single execution
   if ((sIsRunning == true) && (sIOHook != nullptr))
   {
-    sIOHook->Stop();
+    // Stop() joins the hook thread, so dispatch_proc is done with sIOHook.
+    // If it failed the hook is still running, and stays loaded.
+    int status = sIOHook->Stop();
+    if (status == UIOHOOK_SUCCESS) {
+      sIOHook = nullptr;
+      sIsRunning = false;
+    }
+    info.GetReturnValue().Set(status);
+  }
+}
+
+NAN_METHOD(PauseHook) {
+  // The hook stays installed, it just stops seeing input.
+  if ((sIsRunning == true) && (sIOHook != nullptr))
+  {
+    info.GetReturnValue().Set(hook_pause() == UIOHOOK_SUCCESS);
+  }
+}
+
+NAN_METHOD(ResumeHook) {
+  if ((sIsRunning == true) && (sIOHook != nullptr))
+  {
+    info.GetReturnValue().Set(hook_resume() == UIOHOOK_SUCCESS);
+  }
+}
+
+NAN_METHOD(SetEventMask) {
+  // Kept by libuiohook across start and stop, so it may be set at any time.
+  if (info.Length() > 0 && info[0]->IsNumber())
+  {
+    uint32_t mask = Nan::To<uint32_t>(info[0]).FromJust();
+    info.GetReturnValue().Set(hook_set_event_mask(mask) == UIOHOOK_SUCCESS);
+  }
+}
+
+NAN_METHOD(GetSystemProperties) {
+  // Served from libuiohook's cache where the platform has one.
+  system_properties properties;
+  hook_get_system_properties(&properties);
+
+  v8::Local<v8::Object> obj = Nan::New<v8::Object>();
+  Nan::Set(obj, Nan::New("autoRepeatRate").ToLocalChecked(), Nan::New((double) properties.auto_repeat_rate));
+  Nan::Set(obj, Nan::New("autoRepeatDelay").ToLocalChecked(), Nan::New((double) properties.auto_repeat_delay));
+  Nan::Set(obj, Nan::New("pointerAccelerationMultiplier").ToLocalChecked(), Nan::New((double) properties.pointer_acceleration_multiplier));
+  Nan::Set(obj, Nan::New("pointerAccelerationThreshold").ToLocalChecked(), Nan::New((double) properties.pointer_acceleration_threshold));
+  Nan::Set(obj, Nan::New("pointerSensitivity").ToLocalChecked(), Nan::New((double) properties.pointer_sensitivity));
+  Nan::Set(obj, Nan::New("multiClickTime").ToLocalChecked(), Nan::New((double) properties.multi_click_time));
+
+  info.GetReturnValue().Set(obj);
+}
+
+static v8::Local<v8::Object> latency_object(const LatencyHistogram &histogram) {
+  const uint64_t count = histogram.Count();
+
+  // Nanoseconds, as doubles since JavaScript numbers are.
+  v8::Local<v8::Object> obj = Nan::New<v8::Object>();
+  Nan::Set(obj, Nan::New("count").ToLocalChecked(), Nan::New((double) count));
+  Nan::Set(obj, Nan::New("min").ToLocalChecked(), Nan::New((double) histogram.Min()));
+  Nan::Set(obj, Nan::New("max").ToLocalChecked(), Nan::New((double) histogram.Max()));
+  Nan::Set(obj, Nan::New("mean").ToLocalChecked(), Nan::New(count > 0 ? (double) histogram.Sum() / count : 0.0));
+  Nan::Set(obj, Nan::New("p50").ToLocalChecked(), Nan::New((double) histogram.ValueAtQuantile(0.5)));
+  Nan::Set(obj, Nan::New("p90").ToLocalChecked(), Nan::New((double) histogram.ValueAtQuantile(0.9)));
+  Nan::Set(obj, Nan::New("p99").ToLocalChecked(), Nan::New((double) histogram.ValueAtQuantile(0.99)));
+  Nan::Set(obj, Nan::New("p999").ToLocalChecked(), Nan::New((double) histogram.ValueAtQuantile(0.999)));
+
+  return obj;
+}
+
+NAN_METHOD(GetLatencyStats) {
+  v8::Local<v8::Object> obj = Nan::New<v8::Object>();
+  Nan::Set(obj, Nan::New("hook").ToLocalChecked(), latency_object(sLatency[LATENCY_HOOK]));
+  Nan::Set(obj, Nan::New("queue").ToLocalChecked(), latency_object(sLatency[LATENCY_QUEUE]));
+  Nan::Set(obj, Nan::New("handler").ToLocalChecked(), latency_object(sLatency[LATENCY_HANDLER]));
+  Nan::Set(obj, Nan::New("total").ToLocalChecked(), latency_object(sLatency[LATENCY_TOTAL]));
+
+  info.GetReturnValue().Set(obj);
+}
+
+NAN_METHOD(ResetLatencyStats) {
+  for (size_t i = 0; i < LATENCY_STAGES; i++) {
+    sLatency[i].Reset();
+  }
+}
+
+NAN_METHOD(GetStats) {
+  hook_stats stats;
+  hook_get_stats(&stats);
+
+  // Indexed by X core event type.
+  static const char *input_names[HOOK_STATS_INPUT_TYPES] = {
+    nullptr, nullptr, "keyPress", "keyRelease", "buttonPress", "buttonRelease", "motion"
+  };
+
+  v8::Local<v8::Object> received = Nan::New<v8::Object>();
+  for (size_t i = 0; i < HOOK_STATS_INPUT_TYPES; i++) {
+    if (input_names[i] != nullptr) {
+      Nan::Set(received, Nan::New(input_names[i]).ToLocalChecked(), Nan::New((double) stats.received[i]));
+    }
+  }
+
+  v8::Local<v8::Object> dispatched = Nan::New<v8::Object>();
+  for (size_t i = 0; i < HOOK_STATS_EVENT_TYPES; i++) {
+    if (sEventNames[i] != nullptr) {
+      Nan::Set(dispatched, Nan::New(sEventNames[i]).ToLocalChecked(), Nan::New((double) stats.dispatched[i]));
+    }
+  }
+
+  // Counters of the queue to JavaScript, for the current session.
+  double capacity = 0, dropped = 0, coalesced = 0;
+  if (sIOHook != nullptr) {
+    capacity = (double) sIOHook->fEventLanes.Capacity();
+    for (size_t i = 0; i < HOOK_STATS_EVENT_TYPES; i++) {
+      dropped += (double) sIOHook->fEventLanes.Dropped(i);
+      coalesced += (double) sIOHook->fEventLanes.Coalesced(i);
+    }
   }
+
+  v8::Local<v8::Object> queue = Nan::New<v8::Object>();
+  Nan::Set(queue, Nan::New("capacity").ToLocalChecked(), Nan::New(capacity));
+  Nan::Set(queue, Nan::New("dropped").ToLocalChecked(), Nan::New(dropped));
+  Nan::Set(queue, Nan::New("coalesced").ToLocalChecked(), Nan::New(coalesced));
+
+  v8::Local<v8::Object> obj = Nan::New<v8::Object>();
+  Nan::Set(obj, Nan::New("received").ToLocalChecked(), received);
+  Nan::Set(obj, Nan::New("dispatched").ToLocalChecked(), dispatched);
+  Nan::Set(obj, Nan::New("consumed").ToLocalChecked(), Nan::New((double) stats.consumed));
+  Nan::Set(obj, Nan::New("replies").ToLocalChecked(), Nan::New((double) stats.replies));
+  Nan::Set(obj, Nan::New("bytes").ToLocalChecked(), Nan::New((double) stats.bytes));
+  Nan::Set(obj, Nan::New("dispatchTime").ToLocalChecked(), Nan::New((double) stats.dispatch_time));
+  Nan::Set(obj, Nan::New("queue").ToLocalChecked(), queue);
+
+  info.GetReturnValue().Set(obj);
+}
+
+// Describe the shared ring layout to JavaScript, in Int32Array indices.
+static v8::Local<v8::Object> shared_ring_layout() {
+  v8::Local<v8::Object> layout = Nan::New<v8::Object>();
+  Nan::Set(layout, Nan::New("headerBytes").ToLocalChecked(), Nan::New(SHARED_RING_HEADER_BYTES));
+  Nan::Set(layout, Nan::New("recordBytes").ToLocalChecked(), Nan::New(SHARED_RING_RECORD_BYTES));
+  Nan::Set(layout, Nan::New("head").ToLocalChecked(), Nan::New(SHARED_RING_HEAD));
+  Nan::Set(layout, Nan::New("tail").ToLocalChecked(), Nan::New(SHARED_RING_TAIL));
+  Nan::Set(layout, Nan::New("dropped").ToLocalChecked(), Nan::New(SHARED_RING_DROPPED));
+  Nan::Set(layout, Nan::New("capacity").ToLocalChecked(), Nan::New(SHARED_RING_CAPACITY));
+  Nan::Set(layout, Nan::New("recordInts").ToLocalChecked(), Nan::New(SHARED_RING_RECORD_INTS_AT));
+
+  v8::Local<v8::Object> fields = Nan::New<v8::Object>();
+  Nan::Set(fields, Nan::New("type").ToLocalChecked(), Nan::New(SHARED_RECORD_TYPE));
+  Nan::Set(fields, Nan::New("mask").ToLocalChecked(), Nan::New(SHARED_RECORD_MASK));
+  Nan::Set(fields, Nan::New("timeLow").ToLocalChecked(), Nan::New(SHARED_RECORD_TIME_LOW));
+  Nan::Set(fields, Nan::New("timeHigh").ToLocalChecked(), Nan::New(SHARED_RECORD_TIME_HIGH));
+  Nan::Set(fields, Nan::New("keycode").ToLocalChecked(), Nan::New(SHARED_RECORD_KEYCODE));
+  Nan::Set(fields, Nan::New("rawcode").ToLocalChecked(), Nan::New(SHARED_RECORD_RAWCODE));
+  Nan::Set(fields, Nan::New("keychar").ToLocalChecked(), Nan::New(SHARED_RECORD_KEYCHAR));
+  Nan::Set(fields, Nan::New("button").ToLocalChecked(), Nan::New(SHARED_RECORD_BUTTON));
+  Nan::Set(fields, Nan::New("clicks").ToLocalChecked(), Nan::New(SHARED_RECORD_CLICKS));
+  Nan::Set(fields, Nan::New("x").ToLocalChecked(), Nan::New(SHARED_RECORD_X));
+  Nan::Set(fields, Nan::New("y").ToLocalChecked(), Nan::New(SHARED_RECORD_Y));
+  Nan::Set(fields, Nan::New("wheelClicks").ToLocalChecked(), Nan::New(SHARED_RECORD_WHEEL_CLICKS));
+  Nan::Set(fields, Nan::New("wheelX").ToLocalChecked(), Nan::New(SHARED_RECORD_WHEEL_X));
+  Nan::Set(fields, Nan::New("wheelY").ToLocalChecked(), Nan::New(SHARED_RECORD_WHEEL_Y));
+  Nan::Set(fields, Nan::New("wheelType").ToLocalChecked(), Nan::New(SHARED_RECORD_WHEEL_TYPE));
+  Nan::Set(fields, Nan::New("amount").ToLocalChecked(), Nan::New(SHARED_RECORD_AMOUNT));
+  Nan::Set(fields, Nan::New("rotation").ToLocalChecked(), Nan::New(SHARED_RECORD_ROTATION));
+  Nan::Set(fields, Nan::New("direction").ToLocalChecked(), Nan::New(SHARED_RECORD_DIRECTION));
+  Nan::Set(layout, Nan::New("fields").ToLocalChecked(), fields);
+
+  return layout;
 }
 
 NAN_MODULE_INIT(Init) {
+  initEventObjects();
+
   Nan::Set(target, Nan::New<String>("startHook").ToLocalChecked(),
   Nan::GetFunction(Nan::New<FunctionTemplate>(StartHook)).ToLocalChecked());
 
   Nan::Set(target, Nan::New<String>("stopHook").ToLocalChecked(),
   Nan::GetFunction(Nan::New<FunctionTemplate>(StopHook)).ToLocalChecked());
 
+  Nan::Set(target, Nan::New<String>("pauseHook").ToLocalChecked(),
+  Nan::GetFunction(Nan::New<FunctionTemplate>(PauseHook)).ToLocalChecked());
+
+  Nan::Set(target, Nan::New<String>("resumeHook").ToLocalChecked(),
+  Nan::GetFunction(Nan::New<FunctionTemplate>(ResumeHook)).ToLocalChecked());
+
+  Nan::Set(target, Nan::New<String>("setEventMask").ToLocalChecked(),
+  Nan::GetFunction(Nan::New<FunctionTemplate>(SetEventMask)).ToLocalChecked());
+
+  Nan::Set(target, Nan::New<String>("getSystemProperties").ToLocalChecked(),
+  Nan::GetFunction(Nan::New<FunctionTemplate>(GetSystemProperties)).ToLocalChecked());
+
+  Nan::Set(target, Nan::New<String>("getLatencyStats").ToLocalChecked(),
+  Nan::GetFunction(Nan::New<FunctionTemplate>(GetLatencyStats)).ToLocalChecked());
+
+  Nan::Set(target, Nan::New<String>("resetLatencyStats").ToLocalChecked(),
+  Nan::GetFunction(Nan::New<FunctionTemplate>(ResetLatencyStats)).ToLocalChecked());
+
+  Nan::Set(target, Nan::New<String>("getStats").ToLocalChecked(),
+  Nan::GetFunction(Nan::New<FunctionTemplate>(GetStats)).ToLocalChecked());
+
   Nan::Set(target, Nan::New<String>("debugEnable").ToLocalChecked(),
   Nan::GetFunction(Nan::New<FunctionTemplate>(DebugEnable)).ToLocalChecked());
 
   Nan::Set(target, Nan::New<String>("grabMouseClick").ToLocalChecked(),
   Nan::GetFunction(Nan::New<FunctionTemplate>(GrabMouseClick)).ToLocalChecked());
+
+  Nan::Set(target, Nan::New<String>("sharedRingLayout").ToLocalChecked(), shared_ring_layout());
 }
 
 NODE_MODULE(nodeHook, Init)
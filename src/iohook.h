@@ -4,21 +4,180 @@
 
 #include <nan_object_wrap.h>
 
+#include <string>
+#include <vector>
+
 #include "uiohook.h"
+#include "event_coalescer.h"
+#include "event_lanes.h"
+#include "event_ring.h"
+#include "shared_ring.h"
 
-class HookProcessWorker : public Nan::AsyncProgressWorkerBase<uiohook_event>
+// Options passed from IOHook.start() to the native hook.
+struct HookOptions
+{
+  // Number of events buffered between the hook thread and JavaScript.
+  size_t queueCapacity;
+
+  // Deliver every event drained on one wakeup in a single array.
+  bool batch;
+
+  // Write binary records into a SharedArrayBuffer instead of queueing events.
+  bool shared;
+
+  // Hand out one cached object per event kind instead of a new one per event.
+  // Ignored in batch mode, where every event of a batch needs its own object.
+  bool reuseEventObject;
+
+  // What happens to events that find the queue full, and how long
+  // OVERFLOW_BLOCK holds up the hook thread for room, in milliseconds.
+  OverflowPolicy overflow;
+
+  uint32_t overflowTimeout;
+
+  // Queue key and button events in a lane of their own, which the JS thread
+  // serves before the other events.  A priority event only overtakes events
+  // queued up to prioritySkew milliseconds before it.
+  bool priority;
+
+  uint32_t prioritySkew;
+
+  // Merge runs of motion and of wheel events into one event each, and
+  // deliver runs at most coalesceRate times a second, 0 for no limit.
+  bool coalesceMotion;
+
+  bool coalesceWheel;
+
+  uint32_t coalesceRate;
+
+  // How the hook receives input, see hook_set_backend().
+  hook_backend backend;
+
+  // Events generated by HOOK_BACKEND_SYNTHETIC.  synthetic.replay_file is set
+  // from syntheticReplayFile when the hook starts.
+  synthetic_options synthetic;
+
+  std::string syntheticReplayFile;
+
+  HookOptions() :
+  queueCapacity(EVENT_RING_DEFAULT_CAPACITY),
+  batch(false),
+  shared(false),
+  reuseEventObject(false),
+  overflow(OVERFLOW_DROP_NEWEST),
+  overflowTimeout(EVENT_RING_DEFAULT_BLOCK_TIMEOUT),
+  priority(false),
+  prioritySkew(PRIORITY_SKEW_UNBOUNDED),
+  coalesceMotion(false),
+  coalesceWheel(false),
+  coalesceRate(0),
+  backend(HOOK_BACKEND_DEFAULT),
+  synthetic()
+  {
+    synthetic.key_burst = 1;
+  }
+};
+
+// Owns the native side of one hook session.
+//
+// Thread topology: the hook runs on exactly one native thread, created by
+// hook_enable() and running hook_run() until hook_stop().  It copies events
+// into a ring and rings fAsync, a uv_async_t on the JS thread's loop, which
+// then drains the ring and calls into JavaScript.  Coalesced runs that are
+// held back for coalesceRate are delivered by fTimer on the JS thread.
+// Nothing runs on the libuv threadpool.
+class HookProcessWorker
 {
   public:
-  
-    typedef Nan::AsyncProgressWorkerBase<uiohook_event>::ExecutionProgress HookExecution;
-  
-    HookProcessWorker(Nan::Callback * callback);
-  
-    void Execute(const ExecutionProgress& progress);
-  
-    void HandleProgressCallback(const uiohook_event *event, size_t size);
-  
-    void Stop();
-  
-    const HookExecution* fHookExecution;
-};
\ No newline at end of file
+
+    HookProcessWorker(Nan::Callback * callback, const HookOptions &options);
+
+    ~HookProcessWorker();
+
+    // The rings are cache line aligned, which plain new only honours from
+    // C++17 on.
+    static void *operator new(size_t size);
+
+    static void operator delete(void *ptr);
+
+    // Start the hook thread and wait until it is running.  JS thread only.
+    int Start();
+
+    // Stop and join the hook thread, then Close().  Returns the status of
+    // hook_stop(); on failure the thread is still running and the worker is
+    // left open.  JS thread only.
+    int Stop();
+
+    // Release the worker once libuv has closed the doorbell.  JS thread only.
+    void Close();
+
+    // Wake the JS thread.  Safe to call from any thread.
+    void Signal();
+
+    // Allocate the SharedArrayBuffer backing fSharedRing.  JS thread only.
+    v8::Local<v8::SharedArrayBuffer> CreateSharedBuffer();
+
+    HookOptions fOptions;
+
+    // Every event, in one or with fOptions.priority two lanes.
+    EventLanes fEventLanes;
+
+    SharedEventRing fSharedRing;
+
+  private:
+
+    HookProcessWorker(const HookProcessWorker &);
+    HookProcessWorker &operator=(const HookProcessWorker &);
+
+    static void AsyncCallback(uv_async_t *handle);
+
+    static void AsyncClose(uv_handle_t *handle);
+
+    static void TimerCallback(uv_timer_t *handle);
+
+    void HandleProgressCallback();
+
+    // The JavaScript message for an event taken off the ring.
+    v8::Local<v8::Object> EventObject(const CoalescedEvent &ready);
+
+    // Describe the events lost since the last call as an overflow message,
+    // or return false if there were none.  JS thread only.
+    bool TakeOverflow(v8::Local<v8::Object> &msg);
+
+    // Stage times of the events in the batch being delivered.
+    struct BatchTimes
+    {
+      uint64_t received;
+      uint64_t queued;
+      uint64_t dequeued;
+    };
+
+    std::vector<BatchTimes> fBatchTimes;
+
+    EventCoalescer fCoalescer;
+
+    // Ring counters as of the last overflow message.
+    uint64_t fReportedDropped[HOOK_STATS_EVENT_TYPES];
+
+    uint64_t fReportedCoalesced[HOOK_STATS_EVENT_TYPES];
+
+    Nan::Callback *fCallback;
+
+    Nan::AsyncResource fAsyncResource;
+
+    uv_async_t *fAsync;
+
+    uv_timer_t *fTimer;
+
+    // Handles libuv has yet to close before the worker can be freed.
+    int fOpenHandles;
+
+    // Set by Close().  The worker stays allocated until libuv has closed the
+    // handles, but must not use them or the rings any more.
+    bool fClosing;
+
+    #if V8_MAJOR_VERSION >= 8
+    // Keeps the shared memory alive for as long as the hook writes to it.
+    std::shared_ptr<v8::BackingStore> fSharedStore;
+    #endif
+};
@@ -0,0 +1,162 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Every power of two is split into 2^LATENCY_SUB_BUCKET_BITS linear buckets,
+// so a recorded value is known to within 12.5%.
+#define LATENCY_SUB_BUCKET_BITS 3
+#define LATENCY_SUB_BUCKETS (1 << LATENCY_SUB_BUCKET_BITS)
+#define LATENCY_BUCKETS ((64 - LATENCY_SUB_BUCKET_BITS + 1) * LATENCY_SUB_BUCKETS)
+
+// Stages an event goes through, each timed from the end of the previous one.
+enum LatencyStage
+{
+  LATENCY_HOOK,     // Input received by libuiohook until queued by dispatch_proc.
+  LATENCY_QUEUE,    // Queued until taken off the ring on the JS thread.
+  LATENCY_HANDLER,  // Taken off the ring until the JS callback returned.
+  LATENCY_TOTAL,    // Input received until the JS callback returned.
+  LATENCY_STAGES
+};
+
+// Log-linear histogram of durations in nanoseconds, after HdrHistogram.
+//
+// Recording is a handful of relaxed atomic increments with no allocation and
+// no lock, so the hook thread can record while the JS thread reads.  Each
+// histogram has a single writer; Reset() from another thread may lose an
+// event that is being recorded at the same time, but never corrupts the
+// histogram.
+class LatencyHistogram
+{
+  public:
+
+    LatencyHistogram()
+    {
+      Reset();
+    }
+
+    void Record(uint64_t value)
+    {
+      fBuckets[BucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+      fSum.fetch_add(value, std::memory_order_relaxed);
+
+      // Only the writer raises the maximum or lowers the minimum.
+      if (value > fMax.load(std::memory_order_relaxed)) {
+        fMax.store(value, std::memory_order_relaxed);
+      }
+      if (value < fMin.load(std::memory_order_relaxed)) {
+        fMin.store(value, std::memory_order_relaxed);
+      }
+    }
+
+    void Reset()
+    {
+      for (size_t i = 0; i < LATENCY_BUCKETS; i++) {
+        fBuckets[i].store(0, std::memory_order_relaxed);
+      }
+      fSum.store(0, std::memory_order_relaxed);
+      fMax.store(0, std::memory_order_relaxed);
+      fMin.store(UINT64_MAX, std::memory_order_relaxed);
+    }
+
+    uint64_t Count() const
+    {
+      uint64_t count = 0;
+      for (size_t i = 0; i < LATENCY_BUCKETS; i++) {
+        count += fBuckets[i].load(std::memory_order_relaxed);
+      }
+
+      return count;
+    }
+
+    uint64_t Sum() const
+    {
+      return fSum.load(std::memory_order_relaxed);
+    }
+
+    // 0 if nothing was recorded.
+    uint64_t Min() const
+    {
+      const uint64_t min = fMin.load(std::memory_order_relaxed);
+      return min == UINT64_MAX ? 0 : min;
+    }
+
+    uint64_t Max() const
+    {
+      return fMax.load(std::memory_order_relaxed);
+    }
+
+    // The value below which the given fraction of the recorded values fall,
+    // rounded up to the end of its bucket and capped at the maximum.
+    uint64_t ValueAtQuantile(double quantile) const
+    {
+      const uint64_t count = Count();
+      if (count == 0) {
+        return 0;
+      }
+
+      uint64_t rank = (uint64_t) (quantile * count + 0.5);
+      if (rank < 1) {
+        rank = 1;
+      }
+
+      uint64_t seen = 0;
+      for (size_t i = 0; i < LATENCY_BUCKETS; i++) {
+        seen += fBuckets[i].load(std::memory_order_relaxed);
+        if (seen >= rank) {
+          const uint64_t highest = BucketHighest(i);
+          const uint64_t max = Max();
+          return highest < max ? highest : max;
+        }
+      }
+
+      return Max();
+    }
+
+    // Values below LATENCY_SUB_BUCKETS get a bucket each, larger ones are
+    // bucketed by their highest set bit and the bits just below it.
+    static size_t BucketIndex(uint64_t value)
+    {
+      if (value < LATENCY_SUB_BUCKETS) {
+        return (size_t) value;
+      }
+
+      unsigned int msb = 0;
+      #if defined(__GNUC__)
+      msb = 63 - __builtin_clzll(value);
+      #else
+      for (uint64_t rest = value >> 1; rest != 0; rest >>= 1) {
+        msb++;
+      }
+      #endif
+
+      const unsigned int shift = msb - LATENCY_SUB_BUCKET_BITS;
+      const size_t sub = (size_t) (value >> shift) & (LATENCY_SUB_BUCKETS - 1);
+
+      return (shift + 1) * LATENCY_SUB_BUCKETS + sub;
+    }
+
+    // Largest value that lands in the bucket.
+    static uint64_t BucketHighest(size_t index)
+    {
+      if (index < LATENCY_SUB_BUCKETS) {
+        return index;
+      }
+
+      const unsigned int shift = (unsigned int) (index / LATENCY_SUB_BUCKETS) - 1;
+      const uint64_t lowest = (uint64_t) (LATENCY_SUB_BUCKETS + index % LATENCY_SUB_BUCKETS) << shift;
+
+      return lowest + (((uint64_t) 1 << shift) - 1);
+    }
+
+  private:
+
+    LatencyHistogram(const LatencyHistogram &);
+    LatencyHistogram &operator=(const LatencyHistogram &);
+
+    std::atomic<uint64_t> fBuckets[LATENCY_BUCKETS];
+    std::atomic<uint64_t> fSum;
+    std::atomic<uint64_t> fMax;
+    std::atomic<uint64_t> fMin;
+};
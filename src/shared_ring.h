@@ -0,0 +1,176 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "uiohook.h"
+#include "event_ring.h"
+
+// The shared ring lives in a SharedArrayBuffer laid out as a header followed
+// by fixed-size records.  All offsets are in int32 units so JavaScript can
+// address everything through one Int32Array.
+//
+// Header: one cache line per writer plus a read-only line.
+#define SHARED_RING_HEADER_BYTES    (3 * EVENT_RING_CACHE_LINE)
+#define SHARED_RING_HEAD            0   // written by the hook thread
+#define SHARED_RING_DROPPED         1   // written by the hook thread
+#define SHARED_RING_TAIL            (EVENT_RING_CACHE_LINE / 4)   // written by JS
+#define SHARED_RING_CAPACITY        (2 * EVENT_RING_CACHE_LINE / 4)
+#define SHARED_RING_RECORD_INTS_AT  (SHARED_RING_CAPACITY + 1)
+
+// Records: one cache line each.
+#define SHARED_RING_RECORD_BYTES    EVENT_RING_CACHE_LINE
+#define SHARED_RING_RECORD_INTS     (SHARED_RING_RECORD_BYTES / 4)
+
+// Record fields common to every event.
+#define SHARED_RECORD_TYPE          0
+#define SHARED_RECORD_MASK          1
+#define SHARED_RECORD_TIME_LOW      2
+#define SHARED_RECORD_TIME_HIGH     3
+
+// Keyboard events.
+#define SHARED_RECORD_KEYCODE       4
+#define SHARED_RECORD_RAWCODE       5
+#define SHARED_RECORD_KEYCHAR       6
+
+// Mouse events.
+#define SHARED_RECORD_BUTTON        4
+#define SHARED_RECORD_CLICKS        5
+#define SHARED_RECORD_X             6
+#define SHARED_RECORD_Y             7
+
+// Wheel events.
+#define SHARED_RECORD_WHEEL_CLICKS  4
+#define SHARED_RECORD_WHEEL_X       5
+#define SHARED_RECORD_WHEEL_Y       6
+#define SHARED_RECORD_WHEEL_TYPE    7
+#define SHARED_RECORD_AMOUNT        8
+#define SHARED_RECORD_ROTATION      9
+#define SHARED_RECORD_DIRECTION     10
+
+static_assert(sizeof(std::atomic<uint32_t>) == sizeof(int32_t),
+    "shared ring indices must have the same layout as an Int32Array element");
+
+// Single-producer/single-consumer ring of binary event records in memory that
+// is shared with JavaScript.
+//
+// The hook thread is the producer and JavaScript is the consumer, reading the
+// records through typed-array views and publishing its progress with
+// Atomics.store() on the tail index.  Head and tail are free running 32-bit
+// counters, so they wrap the same way on both sides.  The memory itself is
+// owned by the SharedArrayBuffer; this class only formats it and writes to it.
+class SharedEventRing
+{
+  public:
+
+    SharedEventRing() :
+    fHeader(nullptr),
+    fRecords(nullptr),
+    fMask(0),
+    fTailCache(0)
+    {
+
+    }
+
+    // Number of bytes needed for a ring of at least the given capacity.
+    static size_t ByteLength(size_t capacity)
+    {
+      return SHARED_RING_HEADER_BYTES +
+          EventRing::RoundCapacity(capacity) * SHARED_RING_RECORD_BYTES;
+    }
+
+    // Format a buffer of ByteLength(capacity) bytes and start writing to it.
+    void Attach(void *data, size_t capacity)
+    {
+      const size_t size = EventRing::RoundCapacity(capacity);
+
+      memset(data, 0, ByteLength(capacity));
+
+      fHeader = static_cast<int32_t *>(data);
+      fRecords = fHeader + SHARED_RING_HEADER_BYTES / 4;
+      fMask = (uint32_t) size - 1;
+      fTailCache = 0;
+
+      fHeader[SHARED_RING_CAPACITY] = (int32_t) size;
+      fHeader[SHARED_RING_RECORD_INTS_AT] = SHARED_RING_RECORD_INTS;
+    }
+
+    bool IsAttached() const
+    {
+      return fHeader != nullptr;
+    }
+
+    // Producer side.  Returns false and counts a drop if the ring is full.
+    bool Push(const uiohook_event &event)
+    {
+      const uint32_t head = Index(SHARED_RING_HEAD)->load(std::memory_order_relaxed);
+      if (head - fTailCache > fMask) {
+        fTailCache = Index(SHARED_RING_TAIL)->load(std::memory_order_acquire);
+        if (head - fTailCache > fMask) {
+          Index(SHARED_RING_DROPPED)->fetch_add(1, std::memory_order_relaxed);
+          return false;
+        }
+      }
+
+      int32_t *record = fRecords + (head & fMask) * SHARED_RING_RECORD_INTS;
+      record[SHARED_RECORD_TYPE] = event.type;
+      record[SHARED_RECORD_MASK] = event.mask;
+      record[SHARED_RECORD_TIME_LOW] = (int32_t) (event.time & 0xFFFFFFFF);
+      record[SHARED_RECORD_TIME_HIGH] = (int32_t) (event.time >> 32);
+
+      switch (event.type) {
+        case EVENT_KEY_TYPED:
+        case EVENT_KEY_PRESSED:
+        case EVENT_KEY_RELEASED:
+          record[SHARED_RECORD_KEYCODE] = event.data.keyboard.keycode;
+          record[SHARED_RECORD_RAWCODE] = event.data.keyboard.rawcode;
+          record[SHARED_RECORD_KEYCHAR] = event.data.keyboard.keychar;
+          break;
+
+        case EVENT_MOUSE_CLICKED:
+        case EVENT_MOUSE_PRESSED:
+        case EVENT_MOUSE_RELEASED:
+        case EVENT_MOUSE_MOVED:
+        case EVENT_MOUSE_DRAGGED:
+          record[SHARED_RECORD_BUTTON] = event.data.mouse.button;
+          record[SHARED_RECORD_CLICKS] = event.data.mouse.clicks;
+          record[SHARED_RECORD_X] = event.data.mouse.x;
+          record[SHARED_RECORD_Y] = event.data.mouse.y;
+          break;
+
+        case EVENT_MOUSE_WHEEL:
+          record[SHARED_RECORD_WHEEL_CLICKS] = event.data.wheel.clicks;
+          record[SHARED_RECORD_WHEEL_X] = event.data.wheel.x;
+          record[SHARED_RECORD_WHEEL_Y] = event.data.wheel.y;
+          record[SHARED_RECORD_WHEEL_TYPE] = event.data.wheel.type;
+          record[SHARED_RECORD_AMOUNT] = event.data.wheel.amount;
+          record[SHARED_RECORD_ROTATION] = event.data.wheel.rotation;
+          record[SHARED_RECORD_DIRECTION] = event.data.wheel.direction;
+          break;
+
+        default:
+          break;
+      }
+
+      Index(SHARED_RING_HEAD)->store(head + 1, std::memory_order_release);
+
+      return true;
+    }
+
+  private:
+
+    SharedEventRing(const SharedEventRing &);
+    SharedEventRing &operator=(const SharedEventRing &);
+
+    std::atomic<uint32_t> *Index(int slot) const
+    {
+      return reinterpret_cast<std::atomic<uint32_t> *>(fHeader + slot);
+    }
+
+    int32_t *fHeader;
+    int32_t *fRecords;
+    uint32_t fMask;
+    uint32_t fTailCache;
+};
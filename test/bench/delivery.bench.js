@@ -0,0 +1,103 @@
+/**
+ * Measures how much JS-thread time it takes to deliver mouse motion events,
+ * once with one native-to-JS call per event and once with batched delivery.
+ *
+ * Time is taken from `performance.eventLoopUtilization()`, which only counts
+ * time the event loop spent running callbacks.
+ *
+ * Usage: node test/bench/delivery.bench.js [events]
+ */
+const { performance } = require('perf_hooks');
+const { startMotion, runChild } = require('./harness');
+
+const DEFAULT_EVENTS = 10000;
+const TIMEOUT_MS = 60000;
+
+function measure(mode, events) {
+  const ioHook = require('../../index');
+
+  let count = 0;
+  let calls = 0;
+  let startElu = null;
+  let driver = null;
+
+  const timeout = setTimeout(() => finish('timed out'), TIMEOUT_MS);
+
+  function finish(error) {
+    clearTimeout(timeout);
+    const elu = performance.eventLoopUtilization(startElu);
+    if (driver) {
+      driver.kill();
+    }
+    ioHook.unload();
+
+    process.send({
+      mode,
+      error,
+      events: count,
+      calls,
+      activeMs: elu.active,
+      utilization: elu.utilization,
+    });
+    process.exit(0);
+  }
+
+  // Count crossings into JavaScript separately from emitted events.
+  const handler = mode === 'batch' ? '_batchHandler' : '_handler';
+  const original = ioHook[handler];
+  ioHook[handler] = function (msg) {
+    if (startElu !== null) {
+      calls++;
+    }
+    return original.call(this, msg);
+  };
+
+  ioHook.on('mousemove', () => {
+    if (startElu === null) {
+      // Start measuring from the first event so hook start-up is excluded.
+      startElu = performance.eventLoopUtilization();
+      return;
+    }
+
+    if (++count === events) {
+      finish();
+    }
+  });
+
+  ioHook.start({ batch: mode === 'batch' });
+  driver = startMotion();
+}
+
+async function main(events) {
+  const results = [];
+  for (const mode of ['event', 'batch']) {
+    results.push(await runChild(__filename, ['measure', mode, String(events)]));
+  }
+
+  console.log(`JS-thread time per ${DEFAULT_EVENTS} mousemove events`);
+  results.forEach((r) => {
+    if (r.error) {
+      console.log(`  ${r.mode}: ${r.error} after ${r.events} events`);
+      return;
+    }
+
+    const scale = DEFAULT_EVENTS / r.events;
+    console.log(
+      `  ${r.mode.padEnd(5)}  ${(r.activeMs * scale).toFixed(1)} ms active, ` +
+        `${Math.round(r.calls * scale)} JS calls, ` +
+        `${(r.utilization * 100).toFixed(1)}% loop utilization`
+    );
+  });
+}
+
+switch (process.argv[2]) {
+  case 'measure':
+    measure(process.argv[3], parseInt(process.argv[4], 10));
+    break;
+
+  default:
+    main(parseInt(process.argv[2], 10) || DEFAULT_EVENTS).catch((err) => {
+      console.error(err);
+      process.exit(1);
+    });
+}
@@ -0,0 +1,134 @@
+/**
+ * Measures the cost of turning native events into JavaScript objects: JS-thread
+ * time per event and young-generation garbage per event, with fresh event
+ * objects and with `reuseEventObject`.
+ *
+ * The child runs with a fixed 1 MiB semi-space, so every scavenge stands for
+ * roughly 1 MiB of short-lived allocations. Running the same script against
+ * an older build (where `reuseEventObject` is ignored) gives the "before"
+ * numbers.
+ *
+ * Usage: node test/bench/event-objects.bench.js [events]
+ */
+const v8 = require('v8');
+const { performance, PerformanceObserver, constants } = require('perf_hooks');
+const { startMotion, runChild } = require('./harness');
+
+const DEFAULT_EVENTS = 10000;
+const TIMEOUT_MS = 60000;
+const SEMI_SPACE_MB = 1;
+
+function newSpaceUsed() {
+  const space = v8
+    .getHeapSpaceStatistics()
+    .find((s) => s.space_name === 'new_space');
+  return space ? space.space_used_size : 0;
+}
+
+function measure(mode, events) {
+  const ioHook = require('../../index');
+
+  let count = 0;
+  let scavenges = 0;
+  let startElu = null;
+  let startNewSpace = 0;
+  let driver = null;
+
+  const observer = new PerformanceObserver((list) => {
+    if (startElu === null) {
+      return;
+    }
+
+    list.getEntries().forEach((entry) => {
+      // Node 16 moved the GC kind into `detail`.
+      const kind = entry.detail ? entry.detail.kind : entry.kind;
+      if (kind === constants.NODE_PERFORMANCE_GC_MINOR) {
+        scavenges++;
+      }
+    });
+  });
+  observer.observe({ entryTypes: ['gc'] });
+
+  const timeout = setTimeout(() => finish('timed out'), TIMEOUT_MS);
+
+  function finish(error) {
+    clearTimeout(timeout);
+    const elu = performance.eventLoopUtilization(startElu);
+    const newSpace = newSpaceUsed();
+    if (driver) {
+      driver.kill();
+    }
+    ioHook.unload();
+
+    // Let the observer see the last GC entries before reporting.
+    setImmediate(() => {
+      observer.disconnect();
+      process.send({
+        mode,
+        error,
+        events: count,
+        scavenges,
+        youngBytes:
+          scavenges * SEMI_SPACE_MB * 1024 * 1024 + (newSpace - startNewSpace),
+        activeMs: elu.active,
+      });
+      process.exit(0);
+    });
+  }
+
+  // Listener that does not allocate, so only delivery shows up.
+  ioHook.on('mousemove', () => {
+    if (startElu === null) {
+      startElu = performance.eventLoopUtilization();
+      startNewSpace = newSpaceUsed();
+      return;
+    }
+
+    if (++count === events) {
+      finish();
+    }
+  });
+
+  ioHook.start({ reuseEventObject: mode === 'reuse' });
+  driver = startMotion();
+}
+
+async function main(events) {
+  const execArgv = [
+    `--min-semi-space-size=${SEMI_SPACE_MB}`,
+    `--max-semi-space-size=${SEMI_SPACE_MB}`,
+  ];
+
+  const results = [];
+  for (const mode of ['fresh', 'reuse']) {
+    results.push(
+      await runChild(__filename, ['measure', mode, String(events)], execArgv)
+    );
+  }
+
+  console.log('Event object cost per mousemove event');
+  results.forEach((r) => {
+    if (r.error) {
+      console.log(`  ${r.mode}: ${r.error} after ${r.events} events`);
+      return;
+    }
+
+    console.log(
+      `  ${r.mode.padEnd(5)}  ${((r.activeMs * 1e6) / r.events).toFixed(0)} ns, ` +
+        `~${Math.max(0, r.youngBytes / r.events).toFixed(0)} young-gen bytes, ` +
+        `${((r.scavenges * DEFAULT_EVENTS) / r.events).toFixed(1)} scavenges per ${DEFAULT_EVENTS} events`
+    );
+  });
+}
+
+switch (process.argv[2]) {
+  case 'measure':
+    measure(process.argv[3], parseInt(process.argv[4], 10));
+    break;
+
+  default:
+    main(parseInt(process.argv[2], 10) || DEFAULT_EVENTS).catch((err) => {
+      console.error(err);
+      process.exit(1);
+    });
+}
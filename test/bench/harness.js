@@ -0,0 +1,57 @@
+/**
+ * Shared helpers for the benchmarks in this directory.
+ *
+ * Mouse motion is generated from a separate process with robotjs so the
+ * driver does not run on the event loop being measured.
+ */
+const { fork } = require('child_process');
+
+/**
+ * Start a process that moves the mouse until it is killed.
+ * @return {ChildProcess}
+ */
+function startMotion() {
+  return fork(__filename, ['drive']);
+}
+
+function drive() {
+  const robot = require('robotjs');
+  robot.setMouseDelay(0);
+
+  // Alternate between two points so every move produces a motion event.
+  let odd = false;
+  function step() {
+    for (let i = 0; i < 100; i++) {
+      odd = !odd;
+      robot.moveMouse(odd ? 100 : 101, 100);
+    }
+    setImmediate(step);
+  }
+  step();
+}
+
+/**
+ * Run `file` in a child process and resolve with the first message it sends.
+ * @param {string} file Benchmark script
+ * @param {Array<string>} args Arguments for the child
+ * @param {Array<string>} [execArgv] Node flags for the child
+ * @return {Promise<Object>}
+ */
+function runChild(file, args, execArgv) {
+  return new Promise((resolve, reject) => {
+    const child = fork(file, args, { execArgv: execArgv || [] });
+    child.on('message', resolve);
+    child.on('error', reject);
+    child.on('exit', (code) => {
+      if (code !== 0) {
+        reject(new Error(`${args.join(' ')} exited with code ${code}`));
+      }
+    });
+  });
+}
+
+if (require.main === module && process.argv[2] === 'drive') {
+  drive();
+}
+
+module.exports = { startMotion, runChild };
@@ -0,0 +1,210 @@
+/**
+ * Drives the binding with the synthetic backend at increasing mouse motion
+ * rates, with key bursts mixed in, and reports delivery latency, loss,
+ * JS-thread time, GC time and memory for each rate. Needs no X server and no
+ * input devices.
+ *
+ * Every rate runs in a fresh child process, once with listeners attached and
+ * once without any. Without listeners the event mask filters everything out
+ * natively, which shows what the hook costs on its own.
+ *
+ * Synthetic mouse moves are generated on a fixed schedule and sweep a 1024x768
+ * screen row by row, one pixel each, so the position of a move gives its place
+ * in the schedule. Latency is measured against that schedule, taking the
+ * fastest delivered move as zero, so it shows time spent queued relative to
+ * the fastest delivery rather than the absolute cost of a wakeup. Lost moves
+ * are the ones the `overflow` events report.
+ *
+ * Usage: node test/bench/throughput.bench.js [duration ms]
+ */
+const { performance, PerformanceObserver } = require('perf_hooks');
+const { runChild } = require('./harness');
+
+const RATES = [100, 500, 1000, 2000, 5000, 10000, 20000];
+const DEFAULT_DURATION_MS = 2000;
+const SETTLE_MS = 500;
+const KEY_RATE = 20;
+const KEY_BURST = 10;
+const SCREEN_WIDTH = 1024;
+const SCREEN_HEIGHT = 768;
+
+function now() {
+  return Number(process.hrtime.bigint()) / 1e6;
+}
+
+function percentile(sorted, p) {
+  if (sorted.length === 0) {
+    return NaN;
+  }
+  return sorted[Math.min(sorted.length - 1, Math.floor(sorted.length * p))];
+}
+
+function measure(mode, rate, duration) {
+  const ioHook = require('../../index');
+  const listen = mode === 'listeners';
+
+  // Positions repeat once the sweep starts over.
+  if ((rate * duration) / 1000 >= SCREEN_WIDTH * SCREEN_HEIGHT) {
+    throw new Error('Run too long to number every move by its position');
+  }
+
+  // Arrival time and schedule slot of every move.
+  const arrivals = new Float64Array(Math.ceil((rate * duration) / 1000) + 16);
+  const slots = new Float64Array(arrivals.length);
+  let moves = 0;
+  let lost = 0;
+  let keys = 0;
+
+  let gcMs = 0;
+  const observer = new PerformanceObserver((list) => {
+    list.getEntries().forEach((entry) => {
+      gcMs += entry.duration;
+    });
+  });
+  observer.observe({ entryTypes: ['gc'] });
+
+  let peakRss = process.memoryUsage().rss;
+  const sampler = setInterval(() => {
+    peakRss = Math.max(peakRss, process.memoryUsage().rss);
+  }, 50);
+
+  if (listen) {
+    ioHook.on('mousemove', (event) => {
+      if (moves < arrivals.length) {
+        arrivals[moves] = now();
+        slots[moves] = event.y * SCREEN_WIDTH + event.x;
+        moves++;
+      }
+    });
+    ioHook.on('overflow', (overflow) => {
+      lost += overflow.types.mousemove || 0;
+    });
+    ioHook.on('keydown', () => keys++);
+    ioHook.on('keyup', () => keys++);
+    ioHook.on('keypress', () => keys++);
+  }
+
+  const startRss = process.memoryUsage().rss;
+  const startCpu = process.cpuUsage();
+  const startElu = performance.eventLoopUtilization();
+
+  ioHook.start({
+    backend: 'synthetic',
+    synthetic: {
+      motionRate: rate,
+      keyRate: KEY_RATE,
+      keyBurst: KEY_BURST,
+      duration,
+    },
+  });
+
+  setTimeout(() => {
+    const elu = performance.eventLoopUtilization(startElu);
+    const cpu = process.cpuUsage(startCpu);
+    const endRss = process.memoryUsage().rss;
+    clearInterval(sampler);
+    ioHook.unload();
+
+    // Latency against the schedule, with the fastest move taken as zero.
+    const period = 1000 / rate;
+    let origin = Infinity;
+    for (let i = 0; i < moves; i++) {
+      origin = Math.min(origin, arrivals[i] - slots[i] * period);
+    }
+    const latencies = [];
+    for (let i = 0; i < moves; i++) {
+      latencies.push(arrivals[i] - slots[i] * period - origin);
+    }
+    latencies.sort((a, b) => a - b);
+
+    const generated = Math.floor((rate * duration) / 1000) + 1;
+
+    setImmediate(() => {
+      observer.disconnect();
+      process.send({
+        mode,
+        rate,
+        generated,
+        moves,
+        lost,
+        keys,
+        p50: percentile(latencies, 0.5),
+        p99: percentile(latencies, 0.99),
+        activeMs: elu.active,
+        cpuMs: (cpu.user + cpu.system) / 1000,
+        gcMs,
+        rssGrowthMb: (endRss - startRss) / (1024 * 1024),
+        peakRssMb: peakRss / (1024 * 1024),
+      });
+      process.exit(0);
+    });
+  }, duration + SETTLE_MS);
+}
+
+function format(value, digits) {
+  return Number.isFinite(value) ? value.toFixed(digits) : '-';
+}
+
+async function main(duration) {
+  const results = [];
+  for (const mode of ['listeners', 'none']) {
+    for (const rate of RATES) {
+      results.push(
+        await runChild(__filename, [
+          'measure',
+          mode,
+          String(rate),
+          String(duration),
+        ])
+      );
+    }
+  }
+
+  console.log(
+    `Synthetic motion for ${duration} ms, plus ${KEY_RATE} bursts of ` +
+      `${KEY_BURST} keys per second`
+  );
+  console.log(
+    '  mode       rate Hz   moves    lost   keys  p50 ms* p99 ms* ' +
+      'JS ms  CPU ms  GC ms  RSS +MB  peak MB'
+  );
+  results.forEach((r) => {
+    const columns = [
+      r.mode.padEnd(9),
+      String(r.rate).padStart(7),
+      String(r.moves).padStart(6),
+      String(r.lost).padStart(6),
+      String(r.keys).padStart(5),
+      format(r.p50, 2).padStart(6),
+      format(r.p99, 2).padStart(6),
+      format(r.activeMs, 0).padStart(5),
+      format(r.cpuMs, 0).padStart(6),
+      format(r.gcMs, 1).padStart(5),
+      format(r.rssGrowthMb, 1).padStart(7),
+      format(r.peakRssMb, 1).padStart(7),
+    ];
+    console.log(`  ${columns.join('  ')}`);
+  });
+  console.log('  * relative to the fastest delivered move, not absolute');
+
+  const sustained = results
+    .filter((r) => r.mode === 'listeners' && r.lost === 0)
+    .reduce((max, r) => Math.max(max, r.rate), 0);
+  console.log(`  Highest motion rate delivered without loss: ${sustained} Hz`);
+}
+
+switch (process.argv[2]) {
+  case 'measure':
+    measure(
+      process.argv[3],
+      parseInt(process.argv[4], 10),
+      parseInt(process.argv[5], 10)
+    );
+    break;
+
+  default:
+    main(parseInt(process.argv[2], 10) || DEFAULT_DURATION_MS).catch((err) => {
+      console.error(err);
+      process.exit(1);
+    });
+}
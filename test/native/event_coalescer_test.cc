@@ -0,0 +1,193 @@
+#include <cstring>
+
+#include "event_coalescer.h"
+#include "minunit.h"
+
+static QueuedEvent mouse_event(event_type type, int16_t x, int16_t y, uint16_t mask = 0) {
+  QueuedEvent queued;
+  memset(&queued, 0, sizeof(queued));
+  queued.event.type = type;
+  queued.event.mask = mask;
+  queued.event.data.mouse.x = x;
+  queued.event.data.mouse.y = y;
+
+  return queued;
+}
+
+static QueuedEvent wheel_event(int16_t rotation, uint8_t direction = WHEEL_VERTICAL_DIRECTION) {
+  QueuedEvent queued;
+  memset(&queued, 0, sizeof(queued));
+  queued.event.type = EVENT_MOUSE_WHEEL;
+  queued.event.data.wheel.type = WHEEL_UNIT_SCROLL;
+  queued.event.data.wheel.amount = 3;
+  queued.event.data.wheel.rotation = rotation;
+  queued.event.data.wheel.direction = direction;
+
+  return queued;
+}
+
+static QueuedEvent key_event() {
+  QueuedEvent queued;
+  memset(&queued, 0, sizeof(queued));
+  queued.event.type = EVENT_KEY_PRESSED;
+  queued.event.data.keyboard.keycode = VC_A;
+
+  return queued;
+}
+
+static const char * test_motion_run() {
+  EventCoalescer coalescer(true, false, 0);
+  CoalescedEvent ready[2];
+
+  mu_assert("error, motion delivered before the run ended", coalescer.Add(mouse_event(EVENT_MOUSE_MOVED, 10, 10), 1, ready) == 0);
+  mu_assert("error, motion delivered before the run ended", coalescer.Add(mouse_event(EVENT_MOUSE_MOVED, 12, 11), 2, ready) == 0);
+  mu_assert("error, motion delivered before the run ended", coalescer.Add(mouse_event(EVENT_MOUSE_MOVED, 15, 13), 3, ready) == 0);
+
+  // The key ends the run, which goes first.
+  mu_assert("error, run and key not delivered", coalescer.Add(key_event(), 4, ready) == 2);
+  mu_assert("error, run is not motion", ready[0].queued.event.type == EVENT_MOUSE_MOVED);
+  mu_assert("error, run does not count its events", ready[0].samples == 3);
+  mu_assert("error, run does not end at the last position", ready[0].queued.event.data.mouse.x == 15 && ready[0].queued.event.data.mouse.y == 13);
+  mu_assert("error, run distance wrong", ready[0].dx == 5 && ready[0].dy == 3);
+  mu_assert("error, run does not keep the first dequeue time", ready[0].dequeued == 1);
+
+  mu_assert("error, key not delivered after the run", ready[1].queued.event.type == EVENT_KEY_PRESSED);
+  mu_assert("error, key counted as coalesced", ready[1].samples == 0);
+
+  CoalescedEvent pending;
+  mu_assert("error, run left pending", !coalescer.Flush(5, pending));
+
+  return nullptr;
+}
+
+static const char * test_motion_distance_from_last_position() {
+  EventCoalescer coalescer(true, false, 0);
+  CoalescedEvent ready[2];
+
+  mu_assert("error, press not delivered", coalescer.Add(mouse_event(EVENT_MOUSE_PRESSED, 100, 200), 1, ready) == 1);
+  mu_assert("error, press counted as coalesced", ready[0].samples == 0);
+
+  coalescer.Add(mouse_event(EVENT_MOUSE_DRAGGED, 103, 204), 2, ready);
+  coalescer.Add(mouse_event(EVENT_MOUSE_DRAGGED, 106, 208), 3, ready);
+
+  // Without a rate, the end of the drain delivers the run.
+  CoalescedEvent run;
+  mu_assert("error, run not flushed", coalescer.Flush(4, run));
+  mu_assert("error, run does not count its events", run.samples == 2);
+  mu_assert("error, distance not measured from the press", run.dx == 6 && run.dy == 8);
+  mu_assert("error, run flushed twice", !coalescer.Flush(5, run));
+
+  // The next run starts where the last one ended.
+  coalescer.Add(mouse_event(EVENT_MOUSE_DRAGGED, 100, 208), 6, ready);
+  mu_assert("error, run not flushed", coalescer.Flush(7, run));
+  mu_assert("error, distance not measured from the previous run", run.dx == -6 && run.dy == 0 && run.samples == 1);
+
+  return nullptr;
+}
+
+static const char * test_run_boundaries() {
+  EventCoalescer coalescer(true, true, 0);
+  CoalescedEvent ready[2];
+
+  // A change of modifiers ends the run.
+  coalescer.Add(mouse_event(EVENT_MOUSE_MOVED, 0, 0), 1, ready);
+  mu_assert("error, modifier change did not end the run", coalescer.Add(mouse_event(EVENT_MOUSE_MOVED, 1, 0, MASK_SHIFT_L), 2, ready) == 1);
+  mu_assert("error, run has the wrong mask", ready[0].queued.event.mask == 0 && ready[0].samples == 1);
+
+  // So does a change from moving to dragging.
+  mu_assert("error, drag did not end the run", coalescer.Add(mouse_event(EVENT_MOUSE_DRAGGED, 2, 0, MASK_SHIFT_L), 3, ready) == 1);
+  mu_assert("error, run has the wrong type", ready[0].queued.event.type == EVENT_MOUSE_MOVED && ready[0].queued.event.mask == MASK_SHIFT_L);
+
+  // And a wheel event, which starts a run of its own.
+  mu_assert("error, wheel did not end the run", coalescer.Add(wheel_event(1), 4, ready) == 1);
+  mu_assert("error, run has the wrong type", ready[0].queued.event.type == EVENT_MOUSE_DRAGGED);
+
+  // Scrolling the other way ends the wheel run.
+  mu_assert("error, direction change did not end the run", coalescer.Add(wheel_event(1, WHEEL_HORIZONTAL_DIRECTION), 5, ready) == 1);
+  mu_assert("error, run has the wrong direction", ready[0].queued.event.data.wheel.direction == WHEEL_VERTICAL_DIRECTION);
+
+  CoalescedEvent run;
+  mu_assert("error, last run not flushed", coalescer.Flush(6, run));
+  mu_assert("error, last run has the wrong direction", run.queued.event.data.wheel.direction == WHEEL_HORIZONTAL_DIRECTION);
+
+  return nullptr;
+}
+
+static const char * test_wheel_rotation_sum() {
+  EventCoalescer coalescer(false, true, 0);
+  CoalescedEvent ready[2];
+
+  coalescer.Add(wheel_event(1), 1, ready);
+  coalescer.Add(wheel_event(2), 2, ready);
+  coalescer.Add(wheel_event(-1), 3, ready);
+
+  CoalescedEvent run;
+  mu_assert("error, wheel run not flushed", coalescer.Flush(4, run));
+  mu_assert("error, rotations not summed", run.queued.event.data.wheel.rotation == 2);
+  mu_assert("error, wheel run does not count its events", run.samples == 3);
+  mu_assert("error, wheel run has a distance", run.dx == 0 && run.dy == 0);
+
+  // Motion is not coalesced here, so it passes straight through.
+  mu_assert("error, motion held back", coalescer.Add(mouse_event(EVENT_MOUSE_MOVED, 1, 1), 5, ready) == 1);
+  mu_assert("error, motion counted as coalesced", ready[0].samples == 0);
+
+  return nullptr;
+}
+
+static const char * test_disabled() {
+  EventCoalescer coalescer(false, false, 0);
+  CoalescedEvent ready[2];
+
+  mu_assert("error, motion held back", coalescer.Add(mouse_event(EVENT_MOUSE_MOVED, 1, 1), 1, ready) == 1);
+  mu_assert("error, wheel held back", coalescer.Add(wheel_event(1), 2, ready) == 1);
+  mu_assert("error, wheel counted as coalesced", ready[0].samples == 0);
+
+  CoalescedEvent run;
+  mu_assert("error, run pending", !coalescer.Flush(3, run));
+
+  return nullptr;
+}
+
+static const char * test_rate() {
+  // 100 runs a second, one every 10ms.
+  const uint64_t ms = 1000000;
+  EventCoalescer coalescer(true, false, 100);
+  CoalescedEvent ready[2];
+  CoalescedEvent run;
+
+  mu_assert("error, empty coalescer waits", coalescer.Wait(1000 * ms) == 0);
+
+  coalescer.Add(mouse_event(EVENT_MOUSE_MOVED, 0, 0), 1000 * ms, ready);
+  mu_assert("error, first run held back", coalescer.Flush(1000 * ms, run));
+
+  // The next run has to wait for the rest of the period, and grows meanwhile.
+  coalescer.Add(mouse_event(EVENT_MOUSE_MOVED, 5, 0), 1002 * ms, ready);
+  mu_assert("error, run delivered early", !coalescer.Flush(1002 * ms, run));
+  mu_assert("error, wrong wait", coalescer.Wait(1002 * ms) == 8 * ms);
+
+  coalescer.Add(mouse_event(EVENT_MOUSE_MOVED, 9, 0), 1006 * ms, ready);
+  mu_assert("error, run delivered early", !coalescer.Flush(1009 * ms, run));
+  mu_assert("error, wrong wait", coalescer.Wait(1009 * ms) == 1 * ms);
+
+  mu_assert("error, run not delivered when due", coalescer.Flush(1010 * ms, run));
+  mu_assert("error, run did not grow while held back", run.samples == 2);
+  mu_assert("error, run distance wrong", run.dx == 9 && run.dy == 0);
+
+  // Other events still end the run at once, to keep the order.
+  coalescer.Add(mouse_event(EVENT_MOUSE_MOVED, 10, 0), 1011 * ms, ready);
+  mu_assert("error, key did not end the run", coalescer.Add(key_event(), 1012 * ms, ready) == 2);
+  mu_assert("error, run not delivered before the key", ready[0].samples == 1 && ready[1].queued.event.type == EVENT_KEY_PRESSED);
+
+  return nullptr;
+}
+
+const char * event_coalescer_tests() {
+  mu_run_test(test_motion_run);
+  mu_run_test(test_motion_distance_from_last_position);
+  mu_run_test(test_run_boundaries);
+  mu_run_test(test_wheel_rotation_sum);
+  mu_run_test(test_disabled);
+  mu_run_test(test_rate);
+
+  return nullptr;
+}
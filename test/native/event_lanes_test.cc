@@ -0,0 +1,144 @@
+#include <cstring>
+
+#include "event_lanes.h"
+#include "minunit.h"
+
+// An event queued at the given millisecond, numbered by its time.
+static QueuedEvent make_event(event_type type, uint64_t ms) {
+  QueuedEvent queued;
+  memset(&queued, 0, sizeof(queued));
+  queued.event.type = type;
+  queued.event.time = ms;
+  queued.queued = ms * 1000000;
+
+  return queued;
+}
+
+// Pop the lanes empty and check the times of the events that come out.
+static bool pops(EventLanes &lanes, const uint64_t *times, size_t count) {
+  QueuedEvent queued;
+  for (size_t i = 0; i < count; i++) {
+    if (!lanes.Pop(queued) || queued.event.time != times[i]) {
+      return false;
+    }
+  }
+
+  return !lanes.Pop(queued);
+}
+
+static const char * test_is_priority() {
+  mu_assert("error, key press not a priority event", EventLanes::IsPriority(EVENT_KEY_PRESSED));
+  mu_assert("error, key release not a priority event", EventLanes::IsPriority(EVENT_KEY_RELEASED));
+  mu_assert("error, button press not a priority event", EventLanes::IsPriority(EVENT_MOUSE_PRESSED));
+  mu_assert("error, click not a priority event", EventLanes::IsPriority(EVENT_MOUSE_CLICKED));
+  mu_assert("error, motion is a priority event", !EventLanes::IsPriority(EVENT_MOUSE_MOVED));
+  mu_assert("error, drag is a priority event", !EventLanes::IsPriority(EVENT_MOUSE_DRAGGED));
+  mu_assert("error, wheel is a priority event", !EventLanes::IsPriority(EVENT_MOUSE_WHEEL));
+
+  return nullptr;
+}
+
+static const char * test_single_lane() {
+  EventLanes lanes(8, OVERFLOW_DROP_NEWEST, 0, false, PRIORITY_SKEW_UNBOUNDED);
+
+  lanes.Push(make_event(EVENT_MOUSE_MOVED, 1));
+  lanes.Push(make_event(EVENT_MOUSE_MOVED, 2));
+  lanes.Push(make_event(EVENT_KEY_PRESSED, 3));
+  lanes.Push(make_event(EVENT_MOUSE_MOVED, 4));
+
+  const uint64_t times[] = { 1, 2, 3, 4 };
+  mu_assert("error, events reordered without the priority lane", pops(lanes, times, 4));
+  mu_assert("error, capacity counts the unused lane", lanes.Capacity() == 8);
+
+  return nullptr;
+}
+
+static const char * test_priority_overtakes() {
+  EventLanes lanes(8, OVERFLOW_DROP_NEWEST, 0, true, PRIORITY_SKEW_UNBOUNDED);
+
+  lanes.Push(make_event(EVENT_MOUSE_MOVED, 1));
+  lanes.Push(make_event(EVENT_MOUSE_MOVED, 2));
+  lanes.Push(make_event(EVENT_KEY_PRESSED, 3));
+  lanes.Push(make_event(EVENT_MOUSE_WHEEL, 4));
+  lanes.Push(make_event(EVENT_KEY_RELEASED, 5));
+  lanes.Push(make_event(EVENT_MOUSE_MOVED, 6));
+
+  // Key events go first and keep their own order, as does the rest.
+  const uint64_t times[] = { 3, 5, 1, 2, 4, 6 };
+  mu_assert("error, priority events did not overtake", pops(lanes, times, 6));
+  mu_assert("error, capacity does not count both lanes", lanes.Capacity() == 16);
+
+  return nullptr;
+}
+
+static const char * test_priority_skew() {
+  EventLanes lanes(8, OVERFLOW_DROP_NEWEST, 0, true, 5);
+
+  // The key may overtake motion up to 5ms older than itself, but not more.
+  lanes.Push(make_event(EVENT_MOUSE_MOVED, 10));
+  lanes.Push(make_event(EVENT_MOUSE_MOVED, 16));
+  lanes.Push(make_event(EVENT_MOUSE_MOVED, 20));
+  lanes.Push(make_event(EVENT_KEY_PRESSED, 21));
+  lanes.Push(make_event(EVENT_MOUSE_MOVED, 22));
+
+  const uint64_t times[] = { 10, 21, 16, 20, 22 };
+  mu_assert("error, priority event overtook more than the skew", pops(lanes, times, 5));
+
+  // Exactly the skew still overtakes.
+  lanes.Push(make_event(EVENT_MOUSE_MOVED, 30));
+  lanes.Push(make_event(EVENT_KEY_PRESSED, 35));
+
+  const uint64_t edge[] = { 35, 30 };
+  mu_assert("error, priority event did not overtake by the skew", pops(lanes, edge, 2));
+
+  return nullptr;
+}
+
+static const char * test_priority_skew_zero() {
+  EventLanes lanes(8, OVERFLOW_DROP_NEWEST, 0, true, 0);
+
+  lanes.Push(make_event(EVENT_MOUSE_MOVED, 1));
+  lanes.Push(make_event(EVENT_KEY_PRESSED, 2));
+  lanes.Push(make_event(EVENT_MOUSE_MOVED, 3));
+  lanes.Push(make_event(EVENT_KEY_RELEASED, 4));
+
+  const uint64_t times[] = { 1, 2, 3, 4 };
+  mu_assert("error, zero skew did not keep the queue order", pops(lanes, times, 4));
+
+  return nullptr;
+}
+
+static const char * test_lane_counts() {
+  EventLanes lanes(2, OVERFLOW_DROP_NEWEST, 0, true, PRIORITY_SKEW_UNBOUNDED);
+
+  // Each lane fills up on its own.
+  for (uint64_t i = 0; i < 3; i++) {
+    lanes.Push(make_event(EVENT_MOUSE_MOVED, i));
+    lanes.Push(make_event(EVENT_KEY_PRESSED, 10 + i));
+  }
+
+  mu_assert("error, dropped motion not counted", lanes.Dropped(EVENT_MOUSE_MOVED) == 1);
+  mu_assert("error, dropped key not counted", lanes.Dropped(EVENT_KEY_PRESSED) == 1);
+
+  const uint64_t times[] = { 10, 11, 0, 1 };
+  mu_assert("error, wrong events kept", pops(lanes, times, 4));
+
+  EventLanes coalescing(2, OVERFLOW_COALESCE_MOTION, 0, true, PRIORITY_SKEW_UNBOUNDED);
+  for (uint64_t i = 0; i < 4; i++) {
+    coalescing.Push(make_event(EVENT_MOUSE_MOVED, i));
+  }
+  mu_assert("error, coalesced motion not counted", coalescing.Coalesced(EVENT_MOUSE_MOVED) == 2);
+
+  return nullptr;
+}
+
+const char * event_lanes_tests() {
+  mu_run_test(test_is_priority);
+  mu_run_test(test_single_lane);
+  mu_run_test(test_priority_overtakes);
+  mu_run_test(test_priority_skew);
+  mu_run_test(test_priority_skew_zero);
+  mu_run_test(test_lane_counts);
+
+  return nullptr;
+}
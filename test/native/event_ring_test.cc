@@ -0,0 +1,214 @@
+#include <atomic>
+#include <cstring>
+#include <thread>
+
+#include "event_ring.h"
+#include "minunit.h"
+
+// An event numbered by its time, so the order it comes out in can be checked.
+static QueuedEvent make_event(event_type type, uint64_t number) {
+  QueuedEvent queued;
+  memset(&queued, 0, sizeof(queued));
+  queued.event.type = type;
+  queued.event.time = number;
+  queued.queued = number;
+
+  return queued;
+}
+
+// Pop the ring empty and check the numbers of the events that come out.
+static bool pops(EventRing &ring, const uint64_t *numbers, size_t count) {
+  QueuedEvent queued;
+  for (size_t i = 0; i < count; i++) {
+    if (!ring.Pop(queued) || queued.event.time != numbers[i]) {
+      return false;
+    }
+  }
+
+  return !ring.Pop(queued);
+}
+
+static const char * test_round_capacity() {
+  mu_assert("error, capacity 0 not rounded up to 2", EventRing::RoundCapacity(0) == 2);
+  mu_assert("error, capacity 5 not rounded up to 8", EventRing::RoundCapacity(5) == 8);
+  mu_assert("error, capacity 8 not kept", EventRing::RoundCapacity(8) == 8);
+  mu_assert("error, capacity not capped", EventRing::RoundCapacity(EVENT_RING_MAX_CAPACITY * 4) == EVENT_RING_MAX_CAPACITY);
+
+  EventRing ring(5);
+  mu_assert("error, ring capacity not rounded", ring.Capacity() == 8);
+
+  return nullptr;
+}
+
+static const char * test_fifo_order() {
+  EventRing ring(4);
+  QueuedEvent queued;
+
+  mu_assert("error, empty ring popped an event", !ring.Pop(queued));
+
+  // Go around the ring a few times.
+  for (uint64_t i = 0; i < 10; i++) {
+    mu_assert("error, push failed", ring.Push(make_event(EVENT_KEY_PRESSED, i * 3)));
+    mu_assert("error, push failed", ring.Push(make_event(EVENT_MOUSE_MOVED, i * 3 + 1)));
+    mu_assert("error, push failed", ring.Push(make_event(EVENT_KEY_RELEASED, i * 3 + 2)));
+
+    const uint64_t numbers[] = { i * 3, i * 3 + 1, i * 3 + 2 };
+    mu_assert("error, events not popped in order", pops(ring, numbers, 3));
+  }
+
+  return nullptr;
+}
+
+static const char * test_drop_newest() {
+  EventRing ring(4, OVERFLOW_DROP_NEWEST);
+
+  for (uint64_t i = 0; i < 4; i++) {
+    mu_assert("error, push into a ring with room failed", ring.Push(make_event(EVENT_MOUSE_MOVED, i)));
+  }
+  mu_assert("error, push into a full ring succeeded", !ring.Push(make_event(EVENT_MOUSE_MOVED, 4)));
+  mu_assert("error, push into a full ring succeeded", !ring.Push(make_event(EVENT_KEY_PRESSED, 5)));
+
+  const uint64_t numbers[] = { 0, 1, 2, 3 };
+  mu_assert("error, the oldest events were not kept", pops(ring, numbers, 4));
+
+  mu_assert("error, dropped motion not counted", ring.Dropped(EVENT_MOUSE_MOVED) == 1);
+  mu_assert("error, dropped key not counted", ring.Dropped(EVENT_KEY_PRESSED) == 1);
+  mu_assert("error, drop counted as coalesced", ring.Coalesced(EVENT_MOUSE_MOVED) == 0);
+
+  return nullptr;
+}
+
+static const char * test_drop_oldest() {
+  EventRing ring(4, OVERFLOW_DROP_OLDEST);
+
+  for (uint64_t i = 0; i < 6; i++) {
+    mu_assert("error, push failed", ring.Push(make_event(i < 2 ? EVENT_KEY_PRESSED : EVENT_MOUSE_MOVED, i)));
+  }
+
+  const uint64_t numbers[] = { 2, 3, 4, 5 };
+  mu_assert("error, the newest events were not kept", pops(ring, numbers, 4));
+
+  mu_assert("error, dropped keys not counted", ring.Dropped(EVENT_KEY_PRESSED) == 2);
+  mu_assert("error, kept motion counted", ring.Dropped(EVENT_MOUSE_MOVED) == 0);
+
+  return nullptr;
+}
+
+static const char * test_coalesce_motion() {
+  EventRing ring(4, OVERFLOW_COALESCE_MOTION);
+
+  ring.Push(make_event(EVENT_KEY_PRESSED, 0));
+  ring.Push(make_event(EVENT_MOUSE_MOVED, 1));
+  ring.Push(make_event(EVENT_MOUSE_MOVED, 2));
+  ring.Push(make_event(EVENT_KEY_RELEASED, 3));
+
+  // The oldest event is a key, so new motion gives way.
+  mu_assert("error, motion displaced a key", !ring.Push(make_event(EVENT_MOUSE_DRAGGED, 4)));
+  mu_assert("error, new motion not counted as coalesced", ring.Coalesced(EVENT_MOUSE_DRAGGED) == 1);
+
+  // Only keys involved, so the oldest key is dropped.
+  mu_assert("error, key not queued", ring.Push(make_event(EVENT_KEY_PRESSED, 5)));
+  mu_assert("error, oldest key not counted as dropped", ring.Dropped(EVENT_KEY_PRESSED) == 1);
+
+  // The oldest event is motion now, which gives way to the key.
+  mu_assert("error, key not queued", ring.Push(make_event(EVENT_KEY_RELEASED, 6)));
+  mu_assert("error, oldest motion not counted as coalesced", ring.Coalesced(EVENT_MOUSE_MOVED) == 1);
+
+  const uint64_t numbers[] = { 2, 3, 5, 6 };
+  mu_assert("error, wrong events kept", pops(ring, numbers, 4));
+
+  mu_assert("error, coalesced motion counted as dropped", ring.Dropped(EVENT_MOUSE_MOVED) == 0);
+  mu_assert("error, kept key counted", ring.Dropped(EVENT_KEY_RELEASED) == 0);
+
+  return nullptr;
+}
+
+static const char * test_block_without_consumer() {
+  EventRing ring(2, OVERFLOW_BLOCK, 1);
+
+  ring.Push(make_event(EVENT_KEY_PRESSED, 0));
+  ring.Push(make_event(EVENT_KEY_PRESSED, 1));
+  mu_assert("error, push into a full ring succeeded after the timeout", !ring.Push(make_event(EVENT_KEY_PRESSED, 2)));
+  mu_assert("error, timed out event not counted", ring.Dropped(EVENT_KEY_PRESSED) == 1);
+
+  const uint64_t numbers[] = { 0, 1 };
+  mu_assert("error, queued events lost", pops(ring, numbers, 2));
+
+  return nullptr;
+}
+
+// Run a producer thread through a small ring and check that the consumer
+// sees every event exactly once, in order, and that the ring accounts for
+// every event that it did not see.
+static bool stream(OverflowPolicy policy, uint32_t blockTimeout, uint64_t count, uint64_t &received, uint64_t &lost) {
+  EventRing ring(8, policy, blockTimeout);
+  std::atomic<bool> done(false);
+
+  std::thread producer([&ring, &done, count]() {
+    for (uint64_t i = 1; i <= count; i++) {
+      ring.Push(make_event(EVENT_MOUSE_MOVED, i));
+    }
+    done.store(true, std::memory_order_release);
+  });
+
+  bool ordered = true;
+  uint64_t last = 0;
+  QueuedEvent queued;
+  received = 0;
+  for (;;) {
+    const bool finished = done.load(std::memory_order_acquire);
+    while (ring.Pop(queued)) {
+      ordered = ordered && queued.event.time > last;
+      last = queued.event.time;
+      received++;
+    }
+    if (finished) {
+      break;
+    }
+    std::this_thread::yield();
+  }
+  producer.join();
+
+  lost = ring.Dropped(EVENT_MOUSE_MOVED) + ring.Coalesced(EVENT_MOUSE_MOVED);
+
+  return ordered;
+}
+
+static const char * test_stream_accounting() {
+  const OverflowPolicy policies[] = {
+    OVERFLOW_DROP_NEWEST, OVERFLOW_DROP_OLDEST, OVERFLOW_COALESCE_MOTION
+  };
+  const uint64_t count = 100000;
+
+  for (size_t i = 0; i < sizeof(policies) / sizeof(policies[0]); i++) {
+    uint64_t received, lost;
+    mu_assert("error, events reordered", stream(policies[i], 0, count, received, lost));
+    mu_assert("error, events received and lost do not add up", received + lost == count);
+  }
+
+  return nullptr;
+}
+
+static const char * test_block_with_consumer() {
+  uint64_t received, lost;
+  const uint64_t count = 20000;
+
+  mu_assert("error, events reordered", stream(OVERFLOW_BLOCK, 10000, count, received, lost));
+  mu_assert("error, blocking ring lost events", lost == 0);
+  mu_assert("error, blocking ring did not deliver every event", received == count);
+
+  return nullptr;
+}
+
+const char * event_ring_tests() {
+  mu_run_test(test_round_capacity);
+  mu_run_test(test_fifo_order);
+  mu_run_test(test_drop_newest);
+  mu_run_test(test_drop_oldest);
+  mu_run_test(test_coalesce_motion);
+  mu_run_test(test_block_without_consumer);
+  mu_run_test(test_stream_accounting);
+  mu_run_test(test_block_with_consumer);
+
+  return nullptr;
+}
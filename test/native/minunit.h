@@ -0,0 +1,8 @@
+// MinUnit -- A minimal unit testing framework, as in libuiohook/test, with
+// const messages so the tests build as C++.
+#pragma once
+
+#define mu_assert(message, test) do { if (!(test)) return message; } while (0)
+#define mu_run_test(test) do { const char *message = test(); tests_run++; if (message) return message; } while (0)
+
+extern int tests_run;
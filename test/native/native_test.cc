@@ -0,0 +1,34 @@
+// Tests of the header-only parts of the binding, which need neither nan nor a
+// display.  Run with `npm run test:native`.
+#include <cstdio>
+
+#include "minunit.h"
+
+extern const char * event_ring_tests();
+extern const char * event_coalescer_tests();
+extern const char * event_lanes_tests();
+
+int tests_run = 0;
+
+static const char * all_tests() {
+  mu_run_test(event_ring_tests);
+  mu_run_test(event_coalescer_tests);
+  mu_run_test(event_lanes_tests);
+
+  return nullptr;
+}
+
+int main() {
+  int status = 0;
+
+  const char *result = all_tests();
+  if (result != nullptr) {
+    status = 1;
+    printf("%s\n", result);
+  } else {
+    printf("ALL TESTS PASSED\n");
+  }
+  printf("Tests run: %d\n", tests_run);
+
+  return status;
+}
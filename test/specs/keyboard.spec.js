@@ -1,9 +1,30 @@
 const ioHook = require('../../index');
 const robot = require('robotjs');
 
+// A keyboard event as emitted, with no modifier or lock key active unless
+// given in fields.
+function keyEvent(fields) {
+  return Object.assign(
+    {
+      keycode: expect.any(Number),
+      rawcode: expect.any(Number),
+      shiftKey: false,
+      altKey: false,
+      ctrlKey: false,
+      metaKey: false,
+      capsLock: false,
+      numLock: false,
+      scrollLock: false,
+    },
+    fields
+  );
+}
+
 describe('Keyboard events', () => {
   afterEach(() => {
     ioHook.stop();
+    ioHook.removeAllListeners('keydown');
+    ioHook.removeAllListeners('keyup');
   });
 
   it('receives the text "hello world" on keyup event', (done) => {
@@ -25,24 +46,20 @@ describe('Keyboard events', () => {
     let i = 0;
 
     ioHook.on('keydown', (event) => {
-      expect(event).toEqual({
-        keycode: chars[i].keycode,
-        type: 'keydown',
-        shiftKey: false,
-        altKey: false,
-        ctrlKey: false,
-        metaKey: false,
-      });
+      expect(event).toEqual(
+        keyEvent({
+          keycode: chars[i].keycode,
+          type: 'keydown',
+        })
+      );
     });
     ioHook.on('keyup', (event) => {
-      expect(event).toEqual({
-        keycode: chars[i].keycode,
-        type: 'keydown',
-        shiftKey: false,
-        altKey: false,
-        ctrlKey: false,
-        metaKey: false,
-      });
+      expect(event).toEqual(
+        keyEvent({
+          keycode: chars[i].keycode,
+          type: 'keyup',
+        })
+      );
 
       if (i === chars.length - 1) {
         done();
@@ -64,22 +81,20 @@ describe('Keyboard events', () => {
     expect.assertions(8);
 
     ioHook.on('keydown', (event) => {
-      expect(event).toEqual({
-        type: 'keydown',
-        shiftKey: true,
-        altKey: false,
-        ctrlKey: false,
-        metaKey: false,
-      });
+      expect(event).toEqual(
+        keyEvent({
+          type: 'keydown',
+          shiftKey: true,
+        })
+      );
     });
     ioHook.on('keyup', (event) => {
-      expect(event).toEqual({
-        type: 'keydown',
-        shiftKey: true,
-        altKey: false,
-        ctrlKey: false,
-        metaKey: false,
-      });
+      expect(event).toEqual(
+        keyEvent({
+          type: 'keyup',
+          shiftKey: true,
+        })
+      );
     });
     ioHook.start();
 
@@ -95,22 +110,20 @@ describe('Keyboard events', () => {
     expect.assertions(8);
 
     ioHook.on('keydown', (event) => {
-      expect(event).toEqual({
-        type: 'keydown',
-        shiftKey: false,
-        altKey: true,
-        ctrlKey: false,
-        metaKey: false,
-      });
+      expect(event).toEqual(
+        keyEvent({
+          type: 'keydown',
+          altKey: true,
+        })
+      );
     });
     ioHook.on('keyup', (event) => {
-      expect(event).toEqual({
-        type: 'keydown',
-        shiftKey: false,
-        altKey: true,
-        ctrlKey: false,
-        metaKey: false,
-      });
+      expect(event).toEqual(
+        keyEvent({
+          type: 'keyup',
+          altKey: true,
+        })
+      );
     });
     ioHook.start();
 
@@ -126,22 +139,20 @@ describe('Keyboard events', () => {
     expect.assertions(8);
 
     ioHook.on('keydown', (event) => {
-      expect(event).toEqual({
-        type: 'keydown',
-        shiftKey: false,
-        altKey: false,
-        ctrlKey: true,
-        metaKey: false,
-      });
+      expect(event).toEqual(
+        keyEvent({
+          type: 'keydown',
+          ctrlKey: true,
+        })
+      );
     });
     ioHook.on('keyup', (event) => {
-      expect(event).toEqual({
-        type: 'keydown',
-        shiftKey: false,
-        altKey: false,
-        ctrlKey: true,
-        metaKey: false,
-      });
+      expect(event).toEqual(
+        keyEvent({
+          type: 'keyup',
+          ctrlKey: true,
+        })
+      );
     });
     ioHook.start();
 
@@ -157,22 +168,20 @@ describe('Keyboard events', () => {
     expect.assertions(8);
 
     ioHook.on('keydown', (event) => {
-      expect(event).toEqual({
-        type: 'keydown',
-        shiftKey: false,
-        altKey: false,
-        ctrlKey: false,
-        metaKey: true,
-      });
+      expect(event).toEqual(
+        keyEvent({
+          type: 'keydown',
+          metaKey: true,
+        })
+      );
     });
     ioHook.on('keyup', (event) => {
-      expect(event).toEqual({
-        type: 'keydown',
-        shiftKey: false,
-        altKey: false,
-        ctrlKey: false,
-        metaKey: true,
-      });
+      expect(event).toEqual(
+        keyEvent({
+          type: 'keyup',
+          metaKey: true,
+        })
+      );
     });
     ioHook.start();
 
@@ -184,6 +193,39 @@ describe('Keyboard events', () => {
     }, 50);
   });
 
+  it('reports caps lock on every key event while it is on', (done) => {
+    expect.assertions(2);
+
+    // Only the key typed while caps lock is on is checked.
+    const keycodeA = 30;
+
+    ioHook.on('keydown', (event) => {
+      if (event.keycode === keycodeA) {
+        expect(event).toEqual(
+          keyEvent({ keycode: keycodeA, type: 'keydown', capsLock: true })
+        );
+      }
+    });
+    ioHook.on('keyup', (event) => {
+      if (event.keycode === keycodeA) {
+        expect(event).toEqual(
+          keyEvent({ keycode: keycodeA, type: 'keyup', capsLock: true })
+        );
+
+        // Switch caps lock off again for the other tests.
+        robot.keyTap('capslock');
+        setTimeout(done, 50);
+      }
+    });
+    ioHook.start();
+
+    setTimeout(() => {
+      // Make sure ioHook starts before anything gets typed
+      robot.keyTap('capslock');
+      robot.keyTap('a');
+    }, 50);
+  });
+
   it('runs a callback when a shortcut has been released', (done) => {
     expect.assertions(2);
 